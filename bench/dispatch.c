@@ -0,0 +1,275 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Dispatch Benchmark
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ *
+ * Times two arithmetic loops, and any programs named on the command line,
+ * on the bytecode machine and the tree walker without anyone at the keyboard:
+ * INPUT reads from an empty stream and PRINT writes to a scratch file. The
+ * bytecode machine dispatches by computed goto where the compiler allows it,
+ * so "make bench-dispatch" builds this once as it stands and once with
+ * -DUSE_SWITCH and runs both. Samples such as bas/lander.bas can be named
+ * too, though with no input they stop at their first INPUT.
+ */
+
+
+/* included headers */
+#include <stdio.h>
+#include <time.h>
+#include "common.h"
+#include "errors.h"
+#include "options.h"
+#include "parser.h"
+#include "interpret.h"
+#include "optimiser.h"
+
+
+/*
+ * Data Definitions
+ */
+
+
+/* the number of timings, and runs of a named program per timing */
+#define TIMINGS 5
+#define REPEATS 20
+
+/* a program to time */
+typedef struct {
+  const char *name; /* what to call it */
+  const char *source; /* its text, or NULL to read the named file */
+} BenchProgram;
+
+/* a counting loop that calls a subroutine */
+static const char calls[] =
+  "10 LET N=0\n"
+  "20 LET S=0\n"
+  "30 LET N=N+1\n"
+  "40 LET S=S+N*2-N/3\n"
+  "50 GOSUB 100\n"
+  "60 IF N<3000000 THEN GOTO 30\n"
+  "70 PRINT S\n"
+  "80 END\n"
+  "100 LET K=K+1\n"
+  "110 RETURN\n";
+
+/* a loop of longer expressions and conditions */
+static const char expressions[] =
+  "10 LET N=0\n"
+  "20 LET S=0\n"
+  "30 LET N=N+1\n"
+  "40 LET S=(S+N*3-N/2+(N-1)*2)/2\n"
+  "50 IF N-N/7*7=0 THEN LET S=S+1\n"
+  "60 IF N<2000000 THEN GOTO 30\n"
+  "70 PRINT S\n"
+  "80 END\n";
+
+/* the loops that are always timed */
+static const BenchProgram loops[] = {
+  { "calls", calls },
+  { "expressions", expressions }
+};
+#define LOOPS (int) (sizeof (loops) / sizeof (loops[0]))
+
+
+/*
+ * Level 2 Functions
+ */
+
+
+/*
+ * Read the monotonic clock
+ * returns:
+ *   double   a time in seconds from some fixed point
+ */
+static double read_time (void) {
+  struct timespec now; /* the time now */
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*
+ * Run a parsed program once
+ * params:
+ *   ProgramNode*     program     the program
+ *   ExecutionOption  execution   the engine to run it on
+ * returns:
+ *   int                          0 if it ran, 1 if it could not
+ */
+static int run_program (ProgramNode *program, ExecutionOption execution) {
+
+  /* local variables */
+  ErrorHandler *errors; /* the run's error handler */
+  LanguageOptions *options; /* the run's language options */
+  Interpreter *interpreter; /* runs the program */
+  FILE
+    *input, /* an empty stream for INPUT */
+    *output; /* a scratch file for PRINT */
+
+  /* set up the run */
+  errors = new_ErrorHandler ();
+  options = new_LanguageOptions ();
+  input = tmpfile ();
+  output = tmpfile ();
+  if (! errors || ! options || ! input || ! output) {
+    if (errors) errors->destroy (errors);
+    if (options) options->destroy (options);
+    if (input) fclose (input);
+    if (output) fclose (output);
+    return 1;
+  }
+  options->set_execution (options, execution);
+
+  /* run the program, ignoring runtime errors as the programs end in them */
+  interpreter = new_Interpreter (errors, options);
+  interpreter->set_streams (interpreter, input, output);
+  interpreter->interpret (interpreter, program);
+  interpreter->destroy (interpreter);
+
+  /* tidy up */
+  fclose (output);
+  fclose (input);
+  options->destroy (options);
+  errors->destroy (errors);
+  return 0;
+}
+
+
+/*
+ * Level 1 Functions
+ */
+
+
+/*
+ * Parse a program from its text or its file
+ * params:
+ *   const BenchProgram*   bench   the program
+ * returns:
+ *   ProgramNode*                  the parsed program, NULL on failure
+ */
+static ProgramNode *parse_program (const BenchProgram *bench) {
+
+  /* local variables */
+  ErrorHandler *errors; /* the parse's error handler */
+  LanguageOptions *options; /* the parse's language options */
+  Parser *parser; /* the parser */
+  ProgramNode *program = NULL; /* the parsed program */
+  FILE *source; /* the program text */
+
+  /* open the program text */
+  if (bench->source) {
+    if ((source = tmpfile ())) {
+      fputs (bench->source, source);
+      rewind (source);
+    }
+  } else
+    source = fopen (bench->name, "r");
+  if (! source)
+    return NULL;
+
+  /* parse and optimise it as the interpreter would */
+  errors = new_ErrorHandler ();
+  options = new_LanguageOptions ();
+  if (errors && options) {
+    parser = new_Parser (errors, options, source);
+    program = parser->parse (parser);
+    parser->destroy (parser);
+    if (errors->get_code (errors) && program) {
+      program_destroy (program);
+      program = NULL;
+    } else if (program)
+      optimise_program (program);
+  }
+  if (errors) errors->destroy (errors);
+  if (options) options->destroy (options);
+  fclose (source);
+  return program;
+}
+
+/*
+ * Time a program on one engine
+ * params:
+ *   ProgramNode*    program     the program
+ *   ExecutionOption execution   the engine to time
+ *   int             repeats     runs per timing
+ * returns:
+ *   double                      the best time for one run in milliseconds,
+ *                               or a negative number if it could not run
+ */
+static double time_program (ProgramNode *program, ExecutionOption execution,
+  int repeats) {
+
+  /* local variables */
+  int
+    timing, /* the timing being made */
+    repeat; /* a run within the timing */
+  double
+    start, /* the time a timing started */
+    best = 0; /* the fastest timing */
+
+  /* run the program repeatedly, keeping the fastest timing */
+  for (timing = 0; timing < TIMINGS; ++timing) {
+    start = read_time ();
+    for (repeat = 0; repeat < repeats; ++repeat)
+      if (run_program (program, execution))
+        return -1;
+    start = read_time () - start;
+    if (! timing || start < best)
+      best = start;
+  }
+  return best * 1e3 / repeats;
+}
+
+
+/*
+ * Top Level Function
+ */
+
+
+/*
+ * Main Program
+ * params:
+ *   int     argc   number of command line arguments
+ *   char*   argv   program files to time after the loops
+ * returns:
+ *   int            0 if all went well, 1 if a program could not run
+ */
+int main (int argc, char **argv) {
+
+  /* local variables */
+  BenchProgram bench; /* the program being timed */
+  ProgramNode *program; /* the parsed program */
+  int index; /* the program being timed */
+  double
+    bytecode, /* time per run on the bytecode machine */
+    tree; /* time per run on the tree walker */
+
+  /* time the loops and then each program named */
+#ifdef USE_COMPUTED_GOTO
+  printf ("computed goto dispatch, best of %d timings\n", TIMINGS);
+#else
+  printf ("switch dispatch, best of %d timings\n", TIMINGS);
+#endif
+  printf ("  %-24s %12s %12s\n", "program", "bytecode ms", "tree ms");
+  for (index = 0; index < LOOPS + argc - 1; ++index) {
+    if (index < LOOPS)
+      bench = loops[index];
+    else {
+      bench.name = argv[index - LOOPS + 1];
+      bench.source = NULL;
+    }
+    if (! (program = parse_program (&bench))) {
+      printf ("%s could not be parsed\n", bench.name);
+      return 1;
+    }
+    bytecode = time_program (program, EXECUTION_BYTECODE,
+      bench.source ? 1 : REPEATS);
+    tree = time_program (program, EXECUTION_TREE, bench.source ? 1 : REPEATS);
+    program_destroy (program);
+    if (bytecode < 0 || tree < 0)
+      return 1;
+    printf ("  %-24s %12.2f %12.2f\n", bench.name, bytecode, tree);
+  }
+  return 0;
+}
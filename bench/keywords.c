@@ -0,0 +1,176 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Keyword Recognition Benchmark
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ *
+ * Times identify_word() against the chain of case-insensitive compares it
+ * replaced, over a mix of keywords, in both spellings, and variable names
+ * such as a program contains. Build and run it with "make bench-keywords".
+ */
+
+
+/* included headers */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "common.h"
+#include "tokenizer.h"
+
+
+/*
+ * Data Definitions
+ */
+
+
+/* how many times the word list is identified per timing, and the timings */
+#define PASSES 200000
+#define TIMINGS 5
+
+/* the words to identify, roughly as often as programs use them */
+static const TCHAR *words[] = {
+  _T("LET"), _T("A"), _T("IF"), _T("B"), _T("THEN"), _T("GOTO"),
+  _T("PRINT"), _T("X"), _T("LET"), _T("N"), _T("GOSUB"), _T("RETURN"),
+  _T("INPUT"), _T("I"), _T("END"), _T("REM"), _T("S"), _T("print"),
+  _T("if"), _T("T"), _T("COUNT"), _T("Z"), _T("let"), _T("goto"),
+  KEYWORD_LET, KEYWORD_IF, KEYWORD_THEN, KEYWORD_GOTO, KEYWORD_PRINT,
+  KEYWORD_GOSUB, KEYWORD_RETURN, KEYWORD_END
+};
+#define WORDS (int) (sizeof (words) / sizeof (words[0]))
+
+
+/*
+ * Level 1 Functions
+ */
+
+
+/*
+ * Read the monotonic clock
+ * returns:
+ *   double   a time in seconds from some fixed point
+ */
+static double read_time (void) {
+  struct timespec now; /* the time now */
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*
+ * Identify a word by the chain of compares identify_word() replaced
+ * params:
+ *   const TCHAR*   word     the word to identify
+ *   int            length   the length of the word, which it ignored
+ * returns:
+ *   TokenClass              the token class recognised by the parser
+ */
+static TokenClass chain_identify_word (const TCHAR *word, int length) {
+  if (! tinybasic_strcmp (word, KEYWORD_LET)
+    || ! tinybasic_strcmp (word, DEFAULT_KEYWORD_LET))
+    return TOKEN_LET;
+  else if (! tinybasic_strcmp (word, KEYWORD_IF)
+    || ! tinybasic_strcmp (word, DEFAULT_KEYWORD_LET))
+    return TOKEN_IF;
+  else if (! tinybasic_strcmp (word, KEYWORD_THEN)
+    || ! tinybasic_strcmp (word, DEFAULT_KEYWORD_LET))
+    return TOKEN_THEN;
+  else if (! tinybasic_strcmp (word, KEYWORD_GOTO)
+    || ! tinybasic_strcmp (word, DEFAULT_KEYWORD_LET))
+    return TOKEN_GOTO;
+  else if (! tinybasic_strcmp (word, KEYWORD_GOSUB)
+    || ! tinybasic_strcmp (word, DEFAULT_KEYWORD_LET))
+    return TOKEN_GOSUB;
+  else if (! tinybasic_strcmp (word, KEYWORD_RETURN)
+    || ! tinybasic_strcmp (word, DEFAULT_KEYWORD_LET))
+    return TOKEN_RETURN;
+  else if (! tinybasic_strcmp (word, KEYWORD_END)
+    || ! tinybasic_strcmp (word, DEFAULT_KEYWORD_END))
+    return TOKEN_END;
+  else if (! tinybasic_strcmp (word, KEYWORD_PRINT)
+    || ! tinybasic_strcmp (word, DEFAULT_KEYWORD_PRINT))
+    return TOKEN_PRINT;
+  else if (! tinybasic_strcmp (word, KEYWORD_INPUT)
+    || ! tinybasic_strcmp (word, DEFAULT_KEYWORD_INPUT))
+    return TOKEN_INPUT;
+  else if (! tinybasic_strcmp (word, KEYWORD_REM)
+    || ! tinybasic_strcmp (word, DEFAULT_KEYWORD_REM))
+    return TOKEN_REM;
+  else if (! tinybasic_strcmp (word, KEYWORD_PEEK)
+    || ! tinybasic_strcmp (word, DEFAULT_KEYWORD_PEEK))
+    return TOKEN_PEEK;
+  else if (! tinybasic_strcmp (word, KEYWORD_POKE)
+    || ! tinybasic_strcmp (word, DEFAULT_KEYWORD_POKE))
+    return TOKEN_POKE;
+  else if (strlen (word) >= 1)
+    return TOKEN_VARIABLE;
+  else
+    return TOKEN_WORD;
+}
+
+/*
+ * Time one way of identifying the words
+ * params:
+ *   TokenClass (*)(const TCHAR*, int)   identify   the way to time
+ *   const int*                          lengths    the length of each word
+ * returns:
+ *   double                                         the best time per word
+ *                                                  in nanoseconds
+ */
+static double time_words (TokenClass (*identify) (const TCHAR *, int),
+  const int *lengths) {
+
+  /* local variables */
+  int
+    timing, /* the timing being made */
+    pass, /* a pass over the word list */
+    word; /* a word in the list */
+  volatile int sink = 0; /* keeps the results from being optimised away */
+  double
+    start, /* the time a timing started */
+    best = 0; /* the fastest timing */
+
+  /* identify every word many times, keeping the fastest timing */
+  for (timing = 0; timing < TIMINGS; ++timing) {
+    start = read_time ();
+    for (pass = 0; pass < PASSES; ++pass)
+      for (word = 0; word < WORDS; ++word)
+        sink += identify (words[word], lengths[word]);
+    start = read_time () - start;
+    if (! timing || start < best)
+      best = start;
+  }
+  return best * 1e9 / ((double) PASSES * WORDS);
+}
+
+
+/*
+ * Top Level Function
+ */
+
+
+/*
+ * Main Program
+ * returns:
+ *   int   0
+ */
+int main (void) {
+
+  /* local variables */
+  int
+    lengths[WORDS], /* the length of each word */
+    word; /* a word in the list */
+  double
+    chain, /* time per word for the compare chain */
+    lookup; /* time per word for identify_word() */
+
+  /* time both ways over the same words */
+  for (word = 0; word < WORDS; ++word)
+    lengths[word] = (int) strlen (words[word]);
+  chain = time_words (chain_identify_word, lengths);
+  lookup = time_words (identify_word, lengths);
+  printf ("%d words, best of %d timings\n", WORDS, TIMINGS);
+  printf ("  compare chain   %6.1f ns/word\n", chain);
+  printf ("  identify_word   %6.1f ns/word\n", lookup);
+  printf ("  speedup         %6.1fx\n", chain / lookup);
+  return 0;
+}
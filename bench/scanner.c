@@ -0,0 +1,271 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Tokenizer Throughput Benchmark
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ *
+ * Generates large programs of a few kinds in memory and times the buffer
+ * tokenizer over them in MB/s. The scanner's runs use whichever of AVX2,
+ * SSE2 or scalar code the build selects, so "make bench-scanner" builds
+ * this once with -DNO_SIMD, once as it stands and once with -mavx2, and
+ * runs all three for comparison.
+ */
+
+
+/* included headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "common.h"
+#include "tokenizer.h"
+
+
+/*
+ * Data Definitions
+ */
+
+
+/* the size of each generated program, and the number of timings */
+#define PROGRAM_SIZE (16 << 20)
+#define TIMINGS 5
+
+/* a kind of program to generate */
+typedef struct {
+  const char *name; /* what the program is made of */
+  int (*line) (char *, int); /* writes a line, returning its length */
+} ProgramKind;
+
+/* the state of the generator's pseudo-random numbers */
+static unsigned long seed = 1;
+
+
+/*
+ * Level 2 Functions
+ */
+
+
+/*
+ * Make a pseudo-random number, the same on every run
+ * params:
+ *   int   range   the number of possible values
+ * returns:
+ *   int           a number from 0 to range - 1
+ */
+static int random_number (int range) {
+  seed = seed * 1103515245 + 12345;
+  return (int) ((seed >> 16) % range);
+}
+
+/*
+ * Write a run of spaces
+ * params:
+ *   char*   text     where to write them
+ *   int     length   how many to write
+ * returns:
+ *   int              the number written
+ */
+static int spaces (char *text, int length) {
+  memset (text, ' ', length);
+  return length;
+}
+
+
+/*
+ * Level 1 Functions
+ */
+
+
+/*
+ * Write a line with long runs of blanks between its tokens
+ * params:
+ *   char*   text    where to write the line
+ *   int     label   the line's label
+ * returns:
+ *   int             the length of the line
+ */
+static int blank_line (char *text, int label) {
+  int length = sprintf (text, "%d", label);
+  length += spaces (text + length, 20 + random_number (100));
+  length += sprintf (text + length, "LET");
+  length += spaces (text + length, 20 + random_number (100));
+  length += sprintf (text + length, "%c=%d", 'A' + random_number (26),
+    random_number (1000));
+  length += spaces (text + length, random_number (60));
+  text[length++] = '\n';
+  return length;
+}
+
+/*
+ * Write a line that prints a long string
+ * params:
+ *   char*   text    where to write the line
+ *   int     label   the line's label
+ * returns:
+ *   int             the length of the line
+ */
+static int string_line (char *text, int label) {
+  static const char letters[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ abcdefghijklmnopqrstuvwxyz 0123456789.,!?";
+  int
+    length = sprintf (text, "%d PRINT \"", label), /* length so far */
+    count = 40 + random_number (120); /* characters in the string */
+  while (count--)
+    text[length++] = letters[random_number (sizeof (letters) - 1)];
+  length += sprintf (text + length, "\"\n");
+  return length;
+}
+
+/*
+ * Write a comment line
+ * params:
+ *   char*   text    where to write the line
+ *   int     label   the line's label
+ * returns:
+ *   int             the length of the line
+ */
+static int comment_line (char *text, int label) {
+  int
+    length = sprintf (text, "%d REM ", label), /* length so far */
+    count = 40 + random_number (120); /* characters in the comment */
+  while (count--)
+    text[length++] = ' ' + random_number (95);
+  text[length++] = '\n';
+  return length;
+}
+
+/*
+ * Write a short assignment with no spare blanks
+ * params:
+ *   char*   text    where to write the line
+ *   int     label   the line's label
+ * returns:
+ *   int             the length of the line
+ */
+static int dense_line (char *text, int label) {
+  return sprintf (text, "%d LET %c=%c+%d*%c-%c/%d\n", label,
+    'A' + random_number (26), 'A' + random_number (26), random_number (100),
+    'A' + random_number (26), 'A' + random_number (26),
+    1 + random_number (9));
+}
+
+/*
+ * Read the monotonic clock
+ * returns:
+ *   double   a time in seconds from some fixed point
+ */
+static double read_time (void) {
+  struct timespec now; /* the time now */
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*
+ * Generate a program of one kind
+ * params:
+ *   const ProgramKind*   kind   the kind of program
+ *   int*                 size   receives the size of the program
+ * returns:
+ *   char*                       the program, NULL if memory ran out
+ */
+static char *generate (const ProgramKind *kind, int *size) {
+
+  /* local variables */
+  char *text; /* the program text */
+  int label = 10; /* the label of the next line */
+
+  /* write lines until the program is big enough, leaving room for one */
+  if (! (text = malloc (PROGRAM_SIZE + 1024)))
+    return NULL;
+  *size = 0;
+  while (*size < PROGRAM_SIZE) {
+    *size += kind->line (text + *size, label);
+    label += 10;
+  }
+  return text;
+}
+
+/*
+ * Time the tokenizer over a program
+ * params:
+ *   const char*   text    the program
+ *   int           size    the size of the program
+ *   long*         count   receives the number of tokens
+ * returns:
+ *   double                the best time in seconds
+ */
+static double time_tokens (const char *text, int size, long *count) {
+
+  /* local variables */
+  TokenStream *stream; /* the tokenizer */
+  Token token; /* a token read */
+  int timing; /* the timing being made */
+  double
+    start, /* the time a timing started */
+    best = 0; /* the fastest timing */
+
+  /* read every token, keeping the fastest timing */
+  for (timing = 0; timing < TIMINGS; ++timing) {
+    start = read_time ();
+    if (! (stream = new_BufferTokenStream (text, size)))
+      return 0;
+    *count = 0;
+    do {
+      token = stream->next (stream);
+      ++*count;
+    } while (token.class != TOKEN_EOF);
+    stream->destroy (stream);
+    start = read_time () - start;
+    if (! timing || start < best)
+      best = start;
+  }
+  return best;
+}
+
+
+/*
+ * Top Level Function
+ */
+
+
+/*
+ * Main Program
+ * returns:
+ *   int   0 if all went well, 1 if memory ran out
+ */
+int main (void) {
+
+  /* local variables */
+  static const ProgramKind kinds[] = {
+    { "long blank runs", blank_line },
+    { "string literals", string_line },
+    { "REM comments", comment_line },
+    { "dense LET lines", dense_line }
+  }; /* the kinds of program to time */
+  char *text; /* a generated program */
+  int
+    kind, /* the kind of program being timed */
+    size; /* the size of the program */
+  long count; /* tokens in the program */
+  double time; /* the best time to tokenize it */
+
+  /* time each kind of program */
+#if defined(USE_AVX2)
+  printf ("AVX2 scanner, best of %d timings\n", TIMINGS);
+#elif defined(USE_SSE2)
+  printf ("SSE2 scanner, best of %d timings\n", TIMINGS);
+#else
+  printf ("scalar scanner, best of %d timings\n", TIMINGS);
+#endif
+  for (kind = 0; kind < (int) (sizeof (kinds) / sizeof (kinds[0])); ++kind) {
+    if (! (text = generate (&kinds[kind], &size)))
+      return 1;
+    if (! (time = time_tokens (text, size, &count)))
+      return 1;
+    printf ("  %-16s %5.1f MB %9ld tokens %7.1f MB/s\n", kinds[kind].name,
+      size / 1048576.0, count, size / 1048576.0 / time);
+    free (text);
+  }
+  return 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Arena Allocator Header
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+
+/* pre-requisite headers */
+#include <stddef.h>
+#include "common.h"
+
+
+/*
+ * Data Definitions
+ */
+
+
+/* a block of memory from which allocations are carved */
+typedef struct arena_block ArenaBlock;
+typedef struct arena_block {
+  ArenaBlock *next; /* the previously filled block */
+  size_t size; /* bytes available in the block */
+  size_t used; /* bytes handed out so far */
+} ArenaBlock;
+
+/* an arena: memory that is allocated piecemeal and released all at once */
+typedef struct {
+  ArenaBlock *current; /* the block being carved up */
+} Arena;
+
+
+/*
+ * Function Declarations
+ */
+
+
+/*
+ * Arena constructor
+ * returns:
+ *   Arena*   the new arena, NULL if memory ran out
+ */
+Arena *arena_create (void);
+
+/*
+ * Allocate memory from an arena
+ * params:
+ *   Arena*   arena   the arena
+ *   size_t   size    the number of bytes required
+ * returns:
+ *   void*            the memory, NULL if memory ran out
+ */
+void *arena_alloc (Arena *arena, size_t size);
+
+/*
+ * Copy a string into an arena
+ * params:
+ *   Arena*         arena    the arena
+ *   const TCHAR*   string   the string to copy
+ * returns:
+ *   TCHAR*                  the copy, NULL if memory ran out
+ */
+TCHAR *arena_strdup (Arena *arena, const TCHAR *string);
+
+/*
+ * Move everything allocated from another arena into an arena
+ * params:
+ *   Arena*   arena   the arena to receive the memory
+ *   Arena*   other   the arena to give it up, which is destroyed
+ */
+void arena_adopt (Arena *arena, Arena *other);
+
+/*
+ * Arena destructor, releasing everything allocated from it
+ * params:
+ *   Arena*   arena   the doomed arena
+ */
+void arena_destroy (Arena *arena);
+
+
+#endif
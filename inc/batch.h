@@ -0,0 +1,90 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Batch Runner Header
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+
+/* included headers */
+#include "common.h"
+#include "options.h"
+
+
+/*
+ * Data Declarations
+ */
+
+
+/* the batch runner object */
+typedef struct batch_data BatchData;
+typedef struct batch Batch;
+typedef struct batch {
+
+  /* Properties */
+  BatchData *priv; /* private data */
+
+  /*
+   * Add a program to the batch
+   * params:
+   *   Batch*   the batch
+   *   TCHAR*   the program filename
+   *   TCHAR*   the file to supply its INPUT, or NULL for none
+   * returns:
+   *   int      !0 if successful, 0 if memory ran out
+   */
+  int (*add_program) (Batch *, TCHAR *, TCHAR *);
+
+  /*
+   * Add the programs listed in a manifest, one per line, each
+   * optionally followed by the file to supply its INPUT
+   * params:
+   *   Batch*   the batch
+   *   TCHAR*   the manifest filename
+   * returns:
+   *   int      !0 if successful, 0 if the manifest could not be read
+   */
+  int (*add_manifest) (Batch *, TCHAR *);
+
+  /*
+   * Run the programs, writing their output in order to stdout and
+   * their exit statuses to stderr
+   * params:
+   *   Batch*   the batch
+   *   int      the number of worker threads
+   * returns:
+   *   int      the first non-zero exit status, or 0 if all succeeded
+   */
+  int (*run) (Batch *, int);
+
+  /*
+   * Destructor
+   * params:
+   *   Batch*   the doomed batch
+   */
+  void (*destroy) (Batch *);
+
+} Batch;
+
+
+/*
+ * Function Declarations
+ */
+
+
+/*
+ * Constructor
+ * params:
+ *   LanguageOptions*   options   the language options for every program
+ * returns:
+ *   Batch*                       the new batch
+ */
+Batch *new_Batch (LanguageOptions *options);
+
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Bytecode Header
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+#ifndef __BYTECODE_H__
+#define __BYTECODE_H__
+
+
+/* pre-requisite headers */
+#include "common.h"
+#include "errors.h"
+#include "statement.h"
+
+
+/*
+ * Data Definitions
+ */
+
+
+/* the operations of the virtual machine */
+typedef enum {
+  OP_HALT, /* stop at the end of the program */
+  OP_PUSH, /* push a constant: value */
+  OP_LOAD, /* push a variable: variable */
+  OP_STORE, /* pop into a variable: variable */
+  OP_NEGATE, /* negate the top of the stack */
+  OP_LIMIT, /* range check the top of the stack */
+  OP_ADD, /* pop two values and push their sum */
+  OP_SUBTRACT, /* pop two values and push their difference */
+  OP_MULTIPLY, /* pop two values and push their product */
+  OP_DIVIDE, /* pop two values and push their quotient */
+  OP_IF_EQUAL, /* pop two values, branch if not equal: address */
+  OP_IF_UNEQUAL, /* pop two values, branch if equal: address */
+  OP_IF_LESSTHAN, /* pop two values, branch if not <: address */
+  OP_IF_LESSOREQUAL, /* pop two values, branch if not <=: address */
+  OP_IF_GREATERTHAN, /* pop two values, branch if not >: address */
+  OP_IF_GREATEROREQUAL, /* pop two values, branch if not >=: address */
+  OP_JUMP, /* jump to a line: address */
+  OP_CALL, /* call a line: address, return address */
+  OP_GOTO, /* pop a label and jump to its line */
+  OP_GOSUB, /* pop a label and call its line: return address */
+  OP_RETURN, /* return to the address on top of the GOSUB stack */
+  OP_END, /* stop the program */
+  OP_PRINT_STRING, /* print a string constant: string */
+  OP_PRINT_NUMBER, /* pop a value and print it */
+  OP_PRINT_LINE, /* print a line feed */
+  OP_INPUT, /* input values: count, variable... */
+  OP_PEEK, /* pop an address and store what it holds: variable */
+  OP_POKE, /* pop a value and an address and store the one at the other */
+  OP_LAST /* placeholder */
+} Operation;
+
+/* a compiled program */
+typedef struct {
+  int *code; /* the operations and their operands */
+  int code_size; /* number of cells in the code */
+  int *labels; /* the label of each program line, in program order */
+  int *addresses; /* the code address of each program line */
+  int line_count; /* number of program lines */
+  TCHAR **strings; /* the string constants */
+  int string_count; /* number of string constants */
+  int max_stack; /* the deepest the value stack will grow */
+  void *image; /* the cache file holding the parts, NULL if compiled */
+  size_t image_size; /* the size of the cache file */
+  int mapped; /* !0 if the cache file is mapped rather than read */
+} Bytecode;
+
+/* what a cached program was built from, which must match to reuse it */
+typedef struct {
+  long long source_size; /* the size of the source file */
+  long long source_time; /* when the source file was last modified, in
+                            nanoseconds where the system records them */
+  unsigned long long source_hash; /* FNV-1a hash of the source file */
+  int line_numbers; /* the line number option */
+  int line_limit; /* the line number limit */
+  int comments; /* the comment option */
+  int integer_width; /* the integer width, which limits the constants */
+} BytecodeStamp;
+
+
+/*
+ * Function Declarations
+ */
+
+
+/*
+ * Compile a program into bytecode
+ * params:
+ *   ProgramNode*    program   the program to compile
+ *   ErrorHandler*   errors    the error handler
+ * returns:
+ *   Bytecode*                 the compiled program, NULL on failure
+ */
+Bytecode *bytecode_compile (ProgramNode *program, ErrorHandler *errors);
+
+/*
+ * Find the program line containing a code address
+ * params:
+ *   Bytecode*   bytecode   the compiled program
+ *   int         address    the code address
+ * returns:
+ *   int                    the index of the line, -1 if none
+ */
+int bytecode_find_line (Bytecode *bytecode, int address);
+
+/*
+ * Write compiled bytecode to a cache file
+ * params:
+ *   Bytecode*        bytecode   the compiled program
+ *   const TCHAR*     filename   the name of the cache file
+ *   BytecodeStamp*   stamp      what the program was built from
+ * returns:
+ *   int                         !0 if written, 0 if the file couldn't be
+ */
+int bytecode_save (Bytecode *bytecode, const TCHAR *filename,
+  BytecodeStamp *stamp);
+
+/*
+ * Load bytecode from a cache file, mapping it where possible
+ * params:
+ *   const TCHAR*     filename   the name of the cache file
+ *   BytecodeStamp*   stamp      what the program must have been built from
+ * returns:
+ *   Bytecode*                   the program, NULL if missing or out of date
+ */
+Bytecode *bytecode_load (const TCHAR *filename, BytecodeStamp *stamp);
+
+/*
+ * Bytecode destructor
+ * params:
+ *   Bytecode*   bytecode   the doomed bytecode
+ */
+void bytecode_destroy (Bytecode *bytecode);
+
+
+#endif
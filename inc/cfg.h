@@ -0,0 +1,107 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Control Flow Graph Header
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+#ifndef __CFG_H__
+#define __CFG_H__
+
+
+/* pre-requisite headers */
+#include "statement.h"
+
+
+/*
+ * Data Definitions
+ */
+
+
+/* ways in which control can leave a block, combined as bit flags */
+typedef enum {
+  CFG_EXIT_FALLTHROUGH = 1, /* continues into the next block */
+  CFG_EXIT_JUMP = 2, /* GOTO to a constant label */
+  CFG_EXIT_CALL = 4, /* GOSUB to a constant label */
+  CFG_EXIT_JUMP_ANY = 8, /* GOTO to a computed label: any labelled line */
+  CFG_EXIT_CALL_ANY = 16, /* GOSUB to a computed label: any labelled line */
+  CFG_EXIT_RETURN = 32, /* RETURN to the line after any GOSUB */
+  CFG_EXIT_END = 64 /* END, or running off the end of the program */
+} CfgExit;
+
+/* ways in which control can reach a block, combined as bit flags */
+typedef enum {
+  CFG_ENTRY_START = 1, /* the program starts here */
+  CFG_ENTRY_FALLTHROUGH = 2, /* from the end of the previous block */
+  CFG_ENTRY_JUMP = 4, /* from a GOTO to a constant label */
+  CFG_ENTRY_CALL = 8, /* from a GOSUB to a constant label */
+  CFG_ENTRY_RETURN = 16, /* from a RETURN to the GOSUB before it */
+  CFG_ENTRY_ANY_LINE = 32 /* from a GOTO or GOSUB to a computed label */
+} CfgEntry;
+
+/* a basic block: lines that always run in sequence from the first */
+typedef struct {
+  ProgramLineNode *first; /* the first line of the block */
+  ProgramLineNode *last; /* the last line of the block */
+  int position; /* position of the first line in the program */
+  int line_count; /* number of lines in the block */
+  int entries; /* CfgEntry flags for the ways into the block */
+  int exits; /* CfgExit flags for the ways out of the last line */
+  int next; /* the block reached by falling through or on return from
+               a GOSUB, -1 if none */
+  int jump; /* the block a constant GOTO reaches, -1 if none */
+  int call; /* the block a constant GOSUB reaches, -1 if none */
+} CfgBlock;
+
+/* a program line and the block that holds it */
+typedef struct {
+  ProgramLineNode *line; /* the program line */
+  int block; /* index of the block that holds it */
+} CfgLine;
+
+/* the control flow graph of a program */
+typedef struct {
+  CfgBlock *blocks; /* the blocks in program order */
+  int block_count; /* number of blocks */
+  CfgLine *lines; /* every line, sorted by address for searching */
+  int line_count; /* number of lines */
+  int computed; /* !0 if any GOTO or GOSUB has a computed label, in which
+                   case every labelled line is an ANY_LINE entry */
+} Cfg;
+
+
+/*
+ * Function Declarations
+ */
+
+
+/*
+ * Build the control flow graph of a linked program
+ * params:
+ *   ProgramNode*   program   the program, its constant targets resolved
+ * returns:
+ *   Cfg*                     the graph, NULL if memory ran out
+ */
+Cfg *cfg_build (ProgramNode *program);
+
+/*
+ * Find the block that holds a program line
+ * params:
+ *   Cfg*               cfg    the control flow graph
+ *   ProgramLineNode*   line   the program line
+ * returns:
+ *   int                       index of the block, -1 if the line isn't found
+ */
+int cfg_find_block (Cfg *cfg, ProgramLineNode *line);
+
+/*
+ * Control flow graph destructor
+ * params:
+ *   Cfg*   cfg   the doomed graph
+ */
+void cfg_destroy (Cfg *cfg);
+
+
+#endif
@@ -29,6 +29,40 @@
 #define USE_CHINESE
 #endif
 
+/* direct-threaded dispatch needs labels as values; -DUSE_SWITCH to opt out */
+#if defined(__GNUC__) && !defined(USE_SWITCH)
+#ifndef USE_COMPUTED_GOTO
+#define USE_COMPUTED_GOTO
+#endif
+#endif
+
+/* batch runs use a pool of POSIX threads; -DNO_THREADS to opt out */
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(NO_THREADS)
+#ifndef USE_THREADS
+#define USE_THREADS
+#endif
+#endif
+
+/* program files are memory-mapped where POSIX allows; -DNO_MMAP to opt out */
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(NO_MMAP)
+#ifndef USE_MMAP
+#define USE_MMAP
+#endif
+#endif
+
+/* the tokenizer scans runs with SSE2 or AVX2 when built for them; -DNO_SIMD
+   to opt out */
+#if !defined(USE_WCHAR) && !defined(NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#ifndef USE_SSE2
+#define USE_SSE2
+#endif
+#endif
+#if defined(__AVX2__) && !defined(USE_AVX2)
+#define USE_AVX2
+#endif
+#endif
+
 
 #ifdef  USE_WCHAR
 #define LAST_ANSI 0xff
@@ -63,6 +97,9 @@
 #define _T(x) x
 #define _malloc malloc
 #define _realloc realloc
+#ifndef _MSC_VER
+#define _strdup strdup
+#endif
 #endif
 
 #ifdef  USE_DEFAULTS
@@ -161,6 +198,9 @@
 #define FORMATTER_UNRECOGNISED    _T("δʶ.")
 
 #define INTERPRETER_TYPE_ERROR	  _T(" %d δʵ.\n")
+#define PROFILE_HEADER			  _T("        к             ʱ()   ռ\n")
+#define PROFILE_LINE			  _T("%8d %7d %13llu %12.3f %6.1f%%\n")
+#define PROFILE_TOTAL			  _T("    ϼ         %13llu %12.3f  100.0%%\n")
 
 #define TINY_BASIC_USAGE		  _T("÷: %s [ѡ] [ļ]\n")
 
@@ -168,6 +208,8 @@
 #define TINY_BASIC_RUNTIME_ERROR  _T("ʱ: %s\n")
 #define TINY_BASIC_PARSE_ERROR    _T("﷨: %s\n")
 #define TINY_BASIC_FILE_ERROR     _T(": ޷ļ %s\n")
+#define TINY_BASIC_GOSUB_HIGH_WATER _T("ӳջ: %d / %d\n")
+#define TINY_BASIC_BATCH_STATUS   _T("%s: ˳״̬ %d\n")
 
 #define TINY_BASIC_ENABLE		  _T("")
 #define TINY_BASIC_DISABLE		  _T("")
@@ -176,6 +218,9 @@
 #define TINY_BASIC_IMPLIED		  _T("")
 #define TINY_BASIC_MANDATORY      _T("ǿ")
 
+#define TINY_BASIC_BYTECODE		  _T("ֽ")
+#define TINY_BASIC_TREE		      _T("﷨")
+
 #else
 #define ERROR_SUCCESSFUL			  _T("Successful")
 #define ERROR_INVALID_LINE_NUMBER	  _T("Invalid line number")
@@ -234,6 +279,9 @@
 #define GENERATOR_DEFINE_ERROR    _T("#define E_RETURN_WITHOUT_GOSUB %d\n")
 
 #define INTERPRETER_TYPE_ERROR	  _T("Statement type %d not implemented.\n")
+#define PROFILE_HEADER			  _T("   Label    Line         Count    Time (ms)  Share\n")
+#define PROFILE_LINE			  _T("%8d %7d %13llu %12.3f %6.1f%%\n")
+#define PROFILE_TOTAL			  _T("   Total         %13llu %12.3f  100.0%%\n")
 
 #define TINY_BASIC_USAGE		  _T("Usage: %s [OPTIONS] [INPUT-FILE]\n")
 
@@ -241,6 +289,8 @@
 #define TINY_BASIC_RUNTIME_ERROR  _T("Runtime error: %s\n")
 #define TINY_BASIC_PARSE_ERROR    _T("Parse error: %s\n")
 #define TINY_BASIC_FILE_ERROR     _T("Error: cannot open file %s\n")
+#define TINY_BASIC_GOSUB_HIGH_WATER _T("GOSUB stack high-water mark: %d of %d\n")
+#define TINY_BASIC_BATCH_STATUS   _T("%s: exit status %d\n")
 
 #define TINY_BASIC_ENABLE		  _T("enabled")
 #define TINY_BASIC_DISABLE		  _T("disabled")
@@ -249,6 +299,9 @@
 #define TINY_BASIC_IMPLIED		  _T("implied")
 #define TINY_BASIC_MANDATORY      _T("mandatory")
 
+#define TINY_BASIC_BYTECODE		  _T("bytecode")
+#define TINY_BASIC_TREE		      _T("tree")
+
 #endif
 
 
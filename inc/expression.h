@@ -11,6 +11,10 @@
 #define __EXPRESSION_H__
 
 
+/* pre-requisite headers */
+#include "arena.h"
+
+
 /* Forward Declarations */
 typedef struct expression_node ExpressionNode;
 typedef struct right_hand_term RightHandTerm;
@@ -97,80 +101,48 @@ typedef struct expression_node {
 
 /*
  * Constructor for a factor
- * returns:
- *   FactorNode*   the new factor
- */
-FactorNode *factor_create (void);
-
-/*
- * Destructor for a factor
  * params:
- *   FactorNode*   factor   the doomed factor
+ *   Arena*   arena   the arena holding the program
+ * returns:
+ *   FactorNode*      the new factor
  */
-void factor_destroy (FactorNode *factor);
+FactorNode *factor_create (Arena *arena);
 
 /*
  * Constructor for a right-hand factor of a term
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   RightHandFactor*   the new RH factor of a term
  */
-RightHandFactor *rhfactor_create (void);
-
-/*
- * Recursive destructor for a right-hand factor of a term
- * params:
- *   RightHandFactor*   rhterm   the doomed RH factor of a term
- */
-void rhfactor_destroy (RightHandFactor *rhterm);
+RightHandFactor *rhfactor_create (Arena *arena);
 
 /*
  * Constructor for a term
- * returns:
- *   TermNode*   the new term
- */
-TermNode *term_create (void);
-
-/*
- * Destructor for a term
  * params:
- *   TermNode*   term   the doomed term
+ *   Arena*   arena   the arena holding the program
+ * returns:
+ *   TermNode*        the new term
  */
-void term_destroy (TermNode *term);
+TermNode *term_create (Arena *arena);
 
 /*
  * Constructor for a right-hand expression
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   RightHandTerm*   the RH term of an expression
  */
-RightHandTerm *rhterm_create (void);
-
-/*
- * Recursive destructor for a right-hand term of an expression
- * params:
- *   RightHandTerm*   rhexpression   the doomed RH expression
- */
-void rhterm_destroy (RightHandTerm *rhterm);
+RightHandTerm *rhterm_create (Arena *arena);
 
 /*
  * Constructor for an expression
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   ExpressionNode*   the new expression
  */
-ExpressionNode *expression_create (void);
-
-/*
- * Destructor for a factor
- * params:
- *   FactorNode*   factor   the doomed factor
- */
-void factor_destroy (FactorNode *factor);
-
-/*
- * Destructor for a expression
- * params:
- *   ExpressionNode*   expression   the doomed expression
- */
-void expression_destroy (ExpressionNode *expression);
+ExpressionNode *expression_create (Arena *arena);
 
 
 #endif
@@ -12,9 +12,12 @@
 
 
 /* included headers */
+#include <stdio.h>
 #include "errors.h"
 #include "options.h"
 #include "statement.h"
+#include "bytecode.h"
+#include "profile.h"
 
 
 /*
@@ -38,6 +41,40 @@ typedef struct interpreter {
    */
   void (*interpret) (Interpreter *, ProgramNode *);
 
+  /*
+   * Interpret a program compiled ahead of time
+   * params:
+   *   Interpreter*   the interpreter to use
+   *   Bytecode*      the compiled program
+   */
+  void (*interpret_compiled) (Interpreter *, Bytecode *);
+
+  /*
+   * Direct the program's input and output to particular streams
+   * params:
+   *   Interpreter*   the interpreter
+   *   FILE*          where INPUT reads from, or NULL for no input
+   *   FILE*          where PRINT writes to
+   */
+  void (*set_streams) (Interpreter *, FILE *, FILE *);
+
+  /*
+   * Measure each line of the program as it runs, using the syntax tree
+   * params:
+   *   Interpreter*   the interpreter
+   *   Profile*       the profile to add to, or NULL for none
+   */
+  void (*set_profile) (Interpreter *, Profile *);
+
+  /*
+   * Return the deepest the GOSUB stack grew during the last run
+   * params:
+   *   Interpreter*   the interpreter
+   * returns:
+   *   int            the GOSUB stack high-water mark
+   */
+  int (*get_gosub_high_water) (Interpreter *);
+
   /*
    * Destructor
    * params:
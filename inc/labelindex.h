@@ -0,0 +1,71 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Line Label Index Header
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+#ifndef __LABELINDEX_H__
+#define __LABELINDEX_H__
+
+
+/* pre-requisite headers */
+#include <stdint.h>
+
+
+/*
+ * Data Definitions
+ */
+
+
+/* an index from line labels to line positions */
+typedef struct {
+  int exact; /* set if only an exact label match will do */
+  int count; /* number of program lines */
+  int lowest; /* the lowest label held in the dense table */
+  int highest; /* the highest label held in the dense table */
+  int *table; /* dense table of line positions, one per label, or NULL */
+  int *keys; /* sorted labels for binary search, or NULL */
+  int *lines; /* line position for each of the keys */
+  int key_count; /* number of keys */
+} LabelIndex;
+
+
+/*
+ * Function Declarations
+ */
+
+
+/*
+ * Build a label index
+ * params:
+ *   int*   labels   the label of each line, in program order
+ *   int    count    the number of lines
+ *   int    exact    !0 to find exact matches only; 0 to find the first
+ *                   line whose label is equal or greater
+ * returns:
+ *   LabelIndex*     the new index, NULL if memory ran out
+ */
+LabelIndex *label_index_create (int *labels, int count, int exact);
+
+/*
+ * Find the line a jump to a label will reach
+ * params:
+ *   LabelIndex*   index   the label index
+ *   intptr_t      label   the label to find
+ * returns:
+ *   int                   position of the line in the program, -1 if none
+ */
+int label_index_find (LabelIndex *index, intptr_t label);
+
+/*
+ * Label index destructor
+ * params:
+ *   LabelIndex*   index   the doomed index
+ */
+void label_index_destroy (LabelIndex *index);
+
+
+#endif
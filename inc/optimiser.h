@@ -0,0 +1,32 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Optimiser Header
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+#ifndef __OPTIMISER_H__
+#define __OPTIMISER_H__
+
+
+/* pre-requisite headers */
+#include "statement.h"
+
+
+/*
+ * Function Declarations
+ */
+
+
+/*
+ * Simplify the expressions of a parsed program in place, folding constants
+ * and removing operations that cannot change a result
+ * params:
+ *   ProgramNode*   program   the program to optimise
+ */
+void optimise_program (ProgramNode *program);
+
+
+#endif
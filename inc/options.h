@@ -29,6 +29,12 @@ typedef enum {
   COMMENTS_DISABLED /* comments and blank lines are not allowed */
 } CommentOption;
 
+/* execution options */
+typedef enum {
+  EXECUTION_BYTECODE, /* compile to bytecode and run it on a virtual machine */
+  EXECUTION_TREE /* walk the syntax tree directly */
+} ExecutionOption;
+
 /* language options */
 typedef struct language_options LanguageOptions;
 typedef struct language_options {
@@ -37,10 +43,14 @@ typedef struct language_options {
   void (*set_line_limit) (LanguageOptions *, int);
   void (*set_comments) (LanguageOptions *, CommentOption);
   void (*set_gosub_limit) (LanguageOptions *, int);
+  void (*set_execution) (LanguageOptions *, ExecutionOption);
+  void (*set_integer_width) (LanguageOptions *, int);
   LineNumberOption (*get_line_numbers) (LanguageOptions *);
   int (*get_line_limit) (LanguageOptions *);
   CommentOption (*get_comments) (LanguageOptions *);
   int (*get_gosub_limit) (LanguageOptions *);
+  ExecutionOption (*get_execution) (LanguageOptions *);
+  int (*get_integer_width) (LanguageOptions *);
   void (*destroy) (LanguageOptions *);
 } LanguageOptions;
 
@@ -63,6 +63,14 @@ typedef struct parser {
    */
   int (*get_label) (Parser *);
 
+  /*
+   * Set the number of threads used to parse a large program
+   * params:
+   *   Parser*   The parser to use
+   *   int       the number of threads, 0 for one per CPU
+   */
+  void (*set_jobs) (Parser *, int);
+
   /*
    * Destroy this parser object
    * params:
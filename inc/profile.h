@@ -0,0 +1,150 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Execution Profile Header
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+
+/* pre-requisite headers */
+#include "common.h"
+#include "statement.h"
+
+
+/*
+ * Data Definitions
+ */
+
+
+/* what has been measured for one program line */
+typedef struct {
+  ProgramLineNode *line; /* the program line */
+  int position; /* position of the line in the program */
+  unsigned long long count; /* number of times the line has run */
+  unsigned long long time; /* clock ticks spent running it */
+} ProfileLine;
+
+/* a program line's address and its place in the profile */
+typedef struct {
+  ProgramLineNode *line; /* the program line */
+  int position; /* position of the line in the program */
+} ProfileIndex;
+
+/* a chain of active GOSUBs: one node of the tree of calls made */
+typedef struct {
+  int parent; /* the frame that made the call, -1 for the main program */
+  int entry; /* position of the subroutine's first line */
+  int child; /* the first call made from this frame, -1 if none */
+  int sibling; /* the next call made from the parent frame, -1 if none */
+} ProfileFrame;
+
+/* the time spent on a line under a particular chain of GOSUBs */
+typedef struct {
+  int frame; /* the frame, -1 if this slot is unused */
+  int position; /* position of the line in the program */
+  unsigned long long time; /* clock ticks spent on it */
+} ProfileStack;
+
+/* an execution profile of a program */
+typedef struct {
+  ProfileLine *lines; /* measurements for each line, in program order */
+  ProfileIndex *index; /* the lines sorted by address for searching */
+  int line_count; /* number of lines */
+  int last; /* position of the line last counted */
+  unsigned long long start_ticks; /* the clock when the profile began */
+  unsigned long long start_time; /* nanoseconds when the profile began */
+  ProfileFrame *frames; /* the call tree, or NULL if stacks aren't kept */
+  int frame_count; /* number of frames in the call tree */
+  int frame_size; /* number of frames there is room for */
+  int frame; /* the frame of the line being run */
+  int next_frame; /* the frame of the line to run next */
+  ProfileStack *stacks; /* hash table of times by frame and line */
+  int stack_count; /* number of slots used in the hash table */
+  int stack_size; /* number of slots in the table, a power of 2 */
+  int failed; /* set if memory ran out while keeping stacks */
+} Profile;
+
+
+/*
+ * Function Declarations
+ */
+
+
+/*
+ * Profile constructor
+ * params:
+ *   ProgramNode*   program   the program to be profiled
+ *   int            stacks    !0 to keep times by chain of GOSUBs as well
+ * returns:
+ *   Profile*                 the new profile, NULL if memory ran out
+ */
+Profile *profile_create (ProgramNode *program, int stacks);
+
+/*
+ * Read the clock used to time lines, the processor's time stamp counter
+ * where there is one
+ * returns:
+ *   unsigned long long   ticks from some fixed point
+ */
+unsigned long long profile_clock (void);
+
+/*
+ * Count one run of a line
+ * params:
+ *   Profile*             profile   the profile
+ *   ProgramLineNode*     line      the line that ran
+ *   unsigned long long   time      clock ticks it took
+ */
+void profile_count (Profile *profile, ProgramLineNode *line,
+  unsigned long long time);
+
+/*
+ * Note a GOSUB made by the line being run
+ * params:
+ *   Profile*           profile   the profile
+ *   ProgramLineNode*   line      the first line of the subroutine
+ */
+void profile_call (Profile *profile, ProgramLineNode *line);
+
+/*
+ * Note a RETURN made by the line being run
+ * params:
+ *   Profile*   profile   the profile
+ */
+void profile_return (Profile *profile);
+
+/*
+ * Write a report of the lines that ran, the longest-running first
+ * params:
+ *   Profile*       profile    the profile
+ *   const TCHAR*   filename   the file to write
+ * returns:
+ *   int                       !0 on success, 0 if the file couldn't be written
+ */
+int profile_write (Profile *profile, const TCHAR *filename);
+
+/*
+ * Write the time spent on each line under each chain of GOSUBs, in the
+ * collapsed stack format read by flame graph tools
+ * params:
+ *   Profile*       profile    the profile, which must have kept stacks
+ *   const TCHAR*   filename   the file to write
+ * returns:
+ *   int                       !0 on success, 0 if the file couldn't be written
+ */
+int profile_write_stacks (Profile *profile, const TCHAR *filename);
+
+/*
+ * Profile destructor
+ * params:
+ *   Profile*   profile   the doomed profile
+ */
+void profile_destroy (Profile *profile);
+
+
+#endif
@@ -99,11 +99,13 @@ typedef struct {
 /* Goto Statement Node */
 typedef struct {
   ExpressionNode *label; /* an expression that computes the label */
+  ProgramLineNode *target; /* the line to go to, if the label is constant */
 } GotoStatementNode;
 
 /* Gosub Statement Node */
 typedef struct {
   ExpressionNode *label; /* an expression that computes the label */
+  ProgramLineNode *target; /* the line to call, if the label is constant */
 } GosubStatementNode;
 
 /* Statement classes */
@@ -149,6 +151,7 @@ typedef struct program_line_node {
 /* the program */
 typedef struct {
   ProgramLineNode *first; /* first program statement */
+  Arena *arena; /* holds every node of the program */
 } ProgramNode;
 
 
@@ -159,91 +162,91 @@ typedef struct {
 
 /*
  * LET statement constructor
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   LetStatementNode*   the created LET statement
  */
-LetStatementNode *statement_create_let (void);
+LetStatementNode *statement_create_let (Arena *arena);
 
 /*
  * IF statement constructor
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   IfStatementNode*   the created IF statement
  */
-IfStatementNode *statement_create_if (void);
+IfStatementNode *statement_create_if (Arena *arena);
 
 /*
  * GOTO Statement Constructor
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   GotoStatementNode*   the new GOTO statement
  */
-GotoStatementNode *statement_create_goto (void);
+GotoStatementNode *statement_create_goto (Arena *arena);
 
 /*
  * GOSUB Statement Constructor
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   GosubStatementNode*   the new GOSUB statement
  */
-GosubStatementNode *statement_create_gosub (void);
+GosubStatementNode *statement_create_gosub (Arena *arena);
 
 /*
  * PRINT statement constructor
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   PrintStatementNode*   the created PRINT statement
  */
-PrintStatementNode *statement_create_print (void);
+PrintStatementNode *statement_create_print (Arena *arena);
 
 /*
  * INPUT statement constructor
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   InputStatementNode*   initialised INPUT statement data
  */
-InputStatementNode *statement_create_input (void);
+InputStatementNode *statement_create_input (Arena *arena);
 
-PeekStatementNode* statement_create_peek(void);
-void statement_destroy_peek(PeekStatementNode* poken);
+PeekStatementNode* statement_create_peek(Arena* arena);
 
-PokeStatementNode* statement_create_poke(void);
-void statement_destroy_poke(PokeStatementNode* poken);
+PokeStatementNode* statement_create_poke(Arena* arena);
 
 /*
  * Statement constructor
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   StatementNode*   the newly-created blank statement
  */
-StatementNode *statement_create (void);
-
-/*
- * Statement destructor
- * params:
- *   StatementNode*   statement   the doomed statement
- */
-void statement_destroy (StatementNode *statement);
+StatementNode *statement_create (Arena *arena);
 
 /*
  * Program Line Constructor
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   ProgramLineNode*   the new program line
  */
-ProgramLineNode *program_line_create (void);
-
-/*
- * Program Line Destructor
- * params:
- *   ProgramLineNode*   program_line   the doomed program line
- * params:
- *   ProgramLineNode*                  the next program line
- */
-ProgramLineNode *program_line_destroy (ProgramLineNode *program_line);
+ProgramLineNode *program_line_create (Arena *arena);
 
 /*
  * Program Constructor
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   ProgramNode*   the constructed program
  */
-ProgramNode *program_create (void);
+ProgramNode *program_create (Arena *arena);
 
 /*
- * Program Destructor
+ * Program Destructor, releasing the arena and all the nodes in it
  * params:
  *   ProgramNode*   program   the doomed program
  */
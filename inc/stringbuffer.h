@@ -0,0 +1,65 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * String Buffer Header
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+#ifndef __STRINGBUFFER_H__
+#define __STRINGBUFFER_H__
+
+
+/* pre-requisite headers */
+#include <stddef.h>
+#include "common.h"
+
+
+/*
+ * Data Definitions
+ */
+
+
+/* a string that grows as text is appended to it */
+typedef struct {
+  TCHAR *text; /* the text so far, terminated; NULL if memory ran out */
+  size_t length; /* number of characters in the text */
+  size_t size; /* number of characters there is room for */
+} StringBuffer;
+
+
+/*
+ * Function Declarations
+ */
+
+
+/*
+ * Start a string buffer off empty
+ * params:
+ *   StringBuffer*   buffer   the buffer
+ * returns:
+ *   int                      !0 on success, 0 if memory ran out
+ */
+int string_buffer_init (StringBuffer *buffer);
+
+/*
+ * Append text to a string buffer, doubling its room whenever it fills
+ * params:
+ *   StringBuffer*   buffer   the buffer
+ *   const TCHAR*    text     the text to append
+ */
+void string_buffer_append (StringBuffer *buffer, const TCHAR *text);
+
+/*
+ * Take the text from a string buffer, leaving the buffer empty
+ * params:
+ *   StringBuffer*   buffer   the buffer
+ * returns:
+ *   TCHAR*                   the text, for the caller to free; NULL if
+ *                            memory ran out while building it
+ */
+TCHAR *string_buffer_release (StringBuffer *buffer);
+
+
+#endif
@@ -55,20 +55,13 @@ typedef enum
    TOKEN_POKE
   } TokenClass;
 
-/* token structure */
-typedef struct token Token;
-typedef struct token
-{
-  void *data; /* private data */
-  TokenClass (*get_class) (Token *);
-  int (*get_line) (Token *);
-  int (*get_pos) (Token *);
-  TCHAR *(*get_content) (Token *);
-  void (*set_class) (Token *, TokenClass);
-  void (*set_line_pos) (Token *, int, int);
-  void (*set_content) (Token *, TCHAR *);
-  void (*initialise) (Token *, TokenClass, int, int, TCHAR *);
-  void (*destroy) (Token *); /* destructor */
+/* token structure: a small value whose text is viewed in its token stream */
+typedef struct {
+  TokenClass class; /* class of token */
+  int line; /* line on which the token begins */
+  int pos; /* position within the line on which the token begins */
+  const TCHAR *text; /* the token's text, valid until the next token is read */
+  int length; /* length of the text */
 } Token;
 
 
@@ -78,23 +71,18 @@ typedef struct token
 
 
 /*
- * Token constructor without values to initialise
- * returns:
- *   Token*   the created token
- */
-Token *new_Token (void);
-
-/*
- * Token constructor with values to initialise
+ * Token initialiser
  * params:
- *   TokenClass   class     class of token to initialise
- *   int          line      line on which the token occurred
- *   int          pos       character position on which the token occurred
- *   TCHAR*        content   the textual content of the token
+ *   TokenClass     class    class of token to initialise
+ *   int            line     line on which the token occurred
+ *   int            pos      character position on which the token occurred
+ *   const TCHAR*   text     the NUL-terminated text of the token
+ *   int            length   the length of the text
  * returns:
- *   Token*                 the created token
+ *   Token                   the initialised token
  */
-Token *new_Token_init (TokenClass class, int line, int pos, TCHAR *content);
+Token token_init (TokenClass class, int line, int pos, const TCHAR *text,
+  int length);
 
 
 #endif
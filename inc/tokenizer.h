@@ -22,34 +22,24 @@
   */
 
 
-  /* modes of reading */
-typedef enum {
-	DEFAULT_MODE, /* we have no idea what's coming */
-	COMMENT_MODE, /* reading a comment */
-	WORD_MODE, /* reading an identifier or keyword */
-	NUMBER_MODE, /* reading a numeric constant */
-	LESS_THAN_MODE, /* reading an operator staring with < */
-	GREATER_THAN_MODE, /* reading an operator starting with > */
-	STRING_LITERAL_MODE, /* reading a string literal */
-	UNKNOWN_MODE /* we are lost */
-} Mode;
-
-/* current state information */
+/* source text held in memory, scanned by the tokenizer core */
 typedef struct {
-	Token* token; /* token to return */
-	Mode mode; /* current reading mode */
-	int ch; /* last-read character */
-	TCHAR tch;
-	TCHAR* content; /* content of token under construction */
-	int max; /* memory reserved for content */
-} TokeniserState;
+	const TCHAR* cursor; /* the next character to scan */
+	const TCHAR* limit; /* the end of the text */
+	int line, /* line on which the next character lies */
+		pos; /* characters already read from that line */
+	TCHAR* text; /* holds the text of the latest token */
+	int length; /* length of the text */
+	int text_max; /* memory reserved for the text */
+} Scanner;
 
 /* Token stream */
 typedef struct token_stream TokenStream;
 typedef struct token_stream {
   void *data; /* private data */
-  Token *(*next) (TokenStream *);
+  Token (*next) (TokenStream *);
   int (*get_line) (TokenStream *);
+  const TCHAR *(*get_text) (TokenStream *, int *);
   void (*destroy) (TokenStream *);
 } TokenStream;
 
@@ -69,7 +59,26 @@ typedef struct token_stream {
 TokenStream *new_TokenStream (FILE *input);
 TokenStream* new_BufferTokenStream(const TCHAR* input, int buffer_size);
 TokenClass identify_symbol(int ch);
-TokenClass identify_word(const TCHAR* word);
+TokenClass identify_word(const TCHAR* word, int length);
 TokenClass identify_compound_symbol(const TCHAR* symbol);
-void destroy_ts(TokenStream* token_stream);
+
+/*
+ * Prepare a scanner, reserving memory for token text
+ * params:
+ *   Scanner*       scanner   the scanner to prepare
+ *   const TCHAR*   text      the source text, which must outlive the scanner
+ *   int            length    the number of characters in the text
+ * returns:
+ *   int                      !0 if successful, 0 if memory ran out
+ */
+int scanner_init(Scanner* scanner, const TCHAR* text, int length);
+
+/*
+ * Scan the next token from a scanner's text
+ * params:
+ *   Scanner*   scanner   the scanner
+ * returns:
+ *   Token                the token, whose text stays valid until the next scan
+ */
+Token scan_token(Scanner* scanner);
 #endif
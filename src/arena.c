@@ -0,0 +1,187 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Arena Allocator Module
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+/* included headers */
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+
+/*
+ * Internal Data
+ */
+
+
+/* the size of a normal block, enough for a few hundred lines of program */
+#define BLOCK_SIZE 16384
+
+/* the strictest alignment any node needs */
+typedef union {
+  long long integer; /* the widest integer */
+  double real; /* the widest real */
+  void *pointer; /* a pointer */
+} ArenaAlign;
+#define ALIGNMENT sizeof (ArenaAlign)
+
+/* the space a block header takes before its memory, kept aligned */
+#define HEADER_SIZE \
+  ((sizeof (ArenaBlock) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT)
+
+
+/*
+ * Level 1 Functions
+ */
+
+
+/*
+ * Allocate a new block
+ * params:
+ *   size_t   size   the bytes the block must be able to hand out
+ * returns:
+ *   ArenaBlock*     the new block, NULL if memory ran out
+ */
+static ArenaBlock *create_block (size_t size) {
+
+  /* local variables */
+  ArenaBlock *block; /* the new block */
+
+  /* allocate the header and memory together */
+  if (! (block = malloc (HEADER_SIZE + size)))
+    return NULL;
+  block->next = NULL;
+  block->size = size;
+  block->used = 0;
+  return block;
+}
+
+
+/*
+ * Public Functions
+ */
+
+
+/*
+ * Arena constructor
+ * returns:
+ *   Arena*   the new arena, NULL if memory ran out
+ */
+Arena *arena_create (void) {
+
+  /* local variables */
+  Arena *arena; /* the new arena */
+
+  /* allocate the arena and its first block */
+  if (! (arena = malloc (sizeof (Arena))))
+    return NULL;
+  if (! (arena->current = create_block (BLOCK_SIZE))) {
+    free (arena);
+    return NULL;
+  }
+  return arena;
+}
+
+/*
+ * Allocate memory from an arena
+ * params:
+ *   Arena*   arena   the arena
+ *   size_t   size    the number of bytes required
+ * returns:
+ *   void*            the memory, NULL if memory ran out
+ */
+void *arena_alloc (Arena *arena, size_t size) {
+
+  /* local variables */
+  ArenaBlock *block; /* the block to allocate from */
+  void *memory; /* the memory allocated */
+
+  /* keep every allocation aligned */
+  size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+  /* oversized requests get a block of their own behind the current one */
+  if (size > BLOCK_SIZE / 4) {
+    if (! (block = create_block (size)))
+      return NULL;
+    block->next = arena->current->next;
+    arena->current->next = block;
+  }
+
+  /* otherwise start a new block when the current one is full */
+  else if (arena->current->used + size > arena->current->size) {
+    if (! (block = create_block (BLOCK_SIZE)))
+      return NULL;
+    block->next = arena->current;
+    arena->current = block;
+  }
+  else
+    block = arena->current;
+
+  /* bump the pointer */
+  memory = (char *) block + HEADER_SIZE + block->used;
+  block->used += size;
+  return memory;
+}
+
+/*
+ * Copy a string into an arena
+ * params:
+ *   Arena*         arena    the arena
+ *   const TCHAR*   string   the string to copy
+ * returns:
+ *   TCHAR*                  the copy, NULL if memory ran out
+ */
+TCHAR *arena_strdup (Arena *arena, const TCHAR *string) {
+
+  /* local variables */
+  TCHAR *copy; /* the copy */
+
+  /* allocate and copy */
+  if ((copy = arena_alloc (arena, (strlen (string) + 1) * sizeof (TCHAR))))
+    strcpy (copy, string);
+  return copy;
+}
+
+/*
+ * Move everything allocated from another arena into an arena
+ * params:
+ *   Arena*   arena   the arena to receive the memory
+ *   Arena*   other   the arena to give it up, which is destroyed
+ */
+void arena_adopt (Arena *arena, Arena *other) {
+
+  /* local variables */
+  ArenaBlock *last; /* the last of the other arena's blocks */
+
+  /* chain the other blocks in behind the current one, which stays in use */
+  if (other) {
+    for (last = other->current; last->next; last = last->next);
+    last->next = arena->current->next;
+    arena->current->next = other->current;
+    free (other);
+  }
+}
+
+/*
+ * Arena destructor, releasing everything allocated from it
+ * params:
+ *   Arena*   arena   the doomed arena
+ */
+void arena_destroy (Arena *arena) {
+
+  /* local variables */
+  ArenaBlock *block; /* the block to release */
+
+  /* release the blocks, then the arena itself */
+  if (arena) {
+    while ((block = arena->current)) {
+      arena->current = block->next;
+      free (block);
+    }
+    free (arena);
+  }
+}
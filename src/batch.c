@@ -0,0 +1,428 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Batch Runner Module
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+/* included headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#ifdef USE_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#include "batch.h"
+#include "errors.h"
+#include "parser.h"
+#include "interpret.h"
+#include "optimiser.h"
+
+
+/*
+ * Data Definitions
+ */
+
+
+/* finished programs each worker may hold ahead of the one being reported,
+   to bound the temporary files open at once */
+#define BATCH_WINDOW 4
+
+/* a program waiting to run, running or finished */
+typedef struct {
+  TCHAR *program; /* the program filename */
+  TCHAR *input; /* the file to supply INPUT, or NULL */
+  FILE *output; /* holds the program's output until its turn to print */
+  ErrorCode status; /* the exit status */
+  int done; /* set when the program has finished */
+} BatchJob;
+
+/* private data */
+typedef struct batch_data {
+  BatchJob *jobs; /* the programs in the batch */
+  int count; /* number of programs */
+  int capacity; /* number of programs there is room for */
+  int next; /* the next program for a worker to take */
+  int reported; /* the next program to report */
+  int window; /* programs that may be taken past the next to report */
+  LanguageOptions *options; /* the language options */
+#ifdef USE_THREADS
+  pthread_mutex_t lock; /* guards next, reported and the done flags */
+  pthread_cond_t finished; /* signalled when a program finishes */
+  pthread_cond_t room; /* signalled when a program has been reported */
+#endif
+} BatchData;
+
+
+/*
+ * Level 1 Functions
+ */
+
+
+/*
+ * Parse and run a single program, capturing its output
+ * params:
+ *   Batch*      batch   the batch
+ *   BatchJob*   job     the program to run
+ */
+static void run_job (Batch *batch, BatchJob *job) {
+
+  /* local variables */
+  ErrorHandler *errors; /* the program's error handler */
+  Parser *parser; /* the program's parser */
+  Interpreter *interpreter; /* the program's interpreter */
+  ProgramNode *program; /* the parsed program */
+  FILE
+    *source, /* the program file */
+    *input = NULL; /* the file supplying INPUT */
+  TCHAR *error_text; /* error text message */
+
+  /* set up the output and error handling */
+  job->status = E_NONE;
+  if (! (job->output = tmpfile ())) {
+    job->status = E_MEMORY;
+    return;
+  }
+  if (! (errors = new_ErrorHandler ())) {
+    job->status = E_MEMORY;
+    return;
+  }
+
+  /* open the program and its input */
+  if (! (source = fopen (job->program, _T("r")))) {
+    fprintf (job->output, TINY_BASIC_FILE_ERROR, job->program);
+    job->status = E_FILE_NOT_FOUND;
+  }
+  else if (job->input && ! (input = fopen (job->input, _T("r")))) {
+    fprintf (job->output, TINY_BASIC_FILE_ERROR, job->input);
+    job->status = E_FILE_NOT_FOUND;
+    fclose (source);
+  }
+
+  /* parse the program, then run it */
+  if (! job->status) {
+    parser = new_Parser (errors, batch->priv->options, source);
+    program = parser->parse (parser);
+    parser->destroy (parser);
+    fclose (source);
+    if ((job->status = errors->get_code (errors))) {
+      error_text = errors->get_text (errors);
+      fprintf (job->output, TINY_BASIC_PARSE_ERROR, error_text);
+      free (error_text);
+    } else {
+      optimise_program (program);
+      interpreter = new_Interpreter (errors, batch->priv->options);
+      interpreter->set_streams (interpreter, input, job->output);
+      interpreter->interpret (interpreter, program);
+      if ((job->status = errors->get_code (errors))) {
+        error_text = errors->get_text (errors);
+        fprintf (job->output, TINY_BASIC_RUNTIME_ERROR, error_text);
+        free (error_text);
+      }
+      interpreter->destroy (interpreter);
+    }
+    if (program)
+      program_destroy (program);
+  }
+
+  /* tidy up */
+  if (input)
+    fclose (input);
+  errors->destroy (errors);
+}
+
+/*
+ * Print a finished program's output and exit status
+ * params:
+ *   BatchJob*   job   the finished program
+ */
+static void report_job (BatchJob *job) {
+
+  /* local variables */
+  char buffer[4096]; /* a chunk of the output */
+  size_t size; /* the size of the chunk */
+
+  /* copy the captured output to stdout */
+  if (job->output) {
+    rewind (job->output);
+    while ((size = fread (buffer, 1, sizeof (buffer), job->output)))
+      fwrite (buffer, 1, size, stdout);
+    fclose (job->output);
+    job->output = NULL;
+  }
+
+  /* report the status once the output is out */
+  fflush (stdout);
+  fprintf (stderr, TINY_BASIC_BATCH_STATUS, job->program, job->status);
+}
+
+#ifdef USE_THREADS
+/*
+ * Worker thread: take programs from the batch until none are left
+ * params:
+ *   void*   arg   the batch
+ * returns:
+ *   void*         NULL
+ */
+static void *worker (void *arg) {
+
+  /* local variables */
+  Batch *batch = arg; /* the batch */
+  BatchData *data = batch->priv; /* the private data */
+  BatchJob *job; /* the program being run */
+
+  /* run programs until the batch is exhausted, keeping within the window */
+  for (;;) {
+    pthread_mutex_lock (&data->lock);
+    while (data->next < data->count
+      && data->next >= data->reported + data->window)
+      pthread_cond_wait (&data->room, &data->lock);
+    job = data->next < data->count
+      ? &data->jobs[data->next++]
+      : NULL;
+    pthread_mutex_unlock (&data->lock);
+    if (! job)
+      break;
+    run_job (batch, job);
+    pthread_mutex_lock (&data->lock);
+    job->done = 1;
+    pthread_cond_broadcast (&data->finished);
+    pthread_mutex_unlock (&data->lock);
+  }
+  return NULL;
+}
+#endif
+
+
+/*
+ * Public Methods
+ */
+
+
+/*
+ * Add a program to the batch
+ * params:
+ *   Batch*   batch     the batch
+ *   TCHAR*   program   the program filename
+ *   TCHAR*   input     the file to supply its INPUT, or NULL for none
+ * returns:
+ *   int                !0 if successful, 0 if memory ran out
+ */
+static int add_program (Batch *batch, TCHAR *program, TCHAR *input) {
+
+  /* local variables */
+  BatchData *data = batch->priv; /* the private data */
+  BatchJob *jobs; /* the enlarged job list */
+  int capacity; /* the enlarged capacity */
+
+  /* make room for the program */
+  if (data->count == data->capacity) {
+    capacity = data->capacity ? 2 * data->capacity : 16;
+    if (! (jobs = realloc (data->jobs, capacity * sizeof (BatchJob))))
+      return 0;
+    data->jobs = jobs;
+    data->capacity = capacity;
+  }
+
+  /* add it */
+  data->jobs[data->count].program = _strdup (program);
+  data->jobs[data->count].input = input ? _strdup (input) : NULL;
+  data->jobs[data->count].output = NULL;
+  data->jobs[data->count].status = E_NONE;
+  data->jobs[data->count].done = 0;
+  if (! data->jobs[data->count].program
+    || (input && ! data->jobs[data->count].input)) {
+    free (data->jobs[data->count].program);
+    free (data->jobs[data->count].input);
+    return 0;
+  }
+  ++data->count;
+  return 1;
+}
+
+/*
+ * Add the programs listed in a manifest
+ * params:
+ *   Batch*   batch      the batch
+ *   TCHAR*   manifest   the manifest filename
+ * returns:
+ *   int                 !0 if successful, 0 if the manifest could not be read
+ */
+static int add_manifest (Batch *batch, TCHAR *manifest) {
+
+  /* local variables */
+  FILE *file; /* the manifest file */
+  TCHAR
+    line[1024], /* a line of the manifest */
+    program[512], /* the program named on the line */
+    input[512]; /* the input file named on the line */
+  int
+    fields, /* number of filenames on the line */
+    ok = 1; /* cleared if a program cannot be added */
+
+  /* read each line, skipping blanks and # comments */
+  if (! (file = fopen (manifest, _T("r"))))
+    return 0;
+  while (ok && fgets (line, sizeof (line) / sizeof (TCHAR), file)) {
+    fields = sscanf (line, _T("%511s %511s"), program, input);
+    if (fields >= 1 && *program != _T('#'))
+      ok = add_program (batch, program, fields == 2 ? input : NULL);
+  }
+  fclose (file);
+  return ok;
+}
+
+/*
+ * Run the programs
+ * params:
+ *   Batch*   batch     the batch
+ *   int      workers   the number of worker threads, 0 for one per CPU
+ * returns:
+ *   int                the first non-zero exit status, or 0 if all succeeded
+ */
+static int run (Batch *batch, int workers) {
+
+  /* local variables */
+  BatchData *data = batch->priv; /* the private data */
+  int
+    count, /* counter for programs and workers */
+    status = 0; /* the first non-zero exit status */
+#ifdef USE_THREADS
+  pthread_t *threads = NULL; /* the worker threads */
+  int started = 0; /* number of workers started */
+#endif
+
+  /* start the workers, falling back to running in turn */
+  data->next = 0;
+  data->reported = 0;
+#ifdef USE_THREADS
+  if (workers <= 0)
+    workers = (int) sysconf (_SC_NPROCESSORS_ONLN);
+  if (workers > data->count)
+    workers = data->count;
+  data->window = workers * BATCH_WINDOW;
+  if (workers > 1 && (threads = malloc (workers * sizeof (pthread_t))))
+    for (started = 0; started < workers; ++started)
+      if (pthread_create (&threads[started], NULL, worker, batch))
+        break;
+#endif
+
+  /* report each program in order as soon as it has finished */
+  for (count = 0; count < data->count; ++count) {
+#ifdef USE_THREADS
+    pthread_mutex_lock (&data->lock);
+    while (started && ! data->jobs[count].done)
+      pthread_cond_wait (&data->finished, &data->lock);
+    if (! data->jobs[count].done && data->next <= count) {
+      data->next = count + 1;
+      pthread_mutex_unlock (&data->lock);
+      run_job (batch, &data->jobs[count]);
+    } else
+      pthread_mutex_unlock (&data->lock);
+#else
+    run_job (batch, &data->jobs[count]);
+#endif
+    report_job (&data->jobs[count]);
+    if (! status)
+      status = data->jobs[count].status;
+#ifdef USE_THREADS
+    pthread_mutex_lock (&data->lock);
+    data->reported = count + 1;
+    pthread_cond_broadcast (&data->room);
+    pthread_mutex_unlock (&data->lock);
+#endif
+  }
+
+  /* wait for the workers to finish */
+#ifdef USE_THREADS
+  for (count = 0; count < started; ++count)
+    pthread_join (threads[count], NULL);
+  free (threads);
+#endif
+  return status;
+}
+
+/*
+ * Destructor
+ * params:
+ *   Batch*   batch   the doomed batch
+ */
+static void destroy (Batch *batch) {
+
+  /* local variables */
+  int count; /* counter for programs */
+
+  /* free the programs, then the batch itself */
+  if (batch) {
+    if (batch->priv) {
+      for (count = 0; count < batch->priv->count; ++count) {
+        free (batch->priv->jobs[count].program);
+        free (batch->priv->jobs[count].input);
+        if (batch->priv->jobs[count].output)
+          fclose (batch->priv->jobs[count].output);
+      }
+      free (batch->priv->jobs);
+#ifdef USE_THREADS
+      pthread_mutex_destroy (&batch->priv->lock);
+      pthread_cond_destroy (&batch->priv->finished);
+      pthread_cond_destroy (&batch->priv->room);
+#endif
+      free (batch->priv);
+    }
+    free (batch);
+  }
+}
+
+
+/*
+ * Constructors
+ */
+
+
+/*
+ * Constructor
+ * params:
+ *   LanguageOptions*   options   the language options for every program
+ * returns:
+ *   Batch*                       the new batch
+ */
+Batch *new_Batch (LanguageOptions *options) {
+
+  /* local variables */
+  Batch *batch; /* the new batch */
+
+  /* allocate memory */
+  if (! (batch = malloc (sizeof (Batch))))
+    return NULL;
+  if (! (batch->priv = malloc (sizeof (BatchData)))) {
+    free (batch);
+    return NULL;
+  }
+
+  /* initialise methods */
+  batch->add_program = add_program;
+  batch->add_manifest = add_manifest;
+  batch->run = run;
+  batch->destroy = destroy;
+
+  /* initialise properties */
+  batch->priv->jobs = NULL;
+  batch->priv->count = 0;
+  batch->priv->capacity = 0;
+  batch->priv->next = 0;
+  batch->priv->reported = 0;
+  batch->priv->window = 0;
+  batch->priv->options = options;
+#ifdef USE_THREADS
+  pthread_mutex_init (&batch->priv->lock, NULL);
+  pthread_cond_init (&batch->priv->finished, NULL);
+  pthread_cond_init (&batch->priv->room, NULL);
+#endif
+
+  /* return the new object */
+  return batch;
+}
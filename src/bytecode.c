@@ -0,0 +1,1089 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Bytecode Compiler Module
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+/* included headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include "common.h"
+#ifdef USE_MMAP
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "errors.h"
+#include "statement.h"
+#include "expression.h"
+#include "bytecode.h"
+
+
+/*
+ * Internal Data
+ */
+
+
+/* a jump operand awaiting the address of its target line */
+typedef struct {
+  ProgramLineNode *target; /* the target line */
+  int operand; /* where the address is to be stored */
+} JumpPatch;
+
+/* a program line and where its code starts, for resolving jumps */
+typedef struct {
+  ProgramLineNode *line; /* the program line */
+  int address; /* the address of its code */
+} LineAddress;
+
+/* state of the compilation */
+typedef struct {
+  Bytecode *bytecode; /* the bytecode being built */
+  int code_capacity; /* cells reserved for the code */
+  int string_capacity; /* entries reserved for the strings */
+  int depth; /* current depth of the value stack */
+  int *patches; /* operands to point at the next line */
+  int patch_count; /* number of operands awaiting the next line */
+  int patch_capacity; /* entries reserved for the patches */
+  JumpPatch *jumps; /* operands to point at constant targets */
+  int jump_count; /* number of operands awaiting their targets */
+  int jump_capacity; /* entries reserved for the jumps */
+  int failed; /* set when memory runs out */
+} CompilerState;
+
+/* identifies a cache file, and the version of its layout */
+#define CACHE_MAGIC "TBC\032"
+#define CACHE_VERSION 3
+
+/* the header of a cache file, which is followed by the code, the line
+   labels, the line addresses, the string offsets and the strings */
+typedef struct {
+  char magic[4]; /* CACHE_MAGIC */
+  int version; /* CACHE_VERSION */
+  long long source_size; /* the size of the source file */
+  long long source_time; /* when the source file was last modified */
+  unsigned long long source_hash; /* FNV-1a hash of the source file */
+  int cell_size; /* the size of a code cell */
+  int char_size; /* the size of a string character */
+  int operations; /* OP_LAST, which changes with the operations */
+  int line_numbers; /* the line number option */
+  int line_limit; /* the line number limit */
+  int comments; /* the comment option */
+  int integer_width; /* the integer width */
+  int code_size; /* number of cells in the code */
+  int line_count; /* number of program lines */
+  int string_count; /* number of string constants */
+  int string_size; /* characters in the strings, terminators included */
+  int max_stack; /* the deepest the value stack will grow */
+} CacheHeader;
+
+/* what the loader finds at each cell of the code */
+#define CELL_OPERATION 1 /* an operation starts here */
+#define CELL_TARGET 2 /* a line starts here, or the final HALT */
+
+
+/*
+ * Forward References
+ */
+
+
+/* compile_factor() has a forward reference to compile_expression() */
+static void compile_expression (CompilerState *state,
+  ExpressionNode *expression);
+
+/* compile_if() has a forward reference to compile_statement() */
+static void compile_statement (CompilerState *state, StatementNode *statement);
+
+
+/*
+ * Level 3 Functions
+ */
+
+
+/*
+ * Append a cell to the code
+ * params:
+ *   CompilerState*   state   the compilation state
+ *   int              cell    the operation or operand to append
+ */
+static void emit (CompilerState *state, int cell) {
+
+  /* local variables */
+  int *code; /* the enlarged code block */
+
+  /* enlarge the code block if necessary */
+  if (state->failed)
+    return;
+  if (state->bytecode->code_size == state->code_capacity) {
+    code = realloc (state->bytecode->code,
+      2 * state->code_capacity * sizeof (int));
+    if (code == NULL) {
+      state->failed = 1;
+      return;
+    }
+    state->bytecode->code = code;
+    state->code_capacity *= 2;
+  }
+
+  /* store the cell */
+  state->bytecode->code[state->bytecode->code_size++] = cell;
+}
+
+/*
+ * Record a change in the value stack depth
+ * params:
+ *   CompilerState*   state    the compilation state
+ *   int              change   how many values are pushed (or popped)
+ */
+static void adjust_depth (CompilerState *state, int change) {
+  state->depth += change;
+  if (state->depth > state->bytecode->max_stack)
+    state->bytecode->max_stack = state->depth;
+}
+
+/*
+ * Emit an operand that will hold the address of the following line
+ * params:
+ *   CompilerState*   state   the compilation state
+ */
+static void emit_next_line (CompilerState *state) {
+
+  /* local variables */
+  int *patches; /* the enlarged patch list */
+
+  /* enlarge the patch list if necessary */
+  if (state->patch_count == state->patch_capacity) {
+    patches = realloc (state->patches,
+      2 * state->patch_capacity * sizeof (int));
+    if (patches == NULL) {
+      state->failed = 1;
+      return;
+    }
+    state->patches = patches;
+    state->patch_capacity *= 2;
+  }
+
+  /* remember where the operand is, and leave room for it */
+  state->patches[state->patch_count++] = state->bytecode->code_size;
+  emit (state, 0);
+}
+
+/*
+ * Emit an operand that will hold the address of a target line
+ * params:
+ *   CompilerState*     state    the compilation state
+ *   ProgramLineNode*   target   the target line
+ */
+static void emit_target (CompilerState *state, ProgramLineNode *target) {
+
+  /* local variables */
+  JumpPatch *jumps; /* the enlarged jump list */
+
+  /* enlarge the jump list if necessary */
+  if (state->jump_count == state->jump_capacity) {
+    jumps = realloc (state->jumps,
+      2 * state->jump_capacity * sizeof (JumpPatch));
+    if (jumps == NULL) {
+      state->failed = 1;
+      return;
+    }
+    state->jumps = jumps;
+    state->jump_capacity *= 2;
+  }
+
+  /* remember where the operand is, and leave room for it */
+  state->jumps[state->jump_count].target = target;
+  state->jumps[state->jump_count++].operand = state->bytecode->code_size;
+  emit (state, 0);
+}
+
+/*
+ * Compare two line addresses by the line they belong to
+ * params:
+ *   const void*   a   the first line address
+ *   const void*   b   the second line address
+ * returns:
+ *   int               <0, 0 or >0 as a sorts before, level with or after b
+ */
+static int compare_lines (const void *a, const void *b) {
+  const LineAddress
+    *left = a, /* the first line address */
+    *right = b; /* the second line address */
+  if (left->line == right->line)
+    return 0;
+  return (uintptr_t) left->line < (uintptr_t) right->line ? -1 : 1;
+}
+
+
+/*
+ * Level 2 Functions
+ */
+
+
+/*
+ * Compile a factor
+ * params:
+ *   CompilerState*   state    the compilation state
+ *   FactorNode*      factor   the factor to compile
+ */
+static void compile_factor (CompilerState *state, FactorNode *factor) {
+
+  /* push the value */
+  switch (factor->class) {
+    case FACTOR_VARIABLE:
+      emit (state, OP_LOAD);
+      emit (state, factor->data.variable - 1);
+      adjust_depth (state, 1);
+      break;
+    case FACTOR_VALUE:
+      emit (state, OP_PUSH);
+      emit (state, factor->sign == SIGN_NEGATIVE
+        ? -factor->data.value
+        : factor->data.value);
+      adjust_depth (state, 1);
+      return;
+    case FACTOR_EXPRESSION:
+      compile_expression (state, factor->data.expression);
+      break;
+    default:
+      break;
+  }
+
+  /* apply the sign and check the range of what we have */
+  if (factor->sign == SIGN_NEGATIVE)
+    emit (state, OP_NEGATE);
+#ifdef USE_LIMIT_RESULT
+  emit (state, OP_LIMIT);
+#endif
+}
+
+/*
+ * Compile a term
+ * params:
+ *   CompilerState*   state   the compilation state
+ *   TermNode*        term    the term to compile
+ */
+static void compile_term (CompilerState *state, TermNode *term) {
+
+  /* local variables */
+  RightHandFactor *rhfactor; /* pointer to successive rh factor nodes */
+
+  /* compile the first factor, then the operators and following factors */
+  compile_factor (state, term->factor);
+  for (rhfactor = term->next; rhfactor; rhfactor = rhfactor->next) {
+    compile_factor (state, rhfactor->factor);
+    switch (rhfactor->op) {
+      case TERM_OPERATOR_MULTIPLY:
+        emit (state, OP_MULTIPLY);
+        break;
+      case TERM_OPERATOR_DIVIDE:
+        emit (state, OP_DIVIDE);
+        break;
+      default:
+        break;
+    }
+    adjust_depth (state, -1);
+  }
+}
+
+/*
+ * Compile an expression
+ * params:
+ *   CompilerState*    state        the compilation state
+ *   ExpressionNode*   expression   the expression to compile
+ */
+static void compile_expression (CompilerState *state,
+  ExpressionNode *expression) {
+
+  /* local variables */
+  RightHandTerm *rhterm; /* pointer to successive rh term nodes */
+
+  /* compile the first term, then the operators and following terms */
+  compile_term (state, expression->term);
+  for (rhterm = expression->next; rhterm; rhterm = rhterm->next) {
+    compile_term (state, rhterm->term);
+    switch (rhterm->op) {
+      case EXPRESSION_OPERATOR_PLUS:
+        emit (state, OP_ADD);
+        break;
+      case EXPRESSION_OPERATOR_MINUS:
+        emit (state, OP_SUBTRACT);
+        break;
+      default:
+        break;
+    }
+    adjust_depth (state, -1);
+  }
+}
+
+/*
+ * Add a string to the string constants
+ * params:
+ *   CompilerState*   state    the compilation state
+ *   TCHAR*           string   the string to add
+ * returns:
+ *   int                       the index of the string
+ */
+static int add_string (CompilerState *state, TCHAR *string) {
+
+  /* local variables */
+  Bytecode *bytecode = state->bytecode; /* the bytecode being built */
+  TCHAR **strings; /* the enlarged string list */
+  TCHAR *copy; /* copy of the string */
+
+  /* enlarge the string list if necessary */
+  if (bytecode->string_count == state->string_capacity) {
+    strings = realloc (bytecode->strings,
+      2 * state->string_capacity * sizeof (TCHAR *));
+    if (strings == NULL) {
+      state->failed = 1;
+      return 0;
+    }
+    bytecode->strings = strings;
+    state->string_capacity *= 2;
+  }
+
+  /* copy the string into the list */
+  if (! (copy = _malloc (strlen (string) + 1))) {
+    state->failed = 1;
+    return 0;
+  }
+  strcpy (copy, string);
+  bytecode->strings[bytecode->string_count] = copy;
+  return bytecode->string_count++;
+}
+
+
+/*
+ * Level 1 Functions
+ */
+
+
+/*
+ * Compile an IF statement
+ * params:
+ *   CompilerState*     state   the compilation state
+ *   IfStatementNode*   ifn     the IF statement details
+ */
+static void compile_if (CompilerState *state, IfStatementNode *ifn) {
+
+  /* compile the comparison */
+  compile_expression (state, ifn->left);
+  compile_expression (state, ifn->right);
+  switch (ifn->op) {
+    case RELOP_EQUAL: emit (state, OP_IF_EQUAL); break;
+    case RELOP_UNEQUAL: emit (state, OP_IF_UNEQUAL); break;
+    case RELOP_LESSTHAN: emit (state, OP_IF_LESSTHAN); break;
+    case RELOP_LESSOREQUAL: emit (state, OP_IF_LESSOREQUAL); break;
+    case RELOP_GREATERTHAN: emit (state, OP_IF_GREATERTHAN); break;
+    case RELOP_GREATEROREQUAL: emit (state, OP_IF_GREATEROREQUAL); break;
+  }
+  emit_next_line (state);
+  adjust_depth (state, -2);
+
+  /* compile the conditional statement */
+  compile_statement (state, ifn->statement);
+}
+
+/*
+ * Compile a PRINT statement
+ * params:
+ *   CompilerState*        state    the compilation state
+ *   PrintStatementNode*   printn   the PRINT statement details
+ */
+static void compile_print (CompilerState *state, PrintStatementNode *printn) {
+
+  /* local variables */
+  OutputNode *outn; /* current output node */
+
+  /* print each of the output items, then the linefeed */
+  for (outn = printn->first; outn; outn = outn->next)
+    switch (outn->class) {
+      case OUTPUT_STRING:
+        emit (state, OP_PRINT_STRING);
+        emit (state, add_string (state, outn->output.string));
+        break;
+      case OUTPUT_EXPRESSION:
+        compile_expression (state, outn->output.expression);
+        emit (state, OP_PRINT_NUMBER);
+        adjust_depth (state, -1);
+        break;
+    }
+  emit (state, OP_PRINT_LINE);
+}
+
+/*
+ * Compile an INPUT statement
+ * params:
+ *   CompilerState*        state    the compilation state
+ *   InputStatementNode*   inputn   the INPUT statement details
+ */
+static void compile_input (CompilerState *state, InputStatementNode *inputn) {
+
+  /* local variables */
+  VariableListNode *variable; /* current variable to input */
+  int count = 0; /* number of variables */
+
+  /* emit the variable count followed by the variables */
+  for (variable = inputn->first; variable; variable = variable->next)
+    ++count;
+  emit (state, OP_INPUT);
+  emit (state, count);
+  for (variable = inputn->first; variable; variable = variable->next)
+    emit (state, variable->variable - 1);
+}
+
+/*
+ * Compile a statement
+ * params:
+ *   CompilerState*   state       the compilation state
+ *   StatementNode*   statement   the statement to compile
+ */
+static void compile_statement (CompilerState *state, StatementNode *statement) {
+
+  /* comments compile to nothing */
+  if (! statement)
+    return;
+
+  /* compile real statements */
+  switch (statement->class) {
+    case STATEMENT_LET:
+      compile_expression (state, statement->statement.letn->expression);
+      emit (state, OP_STORE);
+      emit (state, statement->statement.letn->variable - 1);
+      adjust_depth (state, -1);
+      break;
+    case STATEMENT_IF:
+      compile_if (state, statement->statement.ifn);
+      break;
+    case STATEMENT_GOTO:
+      if (statement->statement.goton->target) {
+        emit (state, OP_JUMP);
+        emit_target (state, statement->statement.goton->target);
+      } else {
+        compile_expression (state, statement->statement.goton->label);
+        emit (state, OP_GOTO);
+        adjust_depth (state, -1);
+      }
+      break;
+    case STATEMENT_GOSUB:
+      if (statement->statement.gosubn->target) {
+        emit (state, OP_CALL);
+        emit_target (state, statement->statement.gosubn->target);
+        emit_next_line (state);
+      } else {
+        compile_expression (state, statement->statement.gosubn->label);
+        emit (state, OP_GOSUB);
+        emit_next_line (state);
+        adjust_depth (state, -1);
+      }
+      break;
+    case STATEMENT_RETURN:
+      emit (state, OP_RETURN);
+      break;
+    case STATEMENT_END:
+      emit (state, OP_END);
+      break;
+    case STATEMENT_PRINT:
+      compile_print (state, statement->statement.printn);
+      break;
+    case STATEMENT_INPUT:
+      compile_input (state, statement->statement.inputn);
+      break;
+    case STATEMENT_POKE:
+      compile_expression (state, statement->statement.poken->address);
+      compile_expression (state, statement->statement.poken->value);
+      emit (state, OP_POKE);
+      adjust_depth (state, -2);
+      break;
+    case STATEMENT_PEEK:
+      compile_expression (state, statement->statement.peekn->address);
+      emit (state, OP_PEEK);
+      emit (state, statement->statement.peekn->variable - 1);
+      adjust_depth (state, -1);
+      break;
+    default:
+      break;
+  }
+}
+
+/*
+ * Point the jumps to constant targets at the code for their lines
+ * params:
+ *   CompilerState*   state     the compilation state
+ *   ProgramNode*     program   the program being compiled
+ */
+static void resolve_jumps (CompilerState *state, ProgramNode *program) {
+
+  /* local variables */
+  LineAddress
+    *lines, /* the lines sorted for searching */
+    key, /* the line to search for */
+    *found; /* the line found */
+  ProgramLineNode *program_line; /* a line of the program */
+  int
+    line, /* index of a line */
+    jump; /* index of a jump */
+
+  /* nothing to do if there are no constant jumps */
+  if (! state->jump_count || state->failed)
+    return;
+
+  /* sort the lines so that the targets can be found quickly */
+  if (! (lines = malloc (state->bytecode->line_count * sizeof (LineAddress)))) {
+    state->failed = 1;
+    return;
+  }
+  for (line = 0, program_line = program->first; program_line;
+    ++line, program_line = program_line->next) {
+    lines[line].line = program_line;
+    lines[line].address = state->bytecode->addresses[line];
+  }
+  qsort (lines, state->bytecode->line_count, sizeof (LineAddress),
+    compare_lines);
+
+  /* fill in the address of each target */
+  for (jump = 0; jump < state->jump_count; ++jump) {
+    key.line = state->jumps[jump].target;
+    found = bsearch (&key, lines, state->bytecode->line_count,
+      sizeof (LineAddress), compare_lines);
+    state->bytecode->code[state->jumps[jump].operand]
+      = found ? found->address : state->bytecode->code_size - 1;
+  }
+  free (lines);
+}
+
+/*
+ * Check that loaded code is safe to run: every operation known, every
+ * operand in range, every jump landing on a line or the final HALT, and the
+ * value stack never deeper than max_stack
+ * params:
+ *   Bytecode*   bytecode   the loaded program
+ * returns:
+ *   int                    !0 if the code can be run, 0 if not
+ */
+static int verify_code (Bytecode *bytecode) {
+
+  /* local variables */
+  int
+    *code = bytecode->code, /* the operations and operands */
+    size = bytecode->code_size, /* number of cells in the code */
+    pc, /* address of the operation being checked */
+    last = 0, /* address of the last operation */
+    operands, /* number of operands of the operation */
+    operand, /* index of an operand */
+    pops, /* values the operation takes from the stack */
+    pushes, /* values the operation puts on the stack */
+    depth = 0, /* depth of the value stack before the operation */
+    deepest = 0, /* the deepest the value stack grows */
+    line, /* index of a program line */
+    ok = 1; /* cleared when a check fails */
+  char *cells; /* CELL_OPERATION and CELL_TARGET flags for each cell */
+
+  /* find where each operation starts, checking its non-address operands */
+  if (! (cells = calloc (size, 1)))
+    return 0;
+  for (pc = 0; ok && pc < size; pc += 1 + operands) {
+    cells[last = pc] = CELL_OPERATION;
+    operands = 0;
+    switch (code[pc]) {
+      case OP_PUSH:
+      case OP_IF_EQUAL:
+      case OP_IF_UNEQUAL:
+      case OP_IF_LESSTHAN:
+      case OP_IF_LESSOREQUAL:
+      case OP_IF_GREATERTHAN:
+      case OP_IF_GREATEROREQUAL:
+      case OP_JUMP:
+      case OP_GOSUB:
+        operands = 1;
+        break;
+      case OP_CALL:
+        operands = 2;
+        break;
+      case OP_LOAD:
+      case OP_STORE:
+      case OP_PEEK:
+        operands = 1;
+        ok = pc + 1 < size && code[pc + 1] >= 0 && code[pc + 1] < 26;
+        break;
+      case OP_PRINT_STRING:
+        operands = 1;
+        ok = pc + 1 < size && code[pc + 1] >= 0
+          && code[pc + 1] < bytecode->string_count;
+        break;
+      case OP_INPUT:
+        if ((ok = pc + 1 < size && code[pc + 1] >= 0
+          && code[pc + 1] < size - pc - 1))
+          operands = 1 + code[pc + 1];
+        for (operand = pc + 2; ok && operand <= pc + operands; ++operand)
+          ok = code[operand] >= 0 && code[operand] < 26;
+        break;
+      default:
+        ok = code[pc] >= 0 && code[pc] < OP_LAST;
+        break;
+    }
+    ok = ok && pc + operands < size;
+  }
+
+  /* the code must end in HALT, and each line start at an operation */
+  ok = ok && code[last] == OP_HALT && last == size - 1;
+  if (ok)
+    cells[last] |= CELL_TARGET;
+  for (line = 0; ok && line < bytecode->line_count; ++line)
+    if ((ok = bytecode->labels[line] >= 0
+      && bytecode->addresses[line] >= 0 && bytecode->addresses[line] < size
+      && cells[bytecode->addresses[line]] & CELL_OPERATION))
+      cells[bytecode->addresses[line]] |= CELL_TARGET;
+
+  /* follow the stack depth through the code; jumps only happen with the
+     stack empty, and only to where it is empty, so one pass covers them */
+  for (pc = 0; ok && pc < size; pc += 1 + operands) {
+    operands = pops = pushes = 0;
+    switch (code[pc]) {
+      case OP_PUSH:
+      case OP_LOAD:
+        operands = pushes = 1;
+        break;
+      case OP_STORE:
+      case OP_PEEK:
+        operands = pops = 1;
+        break;
+      case OP_NEGATE:
+      case OP_LIMIT:
+        pops = pushes = 1;
+        break;
+      case OP_ADD:
+      case OP_SUBTRACT:
+      case OP_MULTIPLY:
+      case OP_DIVIDE:
+        pops = 2;
+        pushes = 1;
+        break;
+      case OP_IF_EQUAL:
+      case OP_IF_UNEQUAL:
+      case OP_IF_LESSTHAN:
+      case OP_IF_LESSOREQUAL:
+      case OP_IF_GREATERTHAN:
+      case OP_IF_GREATEROREQUAL:
+        operands = 1;
+        pops = 2;
+        break;
+      case OP_JUMP:
+        operands = 1;
+        break;
+      case OP_CALL:
+        operands = 2;
+        break;
+      case OP_GOTO:
+      case OP_PRINT_NUMBER:
+        pops = 1;
+        break;
+      case OP_GOSUB:
+        operands = pops = 1;
+        break;
+      case OP_PRINT_STRING:
+        operands = 1;
+        break;
+      case OP_INPUT:
+        operands = 1 + code[pc + 1];
+        break;
+      case OP_POKE:
+        pops = 2;
+        break;
+      default:
+        break;
+    }
+    ok = depth >= pops && (! (cells[pc] & CELL_TARGET) || ! depth);
+    depth += pushes - pops;
+    if (depth > deepest)
+      deepest = depth;
+
+    /* a jump must leave the stack empty and land on a target */
+    switch (code[pc]) {
+      case OP_CALL: /* the return address, as well as the target */
+        ok = ok && code[pc + 2] >= 0 && code[pc + 2] < size
+          && cells[code[pc + 2]] & CELL_TARGET;
+      case OP_IF_EQUAL:
+      case OP_IF_UNEQUAL:
+      case OP_IF_LESSTHAN:
+      case OP_IF_LESSOREQUAL:
+      case OP_IF_GREATERTHAN:
+      case OP_IF_GREATEROREQUAL:
+      case OP_JUMP:
+      case OP_GOSUB:
+        ok = ok && code[pc + 1] >= 0 && code[pc + 1] < size
+          && cells[code[pc + 1]] & CELL_TARGET;
+      case OP_GOTO: /* and every other jump */
+      case OP_RETURN:
+      case OP_END:
+      case OP_HALT:
+        ok = ok && ! depth;
+        break;
+      default:
+        break;
+    }
+  }
+
+  /* the value stack must fit in the space the program asks for */
+  free (cells);
+  return ok && deepest <= bytecode->max_stack;
+}
+
+
+/*
+ * Public Functions
+ */
+
+
+/*
+ * Compile a program into bytecode
+ * params:
+ *   ProgramNode*    program   the program to compile
+ *   ErrorHandler*   errors    the error handler
+ * returns:
+ *   Bytecode*                 the compiled program, NULL on failure
+ */
+Bytecode *bytecode_compile (ProgramNode *program, ErrorHandler *errors) {
+
+  /* local variables */
+  CompilerState state; /* the compilation state */
+  Bytecode *bytecode; /* the bytecode to build */
+  ProgramLineNode *program_line; /* line to compile */
+  int line; /* index of the line being compiled */
+
+  /* count the lines */
+  if (! (bytecode = malloc (sizeof (Bytecode)))) {
+    errors->set_code (errors, E_MEMORY, 0, 0, 0);
+    return NULL;
+  }
+  bytecode->line_count = 0;
+  bytecode->image = NULL;
+  bytecode->image_size = 0;
+  bytecode->mapped = 0;
+  for (program_line = program->first; program_line;
+    program_line = program_line->next)
+    ++bytecode->line_count;
+
+  /* initialise the bytecode and the compilation state */
+  state.bytecode = bytecode;
+  state.code_capacity = 64;
+  state.string_capacity = 8;
+  state.patch_capacity = 4;
+  state.patch_count = 0;
+  state.jump_capacity = 4;
+  state.jump_count = 0;
+  state.depth = 0;
+  state.failed = 0;
+  bytecode->code_size = 0;
+  bytecode->string_count = 0;
+  bytecode->max_stack = 0;
+  bytecode->code = malloc (state.code_capacity * sizeof (int));
+  bytecode->strings = malloc (state.string_capacity * sizeof (TCHAR *));
+  bytecode->labels = malloc ((bytecode->line_count + 1) * sizeof (int));
+  bytecode->addresses = malloc ((bytecode->line_count + 1) * sizeof (int));
+  state.patches = malloc (state.patch_capacity * sizeof (int));
+  state.jumps = malloc (state.jump_capacity * sizeof (JumpPatch));
+  if (! bytecode->code || ! bytecode->strings || ! bytecode->labels
+    || ! bytecode->addresses || ! state.patches || ! state.jumps)
+    state.failed = 1;
+
+  /* compile each line, pointing its forward references at the next */
+  line = 0;
+  program_line = program->first;
+  while (program_line && ! state.failed) {
+    bytecode->labels[line] = program_line->label;
+    bytecode->addresses[line] = bytecode->code_size;
+    compile_statement (&state, program_line->statement);
+    while (state.patch_count && ! state.failed)
+      bytecode->code[state.patches[--state.patch_count]]
+        = bytecode->code_size;
+    program_line = program_line->next;
+    ++line;
+  }
+  emit (&state, OP_HALT);
+  resolve_jumps (&state, program);
+
+  /* tidy up and check for failure */
+  free (state.patches);
+  free (state.jumps);
+  if (state.failed) {
+    errors->set_code (errors, E_MEMORY, 0, 0, 0);
+    bytecode_destroy (bytecode);
+    return NULL;
+  }
+  return bytecode;
+}
+
+/*
+ * Find the program line containing a code address
+ * params:
+ *   Bytecode*   bytecode   the compiled program
+ *   int         address    the code address
+ * returns:
+ *   int                    the index of the line, -1 if none
+ */
+int bytecode_find_line (Bytecode *bytecode, int address) {
+
+  /* local variables */
+  int
+    low = 0, /* lowest line still in the running */
+    high = bytecode->line_count - 1, /* highest line still in the running */
+    middle, /* the line to check */
+    found = -1; /* the last line starting at or before the address */
+
+  /* binary search the line addresses */
+  while (low <= high) {
+    middle = (low + high) / 2;
+    if (bytecode->addresses[middle] <= address) {
+      found = middle;
+      low = middle + 1;
+    } else
+      high = middle - 1;
+  }
+  return found;
+}
+
+/*
+ * Write compiled bytecode to a cache file, by way of a temporary file that
+ * replaces it whole so that a run with the old cache mapped is undisturbed
+ * params:
+ *   Bytecode*        bytecode   the compiled program
+ *   const TCHAR*     filename   the name of the cache file
+ *   BytecodeStamp*   stamp      what the program was built from
+ * returns:
+ *   int                         !0 if written, 0 if the file couldn't be
+ */
+int bytecode_save (Bytecode *bytecode, const TCHAR *filename,
+  BytecodeStamp *stamp) {
+
+  /* local variables */
+  FILE *output; /* the temporary cache file */
+  TCHAR *temp_name; /* the name of the temporary file */
+  CacheHeader header; /* the header of the cache file */
+  int
+    *offsets, /* where each string starts among the strings */
+    count, /* string counter */
+    ok; /* cleared if a write fails */
+#ifdef USE_MMAP
+  int descriptor; /* the temporary file, opened exclusively */
+#endif
+
+  /* lay the strings out one after another */
+  if (! (offsets = malloc ((bytecode->string_count + 1) * sizeof (int))))
+    return 0;
+  memset (&header, 0, sizeof (header));
+  for (count = 0; count < bytecode->string_count; ++count) {
+    offsets[count] = header.string_size;
+    header.string_size += (int) strlen (bytecode->strings[count]) + 1;
+  }
+
+  /* describe the program and what it was built from */
+  memcpy (header.magic, CACHE_MAGIC, sizeof (header.magic));
+  header.version = CACHE_VERSION;
+  header.source_size = stamp->source_size;
+  header.source_time = stamp->source_time;
+  header.source_hash = stamp->source_hash;
+  header.cell_size = sizeof (int);
+  header.char_size = sizeof (TCHAR);
+  header.operations = OP_LAST;
+  header.line_numbers = stamp->line_numbers;
+  header.line_limit = stamp->line_limit;
+  header.comments = stamp->comments;
+  header.integer_width = stamp->integer_width;
+  header.code_size = bytecode->code_size;
+  header.line_count = bytecode->line_count;
+  header.string_count = bytecode->string_count;
+  header.max_stack = bytecode->max_stack;
+
+  /* create the temporary file beside the cache */
+  if (! (temp_name = malloc ((strlen (filename) + 24) * sizeof (TCHAR)))) {
+    free (offsets);
+    return 0;
+  }
+#ifdef USE_MMAP
+  sprintf (temp_name, _T("%s.%ld.tmp"), filename, (long) getpid ());
+  output = NULL;
+  if ((descriptor = open (temp_name, O_WRONLY | O_CREAT | O_EXCL, 0666)) >= 0
+    && ! (output = fdopen (descriptor, _T("wb")))) {
+    close (descriptor);
+    remove (temp_name);
+  }
+#else
+  sprintf (temp_name, _T("%s.tmp"), filename);
+  output = fopen (temp_name, _T("wb"));
+#endif
+  if (! output) {
+    free (temp_name);
+    free (offsets);
+    return 0;
+  }
+
+  /* write the header and then each part in turn */
+  ok = fwrite (&header, sizeof (header), 1, output) == 1
+    && fwrite (bytecode->code, sizeof (int), bytecode->code_size, output)
+      == (size_t) bytecode->code_size
+    && fwrite (bytecode->labels, sizeof (int), bytecode->line_count, output)
+      == (size_t) bytecode->line_count
+    && fwrite (bytecode->addresses, sizeof (int), bytecode->line_count,
+      output) == (size_t) bytecode->line_count
+    && fwrite (offsets, sizeof (int), bytecode->string_count, output)
+      == (size_t) bytecode->string_count;
+  for (count = 0; ok && count < bytecode->string_count; ++count)
+    ok = fwrite (bytecode->strings[count], sizeof (TCHAR),
+      strlen (bytecode->strings[count]) + 1, output)
+      == strlen (bytecode->strings[count]) + 1;
+  free (offsets);
+
+  /* put the finished file in place of the cache, or discard it */
+  ok = ! fclose (output) && ok;
+#ifndef USE_MMAP
+  if (ok)
+    remove (filename);
+#endif
+  ok = ok && ! rename (temp_name, filename);
+  if (! ok)
+    remove (temp_name);
+  free (temp_name);
+  return ok;
+}
+
+/*
+ * Load bytecode from a cache file, mapping it where possible
+ * params:
+ *   const TCHAR*     filename   the name of the cache file
+ *   BytecodeStamp*   stamp      what the program must have been built from
+ * returns:
+ *   Bytecode*                   the program, NULL if missing or out of date
+ */
+Bytecode *bytecode_load (const TCHAR *filename, BytecodeStamp *stamp) {
+
+  /* local variables */
+  FILE *input; /* the cache file */
+  struct stat status; /* the status of the cache file */
+  Bytecode *bytecode; /* the loaded program */
+  CacheHeader *header; /* the header of the cache file */
+  TCHAR *characters; /* the characters of the strings */
+  int
+    *offsets, /* where each string starts among the characters */
+    count, /* string counter */
+    ok; /* cleared if the cache cannot be used */
+
+  /* map or read the whole file */
+  if (! (input = fopen (filename, _T("rb"))))
+    return NULL;
+  if (! (bytecode = calloc (1, sizeof (Bytecode)))
+    || fstat (fileno (input), &status)
+    || status.st_size < (long long) sizeof (CacheHeader)) {
+    free (bytecode);
+    fclose (input);
+    return NULL;
+  }
+  bytecode->image_size = (size_t) status.st_size;
+#ifdef USE_MMAP
+  bytecode->image = mmap (NULL, bytecode->image_size, PROT_READ, MAP_PRIVATE,
+    fileno (input), 0);
+  if (bytecode->image == MAP_FAILED)
+    bytecode->image = NULL;
+  else
+    bytecode->mapped = 1;
+#endif
+  if (! bytecode->image && (bytecode->image = malloc (bytecode->image_size))
+    && fread (bytecode->image, 1, bytecode->image_size, input)
+    != bytecode->image_size) {
+    free (bytecode->image);
+    bytecode->image = NULL;
+  }
+  fclose (input);
+
+  /* the cache must be whole, and built this way from this source */
+  header = bytecode->image;
+  ok = header
+    && ! memcmp (header->magic, CACHE_MAGIC, sizeof (header->magic))
+    && header->version == CACHE_VERSION
+    && header->source_size == stamp->source_size
+    && header->source_time == stamp->source_time
+    && header->source_hash == stamp->source_hash
+    && header->cell_size == sizeof (int)
+    && header->char_size == sizeof (TCHAR)
+    && header->operations == OP_LAST
+    && header->line_numbers == stamp->line_numbers
+    && header->line_limit == stamp->line_limit
+    && header->comments == stamp->comments
+    && header->integer_width == stamp->integer_width
+    && header->code_size > 0 && header->line_count >= 0
+    && header->string_count >= 0 && header->string_size >= 0
+    && header->max_stack >= 0
+    && bytecode->image_size == sizeof (CacheHeader)
+      + ((size_t) header->code_size + 2 * (size_t) header->line_count
+      + header->string_count) * sizeof (int)
+      + (size_t) header->string_size * sizeof (TCHAR);
+
+  /* point the parts into the file, and each string at its characters */
+  if (ok) {
+    bytecode->code = (int *) (header + 1);
+    bytecode->code_size = header->code_size;
+    bytecode->labels = bytecode->code + header->code_size;
+    bytecode->addresses = bytecode->labels + header->line_count;
+    bytecode->line_count = header->line_count;
+    offsets = bytecode->addresses + header->line_count;
+    characters = (TCHAR *) (offsets + header->string_count);
+    bytecode->string_count = header->string_count;
+    bytecode->max_stack = header->max_stack;
+    ok = (bytecode->strings
+      = malloc ((header->string_count + 1) * sizeof (TCHAR *))) != NULL
+      && (! header->string_size
+      || characters[header->string_size - 1] == _T('\0'));
+    for (count = 0; ok && count < header->string_count; ++count)
+      if ((ok = offsets[count] >= 0 && offsets[count] < header->string_size))
+        bytecode->strings[count] = characters + offsets[count];
+    ok = ok && verify_code (bytecode);
+  }
+
+  /* discard a cache that cannot be used */
+  if (! ok) {
+    bytecode_destroy (bytecode);
+    return NULL;
+  }
+  return bytecode;
+}
+
+/*
+ * Bytecode destructor
+ * params:
+ *   Bytecode*   bytecode   the doomed bytecode
+ */
+void bytecode_destroy (Bytecode *bytecode) {
+
+  /* local variables */
+  int count; /* string counter */
+
+  /* free the parts, then the bytecode itself */
+  if (bytecode && bytecode->image) {
+    free (bytecode->strings);
+#ifdef USE_MMAP
+    if (bytecode->mapped)
+      munmap (bytecode->image, bytecode->image_size);
+    else
+#endif
+      free (bytecode->image);
+    free (bytecode);
+  }
+  else if (bytecode) {
+    if (bytecode->strings) {
+      for (count = 0; count < bytecode->string_count; ++count)
+        free (bytecode->strings[count]);
+      free (bytecode->strings);
+    }
+    free (bytecode->code);
+    free (bytecode->labels);
+    free (bytecode->addresses);
+    free (bytecode);
+  }
+}
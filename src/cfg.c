@@ -0,0 +1,296 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Control Flow Graph Module
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+/* included headers */
+#include <stdlib.h>
+#include <stdint.h>
+#include "common.h"
+#include "statement.h"
+#include "cfg.h"
+
+
+/*
+ * Level 1 Functions
+ */
+
+
+/*
+ * Compare two lines by address, for sorting and searching
+ * params:
+ *   const void*   a   the first line
+ *   const void*   b   the second line
+ * returns:
+ *   int               <0, 0 or >0 as a is before, at or after b
+ */
+static int compare_lines (const void *a, const void *b) {
+  const CfgLine
+    *left = a, /* the first line */
+    *right = b; /* the second line */
+  if (left->line == right->line)
+    return 0;
+  return (uintptr_t) left->line < (uintptr_t) right->line ? -1 : 1;
+}
+
+/*
+ * Find a line in the graph's sorted line list
+ * params:
+ *   Cfg*               cfg    the control flow graph
+ *   ProgramLineNode*   line   the program line
+ * returns:
+ *   CfgLine*                  the entry for the line, NULL if not found
+ */
+static CfgLine *find_line (Cfg *cfg, ProgramLineNode *line) {
+  CfgLine key; /* the line to search for */
+  if (! line || ! cfg->line_count)
+    return NULL;
+  key.line = line;
+  return bsearch (&key, cfg->lines, cfg->line_count, sizeof (CfgLine),
+    compare_lines);
+}
+
+/*
+ * Work out how control can leave a statement
+ * params:
+ *   StatementNode*      statement   the statement, NULL for a comment
+ *   ProgramLineNode**   jump        receives the constant GOTO target
+ *   ProgramLineNode**   call        receives the constant GOSUB target
+ * returns:
+ *   int                             CfgExit flags for the statement
+ */
+static int statement_exits (StatementNode *statement, ProgramLineNode **jump,
+  ProgramLineNode **call) {
+  if (! statement)
+    return CFG_EXIT_FALLTHROUGH;
+  switch (statement->class) {
+    case STATEMENT_IF:
+      return CFG_EXIT_FALLTHROUGH
+        | statement_exits (statement->statement.ifn->statement, jump, call);
+    case STATEMENT_GOTO:
+      if ((*jump = statement->statement.goton->target))
+        return CFG_EXIT_JUMP;
+      return CFG_EXIT_JUMP_ANY;
+    case STATEMENT_GOSUB:
+      if ((*call = statement->statement.gosubn->target))
+        return CFG_EXIT_CALL;
+      return CFG_EXIT_CALL_ANY;
+    case STATEMENT_RETURN:
+      return CFG_EXIT_RETURN;
+    case STATEMENT_END:
+      return CFG_EXIT_END;
+    default:
+      return CFG_EXIT_FALLTHROUGH;
+  }
+}
+
+
+/*
+ * Level 0 Functions
+ */
+
+
+/*
+ * Split the program into blocks and connect them
+ * params:
+ *   Cfg*           cfg       the graph, its lines sorted by address with
+ *                            their positions in place of their blocks
+ *   ProgramNode*   program   the program
+ *   int*           entries   CfgEntry flags for each line, by position
+ *   int*           exits     CfgExit flags for each line, by position
+ *   int*           block     receives the block of each line, by position
+ * returns:
+ *   int                      !0 on success, 0 if memory ran out
+ */
+static int build_blocks (Cfg *cfg, ProgramNode *program, int *entries,
+  int *exits, int *block) {
+
+  /* local variables */
+  ProgramLineNode
+    *program_line, /* a line of the program */
+    *jump, /* the constant GOTO target of a line */
+    *call; /* the constant GOSUB target of a line */
+  CfgLine *found; /* a target line found in the line list */
+  CfgBlock *current = NULL; /* the block being assembled */
+  int
+    line, /* position of a line */
+    index; /* index of a block */
+
+  /* a line leads a block if control can reach it other than from the line
+     before, or if the line before can send control elsewhere */
+  cfg->block_count = 0;
+  for (line = 0; line < cfg->line_count; ++line)
+    if (! line || entries[line] || exits[line - 1] != CFG_EXIT_FALLTHROUGH)
+      ++cfg->block_count;
+  if (! (cfg->blocks = malloc (cfg->block_count * sizeof (CfgBlock))))
+    return 0;
+
+  /* gather the lines into blocks */
+  index = -1;
+  for (line = 0, program_line = program->first; program_line;
+    ++line, program_line = program_line->next) {
+    if (! line || entries[line] || exits[line - 1] != CFG_EXIT_FALLTHROUGH) {
+      current = &cfg->blocks[++index];
+      current->first = program_line;
+      current->position = line;
+      current->line_count = 0;
+      current->entries = entries[line];
+      if (line && exits[line - 1] & CFG_EXIT_FALLTHROUGH)
+        current->entries |= CFG_ENTRY_FALLTHROUGH;
+    }
+    current->last = program_line;
+    current->exits = exits[line];
+    ++current->line_count;
+    block[line] = index;
+  }
+
+  /* connect each block to the blocks it can pass control to directly */
+  for (index = 0; index < cfg->block_count; ++index) {
+    current = &cfg->blocks[index];
+    current->next = current->jump = current->call = -1;
+    if (current->exits
+      & (CFG_EXIT_FALLTHROUGH | CFG_EXIT_CALL | CFG_EXIT_CALL_ANY)) {
+      if (index + 1 < cfg->block_count)
+        current->next = index + 1;
+      else
+        current->exits = (current->exits & ~CFG_EXIT_FALLTHROUGH)
+          | CFG_EXIT_END;
+    }
+    jump = call = NULL;
+    statement_exits (current->last->statement, &jump, &call);
+    if ((found = find_line (cfg, jump)))
+      current->jump = block[found->block];
+    if ((found = find_line (cfg, call)))
+      current->call = block[found->block];
+  }
+
+  /* record the block of each line in place of its position */
+  for (line = 0; line < cfg->line_count; ++line)
+    cfg->lines[line].block = block[cfg->lines[line].block];
+  return 1;
+}
+
+
+/*
+ * Public Functions
+ */
+
+
+/*
+ * Build the control flow graph of a linked program
+ * params:
+ *   ProgramNode*   program   the program, its constant targets resolved
+ * returns:
+ *   Cfg*                     the graph, NULL if memory ran out
+ */
+Cfg *cfg_build (ProgramNode *program) {
+
+  /* local variables */
+  Cfg *cfg; /* the graph being built */
+  ProgramLineNode
+    *program_line, /* a line of the program */
+    *jump, /* the constant GOTO target of a line */
+    *call; /* the constant GOSUB target of a line */
+  CfgLine *found; /* a target line found in the line list */
+  int
+    *entries = NULL, /* CfgEntry flags for each line */
+    *exits = NULL, /* CfgExit flags for each line */
+    *block = NULL, /* the block of each line */
+    line, /* position of a line */
+    built = 0; /* set when the blocks have been built */
+
+  /* initialise an empty graph */
+  if (! (cfg = malloc (sizeof (Cfg))))
+    return NULL;
+  cfg->blocks = NULL;
+  cfg->block_count = 0;
+  cfg->lines = NULL;
+  cfg->line_count = 0;
+  cfg->computed = 0;
+  for (program_line = program->first; program_line;
+    program_line = program_line->next)
+    ++cfg->line_count;
+  if (! cfg->line_count)
+    return cfg;
+
+  /* sort the lines so that jump targets can be found quickly */
+  cfg->lines = malloc (cfg->line_count * sizeof (CfgLine));
+  entries = calloc (cfg->line_count, sizeof (int));
+  exits = malloc (cfg->line_count * sizeof (int));
+  block = malloc (cfg->line_count * sizeof (int));
+  if (cfg->lines && entries && exits && block) {
+    for (line = 0, program_line = program->first; program_line;
+      ++line, program_line = program_line->next) {
+      cfg->lines[line].line = program_line;
+      cfg->lines[line].block = line;
+    }
+    qsort (cfg->lines, cfg->line_count, sizeof (CfgLine), compare_lines);
+
+    /* find where each line sends control, and mark what it reaches */
+    entries[0] = CFG_ENTRY_START;
+    for (line = 0, program_line = program->first; program_line;
+      ++line, program_line = program_line->next) {
+      jump = call = NULL;
+      exits[line] = statement_exits (program_line->statement, &jump, &call);
+      if ((found = find_line (cfg, jump)))
+        entries[found->block] |= CFG_ENTRY_JUMP;
+      if ((found = find_line (cfg, call)))
+        entries[found->block] |= CFG_ENTRY_CALL;
+      if (exits[line] & (CFG_EXIT_CALL | CFG_EXIT_CALL_ANY)
+        && line + 1 < cfg->line_count)
+        entries[line + 1] |= CFG_ENTRY_RETURN;
+      if (exits[line] & (CFG_EXIT_JUMP_ANY | CFG_EXIT_CALL_ANY))
+        cfg->computed = 1;
+    }
+
+    /* a computed label might reach any labelled line */
+    if (cfg->computed)
+      for (line = 0, program_line = program->first; program_line;
+        ++line, program_line = program_line->next)
+        if (program_line->label)
+          entries[line] |= CFG_ENTRY_ANY_LINE;
+
+    /* divide the program into blocks */
+    built = build_blocks (cfg, program, entries, exits, block);
+  }
+
+  /* tidy up */
+  free (entries);
+  free (exits);
+  free (block);
+  if (! built) {
+    cfg_destroy (cfg);
+    return NULL;
+  }
+  return cfg;
+}
+
+/*
+ * Find the block that holds a program line
+ * params:
+ *   Cfg*               cfg    the control flow graph
+ *   ProgramLineNode*   line   the program line
+ * returns:
+ *   int                       index of the block, -1 if the line isn't found
+ */
+int cfg_find_block (Cfg *cfg, ProgramLineNode *line) {
+  CfgLine *found; /* the line found */
+  return (found = find_line (cfg, line)) ? found->block : -1;
+}
+
+/*
+ * Control flow graph destructor
+ * params:
+ *   Cfg*   cfg   the doomed graph
+ */
+void cfg_destroy (Cfg *cfg) {
+  if (cfg) {
+    free (cfg->blocks);
+    free (cfg->lines);
+    free (cfg);
+  }
+}
@@ -33,10 +33,6 @@ typedef struct {
  */
 
 
-/* convenience variables */
-ErrorHandler *this; /* object being worked on */
-FileTokenizerPrivateData *data; /* private data of object being worked on */
-
 /* global variables */
 static TCHAR *messages[E_LAST] = { /* the error messages */
 ERROR_SUCCESSFUL,
@@ -54,7 +50,9 @@ ERROR_THEN_EXPECTED,
 ERROR_UNEXPECTED_PARAMETER,
 ERROR_RETURN_WITHOUT_GOSUB,
 ERROR_DIVIDE_BY_ZERO,
-ERROR_OVERFLOW
+ERROR_OVERFLOW,
+ERROR_OUT_OF_MEMORY,
+ERROR_TO_MANY_GOSUBS
 };
 
 
@@ -78,8 +76,7 @@ static void set_code (ErrorHandler *errors, ErrorCode new_error, int new_line, i
   int new_label) {
 
   /* initialise */
-  this = errors;
-  data = this->data;
+  FileTokenizerPrivateData *data = errors->data; /* the private data */
 
   /* set the properties */
   data->error = new_error;
@@ -96,8 +93,7 @@ static void set_code (ErrorHandler *errors, ErrorCode new_error, int new_line, i
  *   ErrorCode                the last error encountered
  */
 static ErrorCode get_code (ErrorHandler *errors) {
-  this = errors;
-  data = this->data;
+  FileTokenizerPrivateData *data = errors->data; /* the private data */
   return data->error;
 }
 
@@ -109,8 +105,7 @@ static ErrorCode get_code (ErrorHandler *errors) {
  *   int                      the source line of the last error
  */
 static int get_line (ErrorHandler *errors) {
-  this = errors;
-  data = this->data;
+  FileTokenizerPrivateData *data = errors->data; /* the private data */
   return data->line;
 }
 
@@ -122,8 +117,7 @@ static int get_line (ErrorHandler *errors) {
  *   int                      the line label of the last error
  */
 static int get_label (ErrorHandler *errors) {
-  this = errors;
-  data = this->data;
+  FileTokenizerPrivateData *data = errors->data; /* the private data */
   return data->label;
 }
 
@@ -145,8 +139,7 @@ static TCHAR *get_text (ErrorHandler *errors) {
     *label_text; /* label N */
 
   /* initialise the error object */
-  this = errors;
-  data = this->data;
+  FileTokenizerPrivateData *data = errors->data; /* the private data */
 
   /* get the source line, if there is one */
   line_text = _malloc (REPL_LINE_LENGTH);
@@ -183,10 +176,9 @@ static TCHAR *get_text (ErrorHandler *errors) {
  *   ErrorHandler*   errors   the doomed error handler
  */
 static void destroy (ErrorHandler *errors) {
-  if ((this = errors)) {
-    data = this->data;
-    free (data);
-    free (this);
+  if (errors) {
+    free (errors->data);
+    free (errors);
   }
 }
 
@@ -203,19 +195,23 @@ static void destroy (ErrorHandler *errors) {
  */
 ErrorHandler *new_ErrorHandler (void) {
 
+    /* local variables */
+    ErrorHandler *errors; /* the new object */
+    FileTokenizerPrivateData *data; /* its private data */
+
     /* allocate memory */
-    this = malloc (sizeof (ErrorHandler));
-    if (this == NULL) return NULL;
-    this->data = data = malloc (sizeof (FileTokenizerPrivateData));
+    errors = malloc (sizeof (ErrorHandler));
+    if (errors == NULL) return NULL;
+    errors->data = data = malloc (sizeof (FileTokenizerPrivateData));
     if (data == NULL) return NULL;
 
     /* initialise the methods */
-    this->set_code = set_code;
-    this->get_code = get_code;
-    this->get_line = get_line;
-    this->get_label = get_label;
-    this->get_text = get_text;
-    this->destroy = destroy;
+    errors->set_code = set_code;
+    errors->get_code = get_code;
+    errors->get_line = get_line;
+    errors->get_label = get_label;
+    errors->get_text = get_text;
+    errors->destroy = destroy;
 
     /* initialise the properties */
     data->error = E_NONE;
@@ -223,5 +219,5 @@ ErrorHandler *new_ErrorHandler (void) {
     data->label = 0;
 
     /* return the new object */
-    return this;
+    return errors;
 }
\ No newline at end of file
@@ -23,16 +23,18 @@
 
 /*
  * Constructor for a factor
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   FactorNode*   the new factor
  */
-FactorNode *factor_create (void) {
+FactorNode *factor_create (Arena *arena) {
 
   /* local variables */
   FactorNode *factor; /* the new factor */
 
-  /* allocate memory and initialise members */
-  factor = malloc (sizeof (FactorNode));
+  /* allocate memory from the arena and initialise members */
+  factor = arena_alloc (arena, sizeof (FactorNode));
   if (factor == NULL) return NULL;
   factor->class = FACTOR_NONE;
   factor->sign = SIGN_POSITIVE;
@@ -41,18 +43,6 @@ FactorNode *factor_create (void) {
   return factor;
 }
 
-/*
- * Destructor for a factor
- * params:
- *   FactorNode*   factor   the doomed factor
- */
-void factor_destroy (FactorNode *factor) {
-  if (factor->class == FACTOR_EXPRESSION && factor->data.expression) {
-    expression_destroy (factor->data.expression);
-  }
-  free (factor);
-}
-
 
 /*
  * Functions for Dealing with Terms
@@ -61,16 +51,18 @@ void factor_destroy (FactorNode *factor) {
 
 /*
  * Constructor for a right-hand factor of a term
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   RightHandFactor*   the new RH factor of a term
  */
-RightHandFactor *rhfactor_create (void) {
+RightHandFactor *rhfactor_create (Arena *arena) {
 
   /* local variables */
   RightHandFactor *rhfactor; /* the RH factor of a term to create */
 
-  /* allocate memory and initialise members */
-  rhfactor = malloc (sizeof (RightHandFactor));
+  /* allocate memory from the arena and initialise members */
+  rhfactor = arena_alloc (arena, sizeof (RightHandFactor));
   if (rhfactor == NULL) return NULL;
   rhfactor->op = TERM_OPERATOR_NONE;
   rhfactor->factor = NULL;
@@ -80,31 +72,20 @@ RightHandFactor *rhfactor_create (void) {
   return rhfactor;
 }
 
-/*
- * Recursive destructor for a right-hand factor of a term
- * params:
- *   RightHandFactor*   rhfactor   the doomed RH factor of a term
- */
-void rhfactor_destroy (RightHandFactor *rhfactor) {
-  if (rhfactor->next)
-    rhfactor_destroy (rhfactor->next);
-  if (rhfactor->factor)
-    factor_destroy (rhfactor->factor);
-  free (rhfactor);
-}
-
 /*
  * Constructor for a term
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   TermNode*   the new term
  */
-TermNode *term_create (void) {
+TermNode *term_create (Arena *arena) {
 
   /* local variables */
   TermNode *term; /* the new term */
 
-  /* allocate memory and initialise members */
-  term = malloc (sizeof (TermNode));
+  /* allocate memory from the arena and initialise members */
+  term = arena_alloc (arena, sizeof (TermNode));
   if (term == NULL) return NULL;
   term->factor = NULL;
   term->next = NULL;
@@ -113,23 +94,6 @@ TermNode *term_create (void) {
   return term;
 }
 
-/*
- * Destructor for a term
- * params:
- *   TermNode*   term   the doomed term
- */
-void term_destroy (TermNode *term) {
-
-  /* destroy the consituent parts of the term */
-  if (term->factor)
-    factor_destroy (term->factor);
-  if (term->next)
-    rhfactor_destroy (term->next);
-
-  /* destroy the term itself */
-  free (term);
-}
-
 
 /*
  * Functions for dealing with Expressions
@@ -138,16 +102,18 @@ void term_destroy (TermNode *term) {
 
 /*
  * Constructor for a right-hand expression
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   RightHandTerm*   the RH term of an expression
  */
-RightHandTerm *rhterm_create (void) {
+RightHandTerm *rhterm_create (Arena *arena) {
 
   /* local variables */
   RightHandTerm *rhterm; /* the new RH expression */
 
-  /* allocate memory and initialise members */
-  rhterm = malloc (sizeof (RightHandTerm));
+  /* allocate memory from the arena and initialise members */
+  rhterm = arena_alloc (arena, sizeof (RightHandTerm));
   if (rhterm == NULL) return NULL;
   rhterm->op = EXPRESSION_OPERATOR_NONE;
   rhterm->term = NULL;
@@ -157,31 +123,20 @@ RightHandTerm *rhterm_create (void) {
   return rhterm;
 }
 
-/*
- * Recursive destructor for a right-hand term of an expression
- * params:
- *   RightHandTerm*   rhterm   the doomed RH expression
- */
-void rhterm_destroy (RightHandTerm *rhterm) {
-  if (rhterm->next)
-    rhterm_destroy (rhterm->next);
-  if (rhterm->term)
-    term_destroy (rhterm->term);
-  free (rhterm);
-}
-
 /*
  * Constructor for an expression
+ * params:
+ *   Arena*   arena   the arena holding the program
  * returns:
  *   ExpressionNode*   the new expression
  */
-ExpressionNode *expression_create (void) {
+ExpressionNode *expression_create (Arena *arena) {
 
   /* local variables */
   ExpressionNode *expression; /* the new expression */
 
-  /* allocate memory and initialise members */
-  expression = malloc (sizeof (ExpressionNode));
+  /* allocate memory from the arena and initialise members */
+  expression = arena_alloc (arena, sizeof (ExpressionNode));
   if (expression == NULL) return NULL;
   expression->term = NULL;
   expression->next = NULL;
@@ -190,19 +145,3 @@ ExpressionNode *expression_create (void) {
   return expression;
 }
 
-/*
- * Destructor for a expression
- * params:
- *   ExpressionNode*   expression   the doomed expression
- */
-void expression_destroy (ExpressionNode *expression) {
-
-  /* destroy the consituent parts of the expression */
-  if (expression->term)
-    term_destroy (expression->term);
-  if (expression->next)
-    rhterm_destroy (expression->next);
-
-  /* destroy the expression itself */
-  free (expression);
-}
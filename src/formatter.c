@@ -17,6 +17,7 @@
 #include "expression.h"
 #include "errors.h"
 #include "parser.h"
+#include "stringbuffer.h"
 
 
 /*
@@ -27,10 +28,9 @@
 /* private formatter data */
 typedef struct formatter_data {
   ErrorHandler *errors; /* the error handler */
+  StringBuffer listing; /* the listing as it is put together */
 } FormatterData;
 
-/* convenience variables */
-static Formatter *this; /* the object being worked on */
 
 /*
  * Forward References
@@ -38,10 +38,10 @@ static Formatter *this; /* the object being worked on */
 
 
 /* factor_output() has a forward reference to output_expression() */
-static TCHAR *output_expression (ExpressionNode *expression);
+static TCHAR *output_expression (Formatter *formatter, ExpressionNode *expression);
 
 /* output_statement() has a forward reference from output_if() */
-static TCHAR *output_statement (StatementNode *statement);
+static TCHAR *output_statement (Formatter *formatter, StatementNode *statement);
 
 
 /*
@@ -52,11 +52,12 @@ static TCHAR *output_statement (StatementNode *statement);
 /*
  * Output a factor
  * params:
+ *   Formatter*    formatter   the formatter
  *   FactorNode*   factor   the factor to output
  * return:
  *   TCHAR*                  the text representation of the factor
  */
-static TCHAR *output_factor (FactorNode *factor) {
+static TCHAR *output_factor (Formatter *formatter, FactorNode *factor) {
 
   /* local variables */
   TCHAR *factor_text = NULL, /* the text of the whole factor */
@@ -71,12 +72,12 @@ static TCHAR *output_factor (FactorNode *factor) {
           snprintf (factor_text,2, _T("%c"), factor->data.variable + _T('A') - 1);
       break;
     case FACTOR_VALUE:
-      factor_text = _malloc (7);
+      factor_text = _malloc (12);
       if (factor_text != NULL)
-          snprintf (factor_text, 7, _T("%d"), factor->data.value);
+          snprintf (factor_text, 12, _T("%d"), factor->data.value);
       break;
     case FACTOR_EXPRESSION:
-      if ((expression_text = output_expression (factor->data.expression))) {
+      if ((expression_text = output_expression (formatter, factor->data.expression))) {
         factor_text = _malloc (strlen (expression_text) + 3);
         if (factor_text != NULL)
             snprintf (factor_text, strlen(expression_text) + 3, _T("(%s)"), expression_text);
@@ -84,8 +85,8 @@ static TCHAR *output_factor (FactorNode *factor) {
       }
       break;
     default:
-      this->priv->errors->set_code
-	(this->priv->errors, E_INVALID_EXPRESSION, 0,0,0);
+      formatter->priv->errors->set_code
+	(formatter->priv->errors, E_INVALID_EXPRESSION, 0,0,0);
   }
 
   /* apply a negative sign, if necessary */
@@ -104,124 +105,132 @@ static TCHAR *output_factor (FactorNode *factor) {
 /*
  * Output a term
  * params:
+ *   Formatter*   formatter   the formatter
  *   TermNode*   term   the term to output
  * returns:
  *   TCHAR*              the text representation of the term
  */
-static TCHAR *output_term (TermNode *term) {
+static TCHAR *output_term (Formatter *formatter, TermNode *term) {
 
   /* local variables */
-  TCHAR
-    *term_text = NULL, /* the text of the whole term */
-    *factor_text = NULL, /* the text of each factor */
-    operator_char; /* the operator that joins the righthand factor */
+  StringBuffer term_text; /* the text of the whole term */
+  TCHAR *factor_text = NULL; /* the text of each factor */
   RightHandFactor *rhfactor; /* right hand factors of the expression */
 
   /* begin with the initial factor */
-  if ((term_text = output_factor (term->factor))) {
-    rhfactor = term->next;
-    while (! this->priv->errors->get_code (this->priv->errors) && rhfactor) {
-
-      /* ascertain the operator text */
-      switch (rhfactor->op) {
-      case TERM_OPERATOR_MULTIPLY:
-        operator_char = '*';
-        break;
-      case TERM_OPERATOR_DIVIDE:
-        operator_char = '/';
-        break;
-      default:
-        this->priv->errors->set_code
-	  (this->priv->errors, E_INVALID_EXPRESSION, 0, 0, 0);
-        free (term_text);
-        term_text = NULL;
-      }
+  if (! string_buffer_init (&term_text))
+    return NULL;
+  factor_text = output_factor (formatter, term->factor);
+  string_buffer_append (&term_text, factor_text);
+  rhfactor = term->next;
+  while (factor_text && rhfactor
+    && ! formatter->priv->errors->get_code (formatter->priv->errors)) {
+    free (factor_text);
+    factor_text = NULL;
 
-      /* get the factor that follows the operator */
-      if (! this->priv->errors->get_code (this->priv->errors)
-        && (factor_text = output_factor (rhfactor->factor))) {
-        term_text = term_text==NULL?NULL:((TCHAR*)_realloc (term_text,
-          strlen (term_text) + strlen (factor_text) + 2));
-        if(term_text!=NULL)
-            snprintf (term_text, strlen(term_text) + strlen(factor_text) + 2, _T("%s%c%s"), term_text, operator_char, factor_text);
-        free (factor_text);
-      }
+    /* ascertain the operator text */
+    switch (rhfactor->op) {
+    case TERM_OPERATOR_MULTIPLY:
+      string_buffer_append (&term_text, _T("*"));
+      break;
+    case TERM_OPERATOR_DIVIDE:
+      string_buffer_append (&term_text, _T("/"));
+      break;
+    default:
+      formatter->priv->errors->set_code
+        (formatter->priv->errors, E_INVALID_EXPRESSION, 0, 0, 0);
+    }
 
-      /* look for another term on the right of the expression */
-      rhfactor = rhfactor->next;
+    /* get the factor that follows the operator */
+    if (! formatter->priv->errors->get_code (formatter->priv->errors)) {
+      factor_text = output_factor (formatter, rhfactor->factor);
+      string_buffer_append (&term_text, factor_text);
     }
-  }
 
-  /* return the expression text */
-  return term_text;
+    /* look for another term on the right of the expression */
+    rhfactor = rhfactor->next;
+  }
 
+  /* return the term text, unless something went wrong */
+  if (factor_text
+    && ! formatter->priv->errors->get_code (formatter->priv->errors)) {
+    free (factor_text);
+    return string_buffer_release (&term_text);
+  }
+  free (factor_text);
+  free (string_buffer_release (&term_text));
+  return NULL;
 }
 
 /*
  * Output an expression for a program listing
  * params:
+ *   Formatter*        formatter    the formatter
  *   ExpressionNode*   expression   the expression to output
  * returns:
  *   TCHAR*                          new string containint the expression text
  */
-static TCHAR *output_expression (ExpressionNode *expression) {
+static TCHAR *output_expression (Formatter *formatter, ExpressionNode *expression) {
 
   /* local variables */
-  TCHAR
-    *expression_text = NULL, /* the text of the whole expression */
-    *term_text = NULL, /* the text of each term */
-    operator_char; /* the operator that joins the righthand term */
+  StringBuffer expression_text; /* the text of the whole expression */
+  TCHAR *term_text = NULL; /* the text of each term */
   RightHandTerm *rhterm; /* right hand terms of the expression */
 
   /* begin with the initial term */
-  if ((expression_text = output_term (expression->term))) {
-    rhterm = expression->next;
-    while (! this->priv->errors->get_code (this->priv->errors) && rhterm) {
-
-      /* ascertain the operator text */
-      switch (rhterm->op) {
-      case EXPRESSION_OPERATOR_PLUS:
-        operator_char = '+';
-        break;
-      case EXPRESSION_OPERATOR_MINUS:
-        operator_char = '-';
-        break;
-      default:
-        this->priv->errors->set_code
-	  (this->priv->errors, E_INVALID_EXPRESSION, 0, 0, 0);
-        free (expression_text);
-        expression_text = NULL;
-      }
-
-      /* get the terms that follow the operators */
-      if (! this->priv->errors->get_code (this->priv->errors)
-        && (term_text = output_term (rhterm->term))) {
-        expression_text = expression_text== NULL ? NULL : ((TCHAR*)_realloc (expression_text,
-          strlen (expression_text) + strlen (term_text) + 2));
-        if(expression_text!=NULL)
-            snprintf (expression_text, strlen(expression_text) + strlen(term_text) + 2, _T("%s%c%s"), expression_text, operator_char,
-          term_text);
-        free (term_text);
-      }
+  if (! string_buffer_init (&expression_text))
+    return NULL;
+  term_text = output_term (formatter, expression->term);
+  string_buffer_append (&expression_text, term_text);
+  rhterm = expression->next;
+  while (term_text && rhterm
+    && ! formatter->priv->errors->get_code (formatter->priv->errors)) {
+    free (term_text);
+    term_text = NULL;
+
+    /* ascertain the operator text */
+    switch (rhterm->op) {
+    case EXPRESSION_OPERATOR_PLUS:
+      string_buffer_append (&expression_text, _T("+"));
+      break;
+    case EXPRESSION_OPERATOR_MINUS:
+      string_buffer_append (&expression_text, _T("-"));
+      break;
+    default:
+      formatter->priv->errors->set_code
+        (formatter->priv->errors, E_INVALID_EXPRESSION, 0, 0, 0);
+    }
 
-      /* look for another term on the right of the expression */
-      rhterm = rhterm->next;
+    /* get the terms that follow the operators */
+    if (! formatter->priv->errors->get_code (formatter->priv->errors)) {
+      term_text = output_term (formatter, rhterm->term);
+      string_buffer_append (&expression_text, term_text);
     }
-  }
 
-  /* return the expression text */
-  return expression_text;
+    /* look for another term on the right of the expression */
+    rhterm = rhterm->next;
+  }
 
+  /* return the expression text, unless something went wrong */
+  if (term_text
+    && ! formatter->priv->errors->get_code (formatter->priv->errors)) {
+    free (term_text);
+    return string_buffer_release (&expression_text);
+  }
+  free (term_text);
+  free (string_buffer_release (&expression_text));
+  return NULL;
 }
 
 /*
  * LET statement output
  * params:
+ *   Formatter*          formatter   the formatter
  *   LetStatementNode*   letn   data for the LET statement
  * returns:
  *   TCHAR*                      the LET statement text
  */
-static TCHAR *output_let (LetStatementNode *letn) {
+static TCHAR *output_let (Formatter *formatter, LetStatementNode *letn) {
 
   /* local variables */
   TCHAR
@@ -229,13 +238,13 @@ static TCHAR *output_let (LetStatementNode *letn) {
     *expression_text = NULL; /* the text of the expression */
 
   /* assemble the expression */
-  expression_text = output_expression (letn->expression);
+  expression_text = output_expression (formatter, letn->expression);
 
   /* assemble the final LET text, if we have an expression */
   if (expression_text) {
-    let_text = _malloc (7 + strlen (expression_text));
+    let_text = _malloc (strlen (FORMATTER_LET) + strlen (expression_text));
     if(let_text!=NULL)
-        snprintf (let_text, 7 + strlen(expression_text), FORMATTER_LET, _T('A') - 1 + letn->variable, expression_text);
+        snprintf (let_text, strlen (FORMATTER_LET) + strlen(expression_text), FORMATTER_LET, _T('A') - 1 + letn->variable, expression_text);
     free (expression_text);
   }
 
@@ -247,11 +256,12 @@ static TCHAR *output_let (LetStatementNode *letn) {
 /*
  * IF statement output
  * params:
+ *   Formatter*         formatter   the formatter
  *   IfStatementNode*   ifn   data for the IF statement
  * returns:
  *   TCHAR*                    the IF statement text
  */
-static TCHAR *output_if (IfStatementNode *ifn) {
+static TCHAR *output_if (Formatter *formatter, IfStatementNode *ifn) {
 
   /* local variables */
   TCHAR
@@ -262,9 +272,9 @@ static TCHAR *output_if (IfStatementNode *ifn) {
     *statement_text = NULL; /* the text of the conditional statement */
 
   /* assemble the expressions and conditional statement */
-  left_text = output_expression (ifn->left);
-  right_text = output_expression (ifn->right);
-  statement_text = output_statement (ifn->statement);
+  left_text = output_expression (formatter, ifn->left);
+  right_text = output_expression (formatter, ifn->right);
+  statement_text = output_statement (formatter, ifn->statement);
 
   /* work out the operator text */
   op_text = _malloc (3);
@@ -280,11 +290,11 @@ static TCHAR *output_if (IfStatementNode *ifn) {
 
   /* assemble the final IF text, if we have everything we need */
   if (left_text && op_text && right_text && statement_text) {
-    if_text = _malloc (3 + strlen (left_text) + strlen (op_text) +
-      strlen (right_text) + 6 + strlen (statement_text) + 1);
+    if_text = _malloc (strlen (FORMATTER_IF_THEN) + strlen (left_text)
+      + strlen (op_text) + strlen (right_text) + strlen (statement_text));
     if(if_text!=NULL)
-        snprintf (if_text, 3 + strlen(left_text) + strlen(op_text) +
-            strlen(right_text) + 6 + strlen(statement_text) + 1,
+        snprintf (if_text, strlen (FORMATTER_IF_THEN) + strlen(left_text)
+            + strlen(op_text) + strlen(right_text) + strlen(statement_text),
             FORMATTER_IF_THEN, left_text, op_text, right_text,
           statement_text);
   }
@@ -303,11 +313,12 @@ static TCHAR *output_if (IfStatementNode *ifn) {
 /*
  * GOTO statement output
  * params:
+ *   Formatter*           formatter   the formatter
  *   GotoStatementNode*   goton   data for the GOTO statement
  * returns:
  *   TCHAR*                        the GOTO statement text
  */
-static TCHAR *output_goto (GotoStatementNode *goton) {
+static TCHAR *output_goto (Formatter *formatter, GotoStatementNode *goton) {
 
   /* local variables */
   TCHAR
@@ -315,13 +326,13 @@ static TCHAR *output_goto (GotoStatementNode *goton) {
     *expression_text = NULL; /* the text of the expression */
 
   /* assemble the expression */
-  expression_text = output_expression (goton->label);
+  expression_text = output_expression (formatter, goton->label);
 
   /* assemble the final LET text, if we have an expression */
   if (expression_text) {
-    goto_text = _malloc (6 + strlen (expression_text));
+    goto_text = _malloc (strlen (FORMATTER_GOTO) + strlen (expression_text));
     if(goto_text!=NULL)
-        snprintf (goto_text, 6 + strlen(expression_text),FORMATTER_GOTO, expression_text);
+        snprintf (goto_text, strlen (FORMATTER_GOTO) + strlen(expression_text),FORMATTER_GOTO, expression_text);
     free (expression_text);
   }
 
@@ -333,11 +344,12 @@ static TCHAR *output_goto (GotoStatementNode *goton) {
 /*
  * GOSUB statement output
  * params:
+ *   Formatter*            formatter   the formatter
  *   GosubStatementNode*   gosubn   data for the GOSUB statement
  * returns:
  *   TCHAR*                        the GOSUB statement text
  */
-static TCHAR *output_gosub (GosubStatementNode *gosubn) {
+static TCHAR *output_gosub (Formatter *formatter, GosubStatementNode *gosubn) {
 
   /* local variables */
   TCHAR
@@ -345,13 +357,13 @@ static TCHAR *output_gosub (GosubStatementNode *gosubn) {
     *expression_text = NULL; /* the text of the expression */
 
   /* assemble the expression */
-  expression_text = output_expression (gosubn->label);
+  expression_text = output_expression (formatter, gosubn->label);
 
   /* assemble the final LET text, if we have an expression */
   if (expression_text) {
-    gosub_text = _malloc (7 + strlen (expression_text));
+    gosub_text = _malloc (strlen (FORMATTER_GOSUB) + strlen (expression_text));
     if(gosub_text !=NULL)
-        snprintf (gosub_text, 7 + strlen(expression_text), FORMATTER_GOSUB, expression_text);
+        snprintf (gosub_text, strlen (FORMATTER_GOSUB) + strlen(expression_text), FORMATTER_GOSUB, expression_text);
     free (expression_text);
   }
 
@@ -367,7 +379,7 @@ static TCHAR *output_gosub (GosubStatementNode *gosubn) {
  */
 static TCHAR *output_end (void) {
   TCHAR *end_text; /* the full text of the END command */
-  end_text = _malloc (4);
+  end_text = _malloc (strlen (KEYWORD_END) + 1);
   if(end_text!=NULL)
       strcpy (end_text, KEYWORD_END);
   return end_text;
@@ -381,7 +393,7 @@ static TCHAR *output_end (void) {
  */
 static TCHAR *output_return (void) {
   TCHAR *return_text; /* the full text of the RETURN command */
-  return_text = _malloc (7);
+  return_text = _malloc (strlen (KEYWORD_RETURN) + 1);
   if(return_text!=NULL)
       strcpy (return_text, KEYWORD_RETURN);
   return return_text;
@@ -391,11 +403,12 @@ static TCHAR *output_return (void) {
 /*
  * PRINT statement output
  * params:
+ *   Formatter*            formatter   the formatter
  *   PrintStatementNode*   printn   data for the PRINT statement
  * returns:
  *   TCHAR*                          the PRINT statement text
  */
-static TCHAR *output_print (PrintStatementNode *printn) {
+static TCHAR *output_print (Formatter *formatter, PrintStatementNode *printn) {
 
   /* local variables */
   TCHAR
@@ -404,7 +417,7 @@ static TCHAR *output_print (PrintStatementNode *printn) {
   OutputNode *output; /* the current output item */
 
   /* initialise the PRINT statement */
-  print_text = _malloc (6);
+  print_text = _malloc (strlen (KEYWORD_PRINT) + 1);
   if (print_text == NULL) return NULL;
   strcpy (print_text, KEYWORD_PRINT);
 
@@ -425,7 +438,7 @@ static TCHAR *output_print (PrintStatementNode *printn) {
             snprintf (output_text, strlen(output->output.string) + 3,_T("%c%s%c"), _T('"'), output->output.string, _T('"'));
         break;
       case OUTPUT_EXPRESSION:
-        output_text = output_expression (output->output.expression);
+        output_text = output_expression (formatter, output->output.expression);
         break;
       }
       if (output_text != NULL) {
@@ -461,7 +474,7 @@ static TCHAR *output_input (InputStatementNode *inputn) {
   VariableListNode *variable; /* the current output item */
 
   /* initialise the INPUT statement */
-  input_text = _malloc (6);
+  input_text = _malloc (strlen (KEYWORD_INPUT) + 1);
   if(input_text!=NULL)
       strcpy (input_text, KEYWORD_INPUT);
 
@@ -485,11 +498,12 @@ static TCHAR *output_input (InputStatementNode *inputn) {
 /*
  * PEEK statement output
  * params:
+ *   Formatter*           formatter   the formatter
  *   PeekStatementNode*   peekn   data for the PEEK statement
  * returns:
  *   TCHAR*                      the PEEK statement text
  */
-static TCHAR* output_peek(PeekStatementNode* peekn) {
+static TCHAR* output_peek(Formatter *formatter, PeekStatementNode* peekn) {
 
     /* local variables */
     TCHAR
@@ -497,7 +511,7 @@ static TCHAR* output_peek(PeekStatementNode* peekn) {
         * address_text = NULL; /* the text of the expression */
 
     /* assemble the expression */
-    address_text = output_expression(peekn->address);
+    address_text = output_expression(formatter, peekn->address);
 
     /* assemble the final LET text, if we have an expression */
     if (address_text) {
@@ -513,11 +527,12 @@ static TCHAR* output_peek(PeekStatementNode* peekn) {
 /*
  * PEEK statement output
  * params:
+ *   Formatter*           formatter   the formatter
  *   PeekStatementNode*   peekn   data for the PEEK statement
  * returns:
  *   TCHAR*                      the PEEK statement text
  */
-static TCHAR* output_poke(PokeStatementNode* poken) {
+static TCHAR* output_poke(Formatter *formatter, PokeStatementNode* poken) {
 
     /* local variables */
     TCHAR
@@ -525,8 +540,8 @@ static TCHAR* output_poke(PokeStatementNode* poken) {
         * address_text = NULL, /* the text of the expression */
         *value_text = NULL;
     /* assemble the expression */
-    address_text = output_expression(poken->address);
-    value_text = output_expression(poken->value);
+    address_text = output_expression(formatter, poken->address);
+    value_text = output_expression(formatter, poken->value);
     /* assemble the final POKE text, if we have an expression */
     if (address_text) {
         poke_text = _malloc(8 + strlen(address_text) + strlen(value_text));
@@ -543,11 +558,12 @@ static TCHAR* output_poke(PokeStatementNode* poken) {
 /*
  * Statement output
  * params:
+ *   Formatter*       formatter   the formatter
  *   StatementNode*   statement   the statement to output
  * returns:
  *   TCHAR*                        a string containing the statement line
  */
-static TCHAR *output_statement (StatementNode *statement) {
+static TCHAR *output_statement (Formatter *formatter, StatementNode *statement) {
 
   /* local variables */
   TCHAR *output = NULL; /* the text output */
@@ -559,16 +575,16 @@ static TCHAR *output_statement (StatementNode *statement) {
   /* build the statement itself */
   switch (statement->class) {
     case STATEMENT_LET:
-      output = output_let (statement->statement.letn);
+      output = output_let (formatter, statement->statement.letn);
       break;
     case STATEMENT_IF:
-      output = output_if (statement->statement.ifn);
+      output = output_if (formatter, statement->statement.ifn);
       break;
     case STATEMENT_GOTO:
-      output = output_goto (statement->statement.goton);
+      output = output_goto (formatter, statement->statement.goton);
       break;
     case STATEMENT_GOSUB:
-      output = output_gosub (statement->statement.gosubn);
+      output = output_gosub (formatter, statement->statement.gosubn);
       break;
     case STATEMENT_RETURN:
       output = output_return ();
@@ -577,16 +593,16 @@ static TCHAR *output_statement (StatementNode *statement) {
       output = output_end ();
      break;
     case STATEMENT_PRINT:
-      output = output_print (statement->statement.printn);
+      output = output_print (formatter, statement->statement.printn);
       break;
     case STATEMENT_INPUT:
       output = output_input (statement->statement.inputn);
       break;
     case STATEMENT_PEEK:
-        output = output_peek(statement->statement.peekn);
+        output = output_peek(formatter, statement->statement.peekn);
         break;
     case STATEMENT_POKE:
-        output = output_poke(statement->statement.poken);
+        output = output_poke(formatter, statement->statement.poken);
         break;
     default:
       output = _malloc (24);
@@ -601,36 +617,31 @@ static TCHAR *output_statement (StatementNode *statement) {
 /*
  * Program Line Output
  * params:
+ *   Formatter*         formatter        the formatter
  *   ProgramLineNode*   program_line     the line to output
  */
-static void generate_line (ProgramLineNode *program_line) {
+static void generate_line (Formatter *formatter, ProgramLineNode *program_line) {
 
   /* local variables */
   TCHAR
-    label_text [7], /* line label text */
-    *output = NULL, /* the rest of the output */
-    *line_text = NULL; /* the assembled line */
+    label_text [24], /* line label text */
+    *output = NULL; /* the rest of the output */
 
   /* initialise the line label */
   if (program_line->label)
-    snprintf (label_text, 7, _T("%5d "), program_line->label);
+    snprintf (label_text, 24, _T("%5d "), program_line->label);
   else
     strcpy (label_text,  _T("      "));
 
   /* build the statement itself */
-  output = output_statement (program_line->statement);
+  output = output_statement (formatter, program_line->statement);
 
   /* if this wasn't a comment, add it to the program */
   if (output) {
-    line_text = _malloc (strlen (label_text) + strlen (output) + 2);
-    if(line_text!=NULL)
-        snprintf (line_text, strlen(label_text) + strlen(output) + 2, _T("%s%s\n"), label_text, output);
+    string_buffer_append (&formatter->priv->listing, label_text);
+    string_buffer_append (&formatter->priv->listing, output);
+    string_buffer_append (&formatter->priv->listing, _T("\n"));
     free (output);
-    this->output = this->output==NULL?NULL:((TCHAR*)_realloc (this->output,
-        strlen(this->output) + (line_text == NULL ? 0 : strlen(line_text)) + 1));
-    if(this->output!=NULL && line_text!=NULL)
-        strcat (this->output, line_text);
-    free (line_text);
   }
 }
 
@@ -651,15 +662,20 @@ static void generate (Formatter *formatter, ProgramNode *program) {
   /* local variables */
   ProgramLineNode *program_line; /* line to process */
 
-  /* initialise this object */
-  this = formatter;
-
   /* generate the code for the lines */
+  string_buffer_init (&formatter->priv->listing);
+  string_buffer_append (&formatter->priv->listing, formatter->output);
   program_line = program->first;
   while (program_line) {
-    generate_line (program_line);
+    generate_line (formatter, program_line);
     program_line = program_line->next;
   }
+
+  /* hand over the listing, unless memory ran out while building it */
+  free (formatter->output);
+  if (! (formatter->output = string_buffer_release (&formatter->priv->listing)))
+    formatter->priv->errors->set_code
+      (formatter->priv->errors, E_MEMORY, 0, 0, 0);
 }
 
 /*
@@ -692,29 +708,32 @@ static void destroy (Formatter *formatter) {
  */
 Formatter *new_Formatter (ErrorHandler *errors) {
 
+  /* local variables */
+  Formatter *formatter; /* the new formatter */
+
   /* allocate memory */
-  this = malloc (sizeof (Formatter));
-  if (this == NULL)return NULL;
-  this->priv = malloc (sizeof (FormatterData));
-  if (this->priv == NULL) {
-      free(this);
+  formatter = malloc (sizeof (Formatter));
+  if (formatter == NULL)return NULL;
+  formatter->priv = malloc (sizeof (FormatterData));
+  if (formatter->priv == NULL) {
+      free(formatter);
       return NULL;
   }
   /* initialise methods */
-  this->generate = generate;
-  this->destroy = destroy;
+  formatter->generate = generate;
+  formatter->destroy = destroy;
 
   /* initialise properties */
-  this->output = malloc (sizeof (TCHAR));
-  if (this->output == NULL)
+  formatter->output = malloc (sizeof (TCHAR));
+  if (formatter->output == NULL)
   {
-      free(this->priv);
-      free(this);
+      free(formatter->priv);
+      free(formatter);
       return NULL;
   }
-  *this->output = '\0';
-  this->priv->errors = errors;
+  *formatter->output = '\0';
+  formatter->priv->errors = errors;
 
   /* return the new object */
-  return this;
+  return formatter;
 }
@@ -18,11 +18,21 @@
 #include "parser.h"
 #include "options.h"
 #include "generatec.h"
+#include "cfg.h"
+#include "stringbuffer.h"
 
 
 #define GENERATOR_INCLUDE_STDIO   _T("#include <stdio.h>\n")
 #define GENERATOR_INCLUDE_STDLIB  _T("#include <stdlib.h>\n")
 #define GENERATOR_DEFINE_ERROR    _T("#define E_RETURN_WITHOUT_GOSUB %d\n")
+#define GENERATOR_DEFINE_GOSUBS   _T("#define E_TOO_MANY_GOSUBS %d\n")
+#define GENERATOR_DEFINE_LIMIT    _T("#define GOSUB_LIMIT %d\n")
+#define GENERATOR_DEFINE_DIVIDE   _T("#define E_DIVIDE_BY_ZERO %d\n")
+#define GENERATOR_DEFINE_OVERFLOW _T("#define E_OVERFLOW %d\n")
+#define GENERATOR_DEFINE_LINE     _T("#define E_INVALID_LINE_NUMBER %d\n")
+
+/* the goto block tests this many labels in turn once its search is narrow */
+#define GENERATOR_LABEL_RUN       4
 
 
 /*
@@ -30,28 +40,27 @@
  */
 
 
-/* label list */
-typedef struct label {
-  int number; /* the label number */
-  struct label *next; /* the next label */
-} CLabel;
-
 /* private data */
 typedef struct {
   unsigned int input_used:1; /* true if we need the input routine */
+  unsigned int return_used:1; /* true if there is a RETURN statement */
+  unsigned int add_used:1; /* true if we need the addition routine */
+  unsigned int subtract_used:1; /* true if we need the subtraction routine */
+  unsigned int multiply_used:1; /* true if we need the multiplication routine */
+  unsigned int divide_used:1; /* true if we need the division routine */
+  unsigned int negate_used:1; /* true if we need the negation routine */
+  unsigned int computed_used:1; /* true if a jump needs the goto block */
   unsigned long int vars_used:26; /* true for each variable used */
-  CLabel *first_label; /* the start of a list of labels */
-  TCHAR *code; /* the main block of generated code */
+  int *labels; /* the labels that jumps can reach */
+  int label_count; /* number of labels */
+  int label_size; /* number of labels there is room for */
+  int gosub_count; /* number of GOSUBs, each with its own return point */
+  StringBuffer code; /* the main block of generated code */
+  StringBuffer output; /* the whole program as it is put together */
   ErrorHandler *errors; /* error handler for compilation */
   LanguageOptions *options; /* the language options for compilation */
 } FileTokenizerPrivateData;
 
-/* convenience variables */
-static CProgram *this; /* the object being worked on */
-static FileTokenizerPrivateData *data; /* the private data of the object */
-static ErrorHandler *errors; /* the error handler */
-static LanguageOptions *options; /* the language options */
-
 
 /*
  * Forward References
@@ -59,10 +68,10 @@ static LanguageOptions *options; /* the language options */
 
 
 /* factor_output() has a forward reference to output_expression() */
-static TCHAR *output_expression (ExpressionNode *expression);
+static TCHAR *output_expression (CProgram *c_program, ExpressionNode *expression);
 
 /* output_statement() has a forward reference from output_if() */
-static TCHAR *output_statement (StatementNode *statement);
+static TCHAR *output_statement (CProgram *c_program, StatementNode *statement);
 
 
 /*
@@ -73,13 +82,15 @@ static TCHAR *output_statement (StatementNode *statement);
 /*
  * Output a factor
  * params:
+ *   CProgram*     c_program   the C program
  *   FactorNode*   factor   the factor to output
  * return:
  *   TCHAR*                  the text representation of the factor
  */
-static TCHAR *output_factor (FactorNode *factor) {
+static TCHAR *output_factor (CProgram *c_program, FactorNode *factor) {
 
   /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
   TCHAR *factor_text = NULL, /* the text of the whole factor */
     *factor_buffer = NULL, /* temporary buffer for prepending to factor_text */
     *expression_text = NULL; /* the text of a subexpression */
@@ -93,12 +104,12 @@ static TCHAR *output_factor (FactorNode *factor) {
       data->vars_used |= 1 << (factor->data.variable - 1);
       break;
     case FACTOR_VALUE:
-      factor_text = _malloc (7);
+      factor_text = _malloc (12);
       if (factor_text != NULL)
-          snprintf (factor_text, 7, _T("%d"), factor->data.value);
+          snprintf (factor_text, 12, _T("%d"), factor->data.value);
       break;
     case FACTOR_EXPRESSION:
-      if ((expression_text = output_expression (factor->data.expression))) {
+      if ((expression_text = output_expression (c_program, factor->data.expression))) {
         factor_text = _malloc (strlen (expression_text) + 3);
         if (factor_text != NULL)
             snprintf (factor_text, strlen(expression_text) + 3, _T("(%s)"), expression_text);
@@ -106,16 +117,24 @@ static TCHAR *output_factor (FactorNode *factor) {
       }
       break;
     default:
-      errors->set_code (errors, E_INVALID_EXPRESSION, 0, 0, 0);
+      data->errors->set_code (data->errors, E_INVALID_EXPRESSION, 0, 0, 0);
   }
 
-  /* apply a negative sign, if necessary */
-  if (factor_text && factor->sign == SIGN_NEGATIVE) {
+  /* apply a negative sign, if necessary; only a constant cannot overflow */
+  if (factor_text && factor->sign == SIGN_NEGATIVE
+    && factor->class == FACTOR_VALUE) {
     factor_buffer = _malloc (strlen (factor_text) + 2);
     if(factor_buffer!=NULL)
         snprintf (factor_buffer, strlen(factor_text) + 2, _T("-%s"), factor_text);
     free (factor_text);
     factor_text = factor_buffer;
+  } else if (factor_text && factor->sign == SIGN_NEGATIVE) {
+    factor_buffer = _malloc (strlen (factor_text) + 10);
+    if(factor_buffer!=NULL)
+        snprintf (factor_buffer, strlen(factor_text) + 10, _T("bas_neg(%s)"), factor_text);
+    free (factor_text);
+    factor_text = factor_buffer;
+    data->negate_used = 1;
   }
 
   /* return the final factor representation */
@@ -123,63 +142,119 @@ static TCHAR *output_factor (FactorNode *factor) {
 }
 
 
+/*
+ * Output the routines that carry out a term's operations, innermost last
+ * params:
+ *   CProgram*          c_program   the C program
+ *   StringBuffer*      term_text   the term text to append them to
+ *   RightHandFactor*   rhfactor    the first operation still to output
+ */
+static void output_term_operators (CProgram *c_program,
+  StringBuffer *term_text, RightHandFactor *rhfactor) {
+
+  /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
+
+  /* the last operation is applied outermost */
+  if (! rhfactor)
+    return;
+  output_term_operators (c_program, term_text, rhfactor->next);
+  switch (rhfactor->op) {
+    case TERM_OPERATOR_MULTIPLY:
+      string_buffer_append (term_text, _T("bas_mul("));
+      data->multiply_used = 1;
+      break;
+    case TERM_OPERATOR_DIVIDE:
+      string_buffer_append (term_text, _T("bas_div("));
+      data->divide_used = 1;
+      break;
+    default:
+      data->errors->set_code (data->errors, E_INVALID_EXPRESSION, 0, 0, 0);
+  }
+}
+
+
 /*
  * Level 5 Functions
  */
 
 
+/*
+ * Output the routines that carry out an expression's operations
+ * params:
+ *   CProgram*         c_program         the C program
+ *   StringBuffer*     expression_text   the text to append them to
+ *   RightHandTerm*    rhterm            the first operation still to output
+ */
+static void output_expression_operators (CProgram *c_program,
+  StringBuffer *expression_text, RightHandTerm *rhterm) {
+
+  /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
+
+  /* the last operation is applied outermost */
+  if (! rhterm)
+    return;
+  output_expression_operators (c_program, expression_text, rhterm->next);
+  switch (rhterm->op) {
+    case EXPRESSION_OPERATOR_PLUS:
+      string_buffer_append (expression_text, _T("bas_add("));
+      data->add_used = 1;
+      break;
+    case EXPRESSION_OPERATOR_MINUS:
+      string_buffer_append (expression_text, _T("bas_sub("));
+      data->subtract_used = 1;
+      break;
+    default:
+      data->errors->set_code (data->errors, E_INVALID_EXPRESSION, 0, 0, 0);
+  }
+}
+
+
 /*
  * Output a term
  * params:
+ *   CProgram*   c_program   the C program
  *   TermNode*   term   the term to output
  * returns:
  *   TCHAR*              the text representation of the term
  */
-static TCHAR *output_term (TermNode *term) {
+static TCHAR *output_term (CProgram *c_program, TermNode *term) {
 
   /* local variables */
-  TCHAR
-    *term_text = NULL, /* the text of the whole term */
-    *factor_text = NULL, /* the text of each factor */
-    operator_char; /* the operator that joins the righthand factor */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
+  StringBuffer term_text; /* the text of the whole term */
+  TCHAR *factor_text = NULL; /* the text of each factor */
   RightHandFactor *rhfactor; /* right hand factors of the expression */
 
-  /* begin with the initial factor */
-  if ((term_text = output_factor (term->factor))) {
-    rhfactor = term->next;
-    while (! errors->get_code (errors) && rhfactor) {
-
-      /* ascertain the operator text */
-      switch (rhfactor->op) {
-      case TERM_OPERATOR_MULTIPLY:
-        operator_char = '*';
-        break;
-      case TERM_OPERATOR_DIVIDE:
-        operator_char = '/';
-        break;
-      default:
-        errors->set_code (errors, E_INVALID_EXPRESSION, 0, 0, 0);
-        free (term_text);
-        term_text = NULL;
-      }
+  /* begin with the operations' routines, then the initial factor */
+  if (! string_buffer_init (&term_text))
+    return NULL;
+  output_term_operators (c_program, &term_text, term->next);
+  factor_text = output_factor (c_program, term->factor);
+  string_buffer_append (&term_text, factor_text);
+  rhfactor = term->next;
+  while (factor_text && rhfactor && ! data->errors->get_code (data->errors)) {
+    free (factor_text);
 
-      /* get the factor that follows the operator */
-      if (! errors->get_code (errors)
-        && (factor_text = output_factor (rhfactor->factor))) {
-        term_text = term_text==NULL?NULL:(_realloc(term_text,
-          strlen (term_text) + strlen (factor_text) + 2));
-        if(term_text!=NULL)
-            snprintf (term_text, strlen(term_text) + strlen(factor_text) + 2, _T("%s%c%s"), term_text, operator_char, factor_text);
-        free (factor_text);
-      }
+    /* pass the factor that follows the operator to its routine */
+    factor_text = output_factor (c_program, rhfactor->factor);
+    string_buffer_append (&term_text, _T(","));
+    string_buffer_append (&term_text, factor_text);
+    string_buffer_append (&term_text, _T(")"));
 
-      /* look for another term on the right of the expression */
-      rhfactor = rhfactor->next;
-    }
+    /* look for another term on the right of the expression */
+    rhfactor = rhfactor->next;
   }
 
-  /* return the expression text */
-  return term_text;
+  /* return the term text, unless something went wrong */
+  if (factor_text && ! data->errors->get_code (data->errors)) {
+    free (factor_text);
+    return string_buffer_release (&term_text);
+  }
+  free (factor_text);
+  free (string_buffer_release (&term_text));
+  return NULL;
 }
 
 
@@ -191,57 +266,84 @@ static TCHAR *output_term (TermNode *term) {
 /*
  * Output an expression for a program listing
  * params:
+ *   CProgram*         c_program    the C program
  *   ExpressionNode*   expression   the expression to output
  * returns:
  *   TCHAR*                          new string containint the expression text
  */
-static TCHAR *output_expression (ExpressionNode *expression) {
+static TCHAR *output_expression (CProgram *c_program, ExpressionNode *expression) {
 
   /* local variables */
-  TCHAR
-    *expression_text = NULL, /* the text of the whole expression */
-    *term_text = NULL, /* the text of each term */
-    operator_char=' '; /* the operator that joins the righthand term */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
+  StringBuffer expression_text; /* the text of the whole expression */
+  TCHAR *term_text = NULL; /* the text of each term */
   RightHandTerm *rhterm; /* right hand terms of the expression */
 
-  /* begin with the initial term */
-  if ((expression_text = output_term (expression->term))) {
-    rhterm = expression->next;
-    while (! errors->get_code (errors) && rhterm) {
-
-      /* ascertain the operator text */
-      switch (rhterm->op) {
-      case EXPRESSION_OPERATOR_PLUS:
-        operator_char = '+';
-        break;
-      case EXPRESSION_OPERATOR_MINUS:
-        operator_char = '-';
-        break;
-      default:
-        errors->set_code (errors, E_INVALID_EXPRESSION, 0, 0, 0);
-        free (expression_text);
-        expression_text = NULL;
-      }
+  /* begin with the operations' routines, then the initial term */
+  if (! string_buffer_init (&expression_text))
+    return NULL;
+  output_expression_operators (c_program, &expression_text, expression->next);
+  term_text = output_term (c_program, expression->term);
+  string_buffer_append (&expression_text, term_text);
+  rhterm = expression->next;
+  while (term_text && rhterm && ! data->errors->get_code (data->errors)) {
+    free (term_text);
+
+    /* pass the term that follows the operator to its routine */
+    term_text = output_term (c_program, rhterm->term);
+    string_buffer_append (&expression_text, _T(","));
+    string_buffer_append (&expression_text, term_text);
+    string_buffer_append (&expression_text, _T(")"));
+
+    /* look for another term on the right of the expression */
+    rhterm = rhterm->next;
+  }
 
-      /* get the terms that follow the operators */
-      if (! errors->get_code (errors)
-        && (term_text = output_term (rhterm->term))) {
-        expression_text = expression_text==NULL?NULL:(_realloc (expression_text,
-          strlen (expression_text) + strlen (term_text) + 2));
-        if(expression_text!=NULL)
-        snprintf (expression_text, strlen(expression_text) + strlen(term_text) + 2, _T("%s%c%s"), expression_text, operator_char,
-          term_text);
-        free (term_text);
-      }
+  /* return the expression text, unless something went wrong */
+  if (term_text && ! data->errors->get_code (data->errors)) {
+    free (term_text);
+    return string_buffer_release (&expression_text);
+  }
+  free (term_text);
+  free (string_buffer_release (&expression_text));
+  return NULL;
+}
 
-      /* look for another term on the right of the expression */
-      rhterm = rhterm->next;
-    }
+/*
+ * Output a jump to a line, straight to its label if it is constant
+ * params:
+ *   CProgram*          c_program   the C program
+ *   ProgramLineNode*   target      the line, if its label is constant
+ *   ExpressionNode*    label       the expression giving the label
+ * returns:
+ *   TCHAR*                         the text of the jump
+ */
+static TCHAR *output_jump (CProgram *c_program, ProgramLineNode *target,
+  ExpressionNode *label) {
+
+  /* local variables */
+  TCHAR
+    *jump_text = NULL, /* the jump text to be assembled */
+    *expression_text = NULL; /* the text of the expression */
+
+  /* a constant label can be jumped to directly */
+  if (target && target->label) {
+    jump_text = _malloc (24);
+    if (jump_text != NULL)
+      snprintf (jump_text, 24, _T("goto lbl_%d;"), target->label);
+    return jump_text;
   }
 
-  /* return the expression text */
-  return expression_text;
+  /* any other label is found by the goto block */
+  if ((expression_text = output_expression (c_program, label))) {
+    jump_text = _malloc (27 + strlen (expression_text));
+    if(jump_text!=NULL)
+        snprintf (jump_text, 27 + strlen(expression_text), _T("label=%s; goto goto_block;"), expression_text);
+    free (expression_text);
+  }
 
+  /* return it */
+  return jump_text;
 }
 
 
@@ -253,19 +355,21 @@ static TCHAR *output_expression (ExpressionNode *expression) {
 /*
  * LET statement output
  * params:
+ *   CProgram*           c_program   the C program
  *   LetStatementNode*   letn   data for the LET statement
  * returns:
  *   TCHAR*                      the LET statement text
  */
-static TCHAR *output_let (LetStatementNode *letn) {
+static TCHAR *output_let (CProgram *c_program, LetStatementNode *letn) {
 
   /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
   TCHAR
     *let_text = NULL, /* the LET text to be assembled */
     *expression_text = NULL; /* the text of the expression */
 
   /* assemble the expression */
-  expression_text = output_expression (letn->expression);
+  expression_text = output_expression (c_program, letn->expression);
 
   /* assemble the final LET text, if we have an expression */
   if (expression_text) {
@@ -283,11 +387,12 @@ static TCHAR *output_let (LetStatementNode *letn) {
 /*
  * IF statement output
  * params:
+ *   CProgram*          c_program   the C program
  *   IfStatementNode*   ifn   data for the IF statement
  * returns:
  *   TCHAR*                    the IF statement text
  */
-static TCHAR *output_if (IfStatementNode *ifn) {
+static TCHAR *output_if (CProgram *c_program, IfStatementNode *ifn) {
 
   /* local variables */
   TCHAR
@@ -298,9 +403,9 @@ static TCHAR *output_if (IfStatementNode *ifn) {
     *statement_text = NULL; /* the text of the conditional statement */
 
   /* assemble the expressions and conditional statement */
-  left_text = output_expression (ifn->left);
-  right_text = output_expression (ifn->right);
-  statement_text = output_statement (ifn->statement);
+  left_text = output_expression (c_program, ifn->left);
+  right_text = output_expression (c_program, ifn->right);
+  statement_text = output_statement (c_program, ifn->statement);
 
   /* work out the operator text */
   op_text = _malloc (3);
@@ -337,55 +442,45 @@ static TCHAR *output_if (IfStatementNode *ifn) {
 /*
  * GOTO statement output
  * params:
+ *   CProgram*            c_program   the C program
  *   GotoStatementNode*   goton   data for the GOTO statement
  * returns:
  *   TCHAR*                        the GOTO statement text
  */
-static TCHAR *output_goto (GotoStatementNode *goton) {
-
-  /* local variables */
-  TCHAR
-    *goto_text = NULL, /* the GOTO text to be assembled */
-    *expression_text = NULL; /* the text of the expression */
-
-  /* assemble the expression */
-  expression_text = output_expression (goton->label);
-
-  /* assemble the final LET text, if we have an expression */
-  if (expression_text) {
-    goto_text = _malloc (27 + strlen (expression_text));
-    if(goto_text!=NULL)
-        snprintf (goto_text, 27 + strlen(expression_text), _T("label=%s; goto goto_block;"), expression_text);
-    free (expression_text);
-  }
-
-  /* return it */
-  return goto_text;
+static TCHAR *output_goto (CProgram *c_program, GotoStatementNode *goton) {
+  return output_jump (c_program, goton->target, goton->label);
 }
 
 /*
  * GOSUB statement output
  * params:
+ *   CProgram*             c_program   the C program
  *   GosubStatementNode*   gosubn   data for the GOSUB statement
  * returns:
  *   TCHAR*                        the GOSUB statement text
  */
-static TCHAR *output_gosub (GosubStatementNode *gosubn) {
+static TCHAR *output_gosub (CProgram *c_program, GosubStatementNode *gosubn) {
 
   /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
   TCHAR
     *gosub_text = NULL, /* the GOSUB text to be assembled */
-    *expression_text = NULL; /* the text of the expression */
+    *jump_text = NULL; /* the text of the jump to the subroutine */
+  size_t length; /* room needed for the GOSUB text */
 
-  /* assemble the expression */
-  expression_text = output_expression (gosubn->label);
+  /* assemble the jump */
+  jump_text = output_jump (c_program, gosubn->target, gosubn->label);
 
-  /* assemble the final LET text, if we have an expression */
-  if (expression_text) {
-    gosub_text = _malloc (12 + strlen (expression_text));
+  /* push the return point, jump to the subroutine, and mark the return */
+  if (jump_text) {
+    length = 128 + strlen (jump_text);
+    gosub_text = _malloc (length);
     if(gosub_text!=NULL)
-        snprintf (gosub_text, 12 + strlen(expression_text), _T("bas_exec(%s);"), expression_text);
-    free (expression_text);
+        snprintf (gosub_text, length, _T("if (bas_top==GOSUB_LIMIT) exit(E_TOO_MANY_GOSUBS);\n")
+          _T("bas_stack[bas_top++]=%d; %s\nret_%d:;"),
+          data->gosub_count, jump_text, data->gosub_count);
+    ++data->gosub_count;
+    free (jump_text);
   }
 
   /* return it */
@@ -407,27 +502,33 @@ static TCHAR *output_end (void) {
 
 /*
  * RETURN statement output
+ * params:
+ *   CProgram*   c_program   the C program
  * returns:
- *   TCHAR*   A new string with the text "RETURN"
+ *   TCHAR*                  the RETURN statement text
  */
-static TCHAR *output_return (void) {
+static TCHAR *output_return (CProgram *c_program) {
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
   TCHAR *return_text; /* the full text of the RETURN command */
-  return_text = _malloc (8);
+  data->return_used = 1;
+  return_text = _malloc (17);
   if(return_text!=NULL)
-      strcpy (return_text, _T("return;"));
+      strcpy (return_text, _T("goto bas_return;"));
   return return_text;
 }
 
 /*
  * PRINT statement output
  * params:
+ *   CProgram*             c_program   the C program
  *   PrintStatementNode*   printn   data for the PRINT statement
  * returns:
  *   TCHAR*                          the PRINT statement text
  */
-static TCHAR *output_print (PrintStatementNode *printn) {
+static TCHAR *output_print (CProgram *c_program, PrintStatementNode *printn) {
 
   /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
   TCHAR
     *format_text = NULL, /* the printf format string */
     *output_list = NULL, /* the printf output list */
@@ -455,15 +556,17 @@ static TCHAR *output_print (PrintStatementNode *printn) {
           break;
         case OUTPUT_EXPRESSION:
           format_text = format_text==NULL?NULL
-              :(_realloc (format_text, strlen (format_text) + 3));
+              :(_realloc (format_text, strlen (format_text) + 5));
           if(format_text!=NULL)
-              strcat (format_text, _T("%d"));
-          output_text = output_expression (output->output.expression);
+              strcat (format_text, data->options->get_integer_width
+                (data->options) == 64 ? _T("%lld") : _T("%d"));
+          output_text = output_expression (c_program, output->output.expression);
           output_list = output_list==NULL?NULL:(_realloc (output_list,
-            strlen (output_list) + 1 + (output_text==NULL?0:strlen (output_text)) + 1));
+            strlen (output_list) + 12 + (output_text==NULL?0:strlen (output_text)) + 1));
           if (output_text != NULL && output_list!=NULL) {
-              strcat(output_list, _T(","));
+              strcat(output_list, _T(",(bas_int)("));
               strcat(output_list, output_text);
+              strcat(output_list, _T(")"));
           }
           free (output_text);
           break;
@@ -487,13 +590,15 @@ static TCHAR *output_print (PrintStatementNode *printn) {
 /*
  * INPUT statement output
  * params:
+ *   CProgram*             c_program   the C program
  *   InputStatementNode*   inputn   the input statement node to show
  * returns:
  *   TCHAR *                         the text of the INPUT statement
  */
-static TCHAR *output_input (InputStatementNode *inputn) {
+static TCHAR *output_input (CProgram *c_program, InputStatementNode *inputn) {
 
   /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
   TCHAR
     *var_text, /* input text for a single variable */
     *input_text; /* the INPUT text to be assembled */
@@ -533,11 +638,12 @@ static TCHAR *output_input (InputStatementNode *inputn) {
 /*
  * Statement output
  * params:
+ *   CProgram*        c_program   the C program
  *   StatementNode*   statement   the statement to output
  * returns:
  *   TCHAR*                        a string containing the statement line
  */
-static TCHAR *output_statement (StatementNode *statement) {
+static TCHAR *output_statement (CProgram *c_program, StatementNode *statement) {
 
   /* local variables */
   TCHAR *output = NULL; /* the text output */
@@ -549,28 +655,28 @@ static TCHAR *output_statement (StatementNode *statement) {
   /* build the statement itself */
   switch (statement->class) {
     case STATEMENT_LET:
-      output = output_let (statement->statement.letn);
+      output = output_let (c_program, statement->statement.letn);
       break;
     case STATEMENT_IF:
-      output = output_if (statement->statement.ifn);
+      output = output_if (c_program, statement->statement.ifn);
       break;
     case STATEMENT_GOTO:
-      output = output_goto (statement->statement.goton);
+      output = output_goto (c_program, statement->statement.goton);
       break;
     case STATEMENT_GOSUB:
-      output = output_gosub (statement->statement.gosubn);
+      output = output_gosub (c_program, statement->statement.gosubn);
       break;
     case STATEMENT_RETURN:
-      output = output_return ();
+      output = output_return (c_program);
       break;
     case STATEMENT_END:
      output = output_end ();
      break;
     case STATEMENT_PRINT:
-      output = output_print (statement->statement.printn);
+      output = output_print (c_program, statement->statement.printn);
       break;
     case STATEMENT_INPUT:
-      output = output_input (statement->statement.inputn);
+      output = output_input (c_program, statement->statement.inputn);
       break;
     default:
       output = _malloc (24);
@@ -588,98 +694,138 @@ static TCHAR *output_statement (StatementNode *statement) {
  */
 
 
+/*
+ * Compare two labels, for sorting the goto block
+ * params:
+ *   const void*   a   the first label
+ *   const void*   b   the second label
+ * returns:
+ *   int               <0, 0 or >0 as a is below, equal to or above b
+ */
+static int compare_labels (const void *a, const void *b) {
+  const int
+    *left = a, /* the first label */
+    *right = b; /* the second label */
+  return (*left > *right) - (*left < *right);
+}
+
 /*
  * Program Line Generation
  * params:
+ *   CProgram*          c_program      the C program
  *   ProgramLineNode*   program_line   the program line to convert
+ *   int                entries        CfgEntry flags if the line leads a block
  */
-static void generate_line (ProgramLineNode *program_line) {
+static void generate_line (CProgram *c_program, ProgramLineNode *program_line,
+  int entries) {
 
   /* local variables */
-  CLabel
-    *prior_label, /* label before potential insertion point */
-    *next_label, /* label after potential insertion point */
-    *new_label; /* a label to insert */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
+  int *labels; /* the label list, when it has to grow */
   TCHAR
-    label_text[12], /* text of a line label */
+    label_text[24], /* text of a line label */
     *statement_text; /* the text of a statement */
 
-  /* generate a line label */
-  if (program_line->label) {
-
-    /* insert the label into the label list */
-    new_label = malloc (sizeof (CLabel));
-    if (new_label != NULL) {
-        new_label->number = program_line->label;
-        new_label->next = NULL;
-        prior_label = NULL;
-        next_label = data->first_label;
-        while (next_label && next_label->number < new_label->number) {
-          prior_label = next_label;
-          next_label = prior_label->next;
-        }
-        new_label->next = next_label;
-        if (prior_label)
-          prior_label->next = new_label;
-        else
-          data->first_label = new_label;
+  /* generate a line label if anything might jump to it */
+  if (program_line->label
+    && entries & (CFG_ENTRY_JUMP | CFG_ENTRY_CALL | CFG_ENTRY_ANY_LINE)) {
+
+    /* only a computed label needs the goto block to find the line */
+    if (entries & CFG_ENTRY_ANY_LINE
+      && data->label_count == data->label_size) {
+      if ((labels = realloc (data->labels,
+        2 * (data->label_size + 1) * sizeof (int)))) {
+        data->labels = labels;
+        data->label_size = 2 * (data->label_size + 1);
+      } else
+        data->errors->set_code (data->errors, E_MEMORY, 0, 0, 0);
     }
+    if (entries & CFG_ENTRY_ANY_LINE && data->label_count < data->label_size)
+      data->labels[data->label_count++] = program_line->label;
 
     /* append the label to the code block */
-    snprintf (label_text,12, _T("lbl_%d:\n"), program_line->label);
-    data->code = data->code==NULL?NULL:(_realloc (data->code,
-      strlen (data->code) + strlen (label_text) + 1));
-    if(data->code!=NULL)
-        strcat (data->code, label_text);
+    snprintf (label_text, 24, _T("lbl_%d:\n"), program_line->label);
+    string_buffer_append (&data->code, label_text);
   }
 
   /* generate the statement, and append it if it is not a comment */
-  statement_text = output_statement (program_line->statement);
+  statement_text = output_statement (c_program, program_line->statement);
   if (statement_text) {
-    data->code = data->code==NULL?NULL:(_realloc (data->code,
-      strlen (data->code) + strlen (statement_text) + 2));
-    if (data->code != NULL) {
-        strcat(data->code, statement_text);
-        strcat(data->code, _T("\n"));
-    }
+    string_buffer_append (&data->code, statement_text);
+    string_buffer_append (&data->code, _T("\n"));
     free (statement_text);
   }
 }
 
 /*
  * Generate the #include lines and #defines
+ * params:
+ *   CProgram*   c_program   the C program
  * changes:
  *   Private*   data   appends headers to the output
  */
-static void generate_includes (void) {
+static void generate_includes (CProgram *c_program) {
 
   /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
   TCHAR
     include_text[1024], /* the whole include and #define text */
     define_text[80]; /* a single #define line */
+  int gosub_limit; /* the number of GOSUBs that may be active */
 
   /* build up includes and defines */
   strcpy (include_text, GENERATOR_INCLUDE_STDIO);
   strcat (include_text, GENERATOR_INCLUDE_STDLIB);
   snprintf (define_text, 80, GENERATOR_DEFINE_ERROR, E_RETURN_WITHOUT_GOSUB);
   strcat (include_text, define_text);
+  snprintf (define_text, 80, GENERATOR_DEFINE_GOSUBS, E_TOO_MANY_GOSUBS);
+  strcat (include_text, define_text);
+  gosub_limit = data->options->get_gosub_limit (data->options);
+  snprintf (define_text, 80, GENERATOR_DEFINE_LIMIT,
+    gosub_limit < 0 ? 0 : gosub_limit);
+  strcat (include_text, define_text);
+  snprintf (define_text, 80, GENERATOR_DEFINE_DIVIDE, E_DIVIDE_BY_ZERO);
+  strcat (include_text, define_text);
+  snprintf (define_text, 80, GENERATOR_DEFINE_OVERFLOW, E_OVERFLOW);
+  strcat (include_text, define_text);
+  if (data->computed_used) {
+    snprintf (define_text, 80, GENERATOR_DEFINE_LINE, E_INVALID_LINE_NUMBER);
+    strcat (include_text, define_text);
+  }
+
+  /* define the integer type and its range */
+  switch (data->options->get_integer_width (data->options)) {
+    case 16:
+      strcat (include_text, _T("typedef short int bas_int;\n"));
+      strcat (include_text, _T("#define BAS_MIN (-32767-1)\n"));
+      strcat (include_text, _T("#define BAS_MAX 32767\n"));
+      break;
+    case 32:
+      strcat (include_text, _T("typedef int bas_int;\n"));
+      strcat (include_text, _T("#define BAS_MIN (-2147483647-1)\n"));
+      strcat (include_text, _T("#define BAS_MAX 2147483647\n"));
+      break;
+    default:
+      strcat (include_text, _T("typedef long long bas_int;\n"));
+      strcat (include_text, _T("#define BAS_MIN (-9223372036854775807LL-1)\n"));
+      strcat (include_text, _T("#define BAS_MAX 9223372036854775807LL\n"));
+  }
 
   /* add the #includes and #defines to the output */
-  this->c_output = this->c_output == NULL ? NULL
-      :(_realloc(this->c_output, strlen(this->c_output)
-    + strlen (include_text) + 1));
-  if(this->c_output!=NULL)
-      strcat (this->c_output, include_text);
+  string_buffer_append (&data->output, include_text);
 }
 
 /*
  * Generate the variable declarations
+ * params:
+ *   CProgram*   c_program   the C program
  * changes:
  *   Private*   data   appends declaration to the output
  */
-static void generate_variables (void) {
+static void generate_variables (CProgram *c_program) {
 
   /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
   int vcount; /* variable counter */
   TCHAR
     var_text [12], /* individual variable text */
@@ -692,7 +838,7 @@ static void generate_variables (void) {
       if (*declaration)
         snprintf (var_text, 12,_T(",%c"), _T('a') + vcount);
       else
-        snprintf (var_text, 12,_T("short int %c"), _T('a') + vcount);
+        snprintf (var_text, 12,_T("bas_int %c"), _T('a') + vcount);
       strcat (declaration, var_text);
     }
   }
@@ -700,106 +846,279 @@ static void generate_variables (void) {
   /* if there are any variables, add the declaration to the output */
   if (*declaration) {
     strcat (declaration, _T(";\n"));
-    this->c_output = this->c_output==NULL?NULL:(_realloc(this->c_output, strlen (this->c_output)
-      + strlen (declaration) + 1));
-    strcat (this->c_output, declaration);
+    string_buffer_append (&data->output, declaration);
+  }
+}
+
+/*
+ * Generate the routines for the arithmetic operations that are used, which
+ * wrap their results to the integer width, or with USE_LIMIT_RESULT stop
+ * the program with the overflow error's code as the interpreter would
+ * params:
+ *   CProgram*   c_program   the C program
+ * changes:
+ *   Private*   data   appends the routines to the output
+ */
+static void generate_arithmetic (CProgram *c_program) {
+
+  /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
+  StringBuffer *output = &data->output; /* where the routines go */
+
+  /* addition */
+  if (data->add_used) {
+    string_buffer_append (output,
+      _T("static bas_int bas_add (bas_int a, bas_int b) {\n"));
+#ifdef USE_LIMIT_RESULT
+    string_buffer_append (output, _T("#ifdef __GNUC__\n"));
+    string_buffer_append (output, _T("bas_int r;\n"));
+    string_buffer_append (output,
+      _T("if (__builtin_add_overflow (a, b, &r)) exit(E_OVERFLOW);\n"));
+    string_buffer_append (output, _T("return r;\n"));
+    string_buffer_append (output, _T("#else\n"));
+    string_buffer_append (output,
+      _T("if (b > 0 ? a > BAS_MAX - b : a < BAS_MIN - b) exit(E_OVERFLOW);\n"));
+    string_buffer_append (output, _T("return a + b;\n"));
+    string_buffer_append (output, _T("#endif\n"));
+#else
+    string_buffer_append (output, _T("return (bas_int) ")
+      _T("((unsigned long long) a + (unsigned long long) b);\n"));
+#endif
+    string_buffer_append (output, _T("}\n"));
+  }
+
+  /* subtraction */
+  if (data->subtract_used) {
+    string_buffer_append (output,
+      _T("static bas_int bas_sub (bas_int a, bas_int b) {\n"));
+#ifdef USE_LIMIT_RESULT
+    string_buffer_append (output, _T("#ifdef __GNUC__\n"));
+    string_buffer_append (output, _T("bas_int r;\n"));
+    string_buffer_append (output,
+      _T("if (__builtin_sub_overflow (a, b, &r)) exit(E_OVERFLOW);\n"));
+    string_buffer_append (output, _T("return r;\n"));
+    string_buffer_append (output, _T("#else\n"));
+    string_buffer_append (output,
+      _T("if (b < 0 ? a > BAS_MAX + b : a < BAS_MIN + b) exit(E_OVERFLOW);\n"));
+    string_buffer_append (output, _T("return a - b;\n"));
+    string_buffer_append (output, _T("#endif\n"));
+#else
+    string_buffer_append (output, _T("return (bas_int) ")
+      _T("((unsigned long long) a - (unsigned long long) b);\n"));
+#endif
+    string_buffer_append (output, _T("}\n"));
+  }
+
+  /* multiplication */
+  if (data->multiply_used) {
+    string_buffer_append (output,
+      _T("static bas_int bas_mul (bas_int a, bas_int b) {\n"));
+#ifdef USE_LIMIT_RESULT
+    string_buffer_append (output, _T("#ifdef __GNUC__\n"));
+    string_buffer_append (output, _T("bas_int r;\n"));
+    string_buffer_append (output,
+      _T("if (__builtin_mul_overflow (a, b, &r)) exit(E_OVERFLOW);\n"));
+    string_buffer_append (output, _T("return r;\n"));
+    string_buffer_append (output, _T("#else\n"));
+    string_buffer_append (output, _T("if (a && b && (a > 0\n"));
+    string_buffer_append (output,
+      _T("? (b > 0 ? a > BAS_MAX / b : b < BAS_MIN / a)\n"));
+    string_buffer_append (output,
+      _T(": (b > 0 ? a < BAS_MIN / b : a < BAS_MAX / b))) exit(E_OVERFLOW);\n"));
+    string_buffer_append (output, _T("return a * b;\n"));
+    string_buffer_append (output, _T("#endif\n"));
+#else
+    string_buffer_append (output, _T("return (bas_int) ")
+      _T("((unsigned long long) a * (unsigned long long) b);\n"));
+#endif
+    string_buffer_append (output, _T("}\n"));
+  }
+
+  /* division, where dividing by -1 is a negation that may overflow */
+  if (data->divide_used) {
+    string_buffer_append (output,
+      _T("static bas_int bas_div (bas_int a, bas_int b) {\n"));
+    string_buffer_append (output, _T("if (!b) exit(E_DIVIDE_BY_ZERO);\n"));
+#ifdef USE_LIMIT_RESULT
+    string_buffer_append (output,
+      _T("if (b == -1 && a == BAS_MIN) exit(E_OVERFLOW);\n"));
+#else
+    string_buffer_append (output,
+      _T("if (b == -1) return (bas_int) (0 - (unsigned long long) a);\n"));
+#endif
+    string_buffer_append (output, _T("return a / b;\n"));
+    string_buffer_append (output, _T("}\n"));
+  }
+
+  /* negation */
+  if (data->negate_used) {
+    string_buffer_append (output,
+      _T("static bas_int bas_neg (bas_int a) {\n"));
+#ifdef USE_LIMIT_RESULT
+    string_buffer_append (output, _T("if (a == BAS_MIN) exit(E_OVERFLOW);\n"));
+    string_buffer_append (output, _T("return -a;\n"));
+#else
+    string_buffer_append (output,
+      _T("return (bas_int) (0 - (unsigned long long) a);\n"));
+#endif
+    string_buffer_append (output, _T("}\n"));
   }
 }
 
 /*
  * Generate the bas_input function
+ * params:
+ *   CProgram*   c_program   the C program
  * changes:
  *   Private*   data   appends declaration to the output
  */
-static void generate_bas_input (void) {
+static void generate_bas_input (CProgram *c_program) {
 
   /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
   TCHAR function_text[1024]; /* the entire function */
 
   /* construct the function text */
-  strcpy (function_text, _T("short int bas_input (void) {\n"));
-  strcat (function_text, _T("short int ch, sign, value;\n"));
+  strcpy (function_text, _T("bas_int bas_input (void) {\n"));
+  strcat (function_text, _T("int ch = 0, sign;\n"));
+  strcat (function_text, _T("unsigned long long value;\n"));
   strcat (function_text, _T("do {\n"));
   strcat (function_text, _T("if (ch == '-') sign = -1; else sign = 1;\n"));
   strcat (function_text, _T("ch = getchar ();\n"));
+  strcat (function_text, _T("if (ch == EOF) return 0;\n"));
   strcat (function_text, _T("} while (ch < '0' || ch > '9');\n"));
   strcat (function_text, _T("value = 0;\n"));
   strcat (function_text, _T("do {\n"));
   strcat (function_text, _T("value = 10 * value + (ch - '0');\n"));
+#ifdef USE_LIMIT_RESULT
+  strcat (function_text, _T("if (value > (unsigned long long) BAS_MAX + (sign < 0))")
+    _T(" exit(E_OVERFLOW);\n"));
+#endif
   strcat (function_text, _T("ch = getchar ();\n"));
   strcat (function_text, _T("} while (ch >= '0' && ch <= '9');\n"));
-  strcat (function_text, _T("return sign * value;\n"));
+  strcat (function_text, _T("return (bas_int) (sign < 0 ? 0 - value : value);\n"));
   strcat (function_text, _T("}\n"));
 
   /* add the function text to the output */
-  this->c_output = this->c_output==NULL?NULL:(_realloc(this->c_output, strlen (this->c_output)
-    + strlen (function_text) + 1));
-  if(this->c_output!=NULL)
-      strcat (this->c_output, function_text);
+  string_buffer_append (&data->output, function_text);
+}
+
+/*
+ * Generate the goto block's search for a label, as a tree of comparisons
+ * that halves the labels left at each level
+ * params:
+ *   CProgram*     c_program   the C program
+ *   int           low         index of the lowest label left
+ *   int           high        index of the highest label left
+ *   const TCHAR*  op          comparison operator to use for the labels
+ * changes:
+ *   Private*   data   appends the search to the output
+ */
+static void generate_label_search (CProgram *c_program, int low, int high,
+  const TCHAR *op) {
+
+  /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
+  TCHAR goto_line[80]; /* a line in the goto block */
+  int
+    label, /* index of a label tested in turn */
+    middle; /* index of the label that splits the search */
+
+  /* test the last few labels in ascending order */
+  if (high - low < GENERATOR_LABEL_RUN) {
+    for (label = low; label <= high; ++label) {
+      snprintf (goto_line, 80, _T("if (label%s%d) goto lbl_%d;\n"),
+        op, data->labels[label], data->labels[label]);
+      string_buffer_append (&data->output, goto_line);
+    }
+    return;
+  }
+
+  /* otherwise search whichever half the label falls into */
+  middle = (low + high) / 2;
+  snprintf (goto_line, 80, _T("if (label<=%d) {\n"), data->labels[middle]);
+  string_buffer_append (&data->output, goto_line);
+  generate_label_search (c_program, low, middle, op);
+  string_buffer_append (&data->output, _T("}\n"));
+  generate_label_search (c_program, middle + 1, high, op);
 }
 
 /*
  * Generate the bas_exec function
+ * params:
+ *   CProgram*   c_program   the C program
  * changes:
  *   Private*   data   appends declaration to the output
  */
-static void generate_bas_exec (void) {
+static void generate_bas_exec (CProgram *c_program) {
 
   /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
   TCHAR
     *op, /* comparison operator to use for line numbers */
-    goto_line[80], /* a line in the goto block */
-    *goto_block, /* the goto block */
-    *function_text; /* the complete function text */
-  CLabel *label; /* label pointer for construction goto block */
+    goto_line[80]; /* a line of the return block */
+  int gosub; /* index of a GOSUB's return point */
 
   /* decide which operator to use for comparison */
-  op = (options->get_line_numbers (options) == LINE_NUMBERS_OPTIONAL)
+  op = (data->options->get_line_numbers (data->options) == LINE_NUMBERS_OPTIONAL)
     ? _T("==")
     : _T("<=");
 
-  /* create the goto block */
-  goto_block = _malloc (128);
-  strcpy (goto_block, _T("goto_block:\n"));
-  strcat (goto_block, _T("if (!label) goto lbl_start;\n"));
-  label = data->first_label;
-  while (label) {
-    snprintf (goto_line, 80,_T("if (label%s%d) goto lbl_%d;\n"),
-      op, label->number, label->number);
-    goto_block = goto_block==NULL?NULL:(_realloc (goto_block,
-      strlen (goto_block) + strlen (goto_line) + 1));
-    strcat (goto_block, goto_line);
-    label = label->next;
-  }
-  goto_block = goto_block==NULL?NULL:(_realloc (goto_block, strlen (goto_block) + 12));
-  if(goto_block!=NULL)
-      strcat (goto_block, _T("lbl_start:\n"));
-
-  /* put the function together */
-  function_text = _malloc (28 + goto_block==NULL?0:strlen (goto_block) + strlen (data->code) + 3);
-  if (function_text != NULL) {
-      strcpy(function_text, _T("void bas_exec (int label) {\n"));
-      strcat(function_text, goto_block);
-      strcat(function_text, data->code);
-      strcat(function_text, _T("}\n"));
+  /* declare the stack of return points for GOSUB */
+  string_buffer_append (&data->output, _T("void bas_exec (bas_int label) {\n"));
+  if (data->gosub_count) {
+    string_buffer_append (&data->output,
+      _T("static int bas_stack[GOSUB_LIMIT + 1];\n"));
+    string_buffer_append (&data->output, _T("int bas_top = 0;\n"));
   }
-  /* add the function text to the output */
-  this->c_output = this->c_output==NULL?NULL:(_realloc(this->c_output, this->c_output==NULL?0:strlen (this->c_output)
-    + strlen (function_text) + 1));
-  if(this->c_output!=NULL && function_text!=NULL)
-      strcat (this->c_output, function_text);
-  free (goto_block);
-  free (function_text);
+
+  /* create the goto block, a binary search of the labels in order, if any
+     jump has a computed label; a label it cannot find is an error */
+  if (data->computed_used) {
+    string_buffer_append (&data->output, _T("goto_block:\n"));
+    string_buffer_append (&data->output, _T("if (!label) goto lbl_start;\n"));
+    if (data->label_count) {
+      qsort (data->labels, data->label_count, sizeof (int), compare_labels);
+      generate_label_search (c_program, 0, data->label_count - 1, op);
+    }
+    string_buffer_append (&data->output,
+      _T("exit(E_INVALID_LINE_NUMBER);\n"));
+    string_buffer_append (&data->output, _T("lbl_start:\n"));
+  }
+
+  /* put the function together; running off the end stops the program, as
+     it does in the interpreter even inside a subroutine */
+  string_buffer_append (&data->output, data->code.text);
+  string_buffer_append (&data->output, _T("exit(0);\n"));
+
+  /* RETURN goes back to the latest GOSUB; without a RETURN the dispatch is
+     never reached, but still refers to each GOSUB's return label */
+  if (data->return_used)
+    string_buffer_append (&data->output, _T("bas_return:\n"));
+  if (data->gosub_count) {
+    string_buffer_append (&data->output,
+      _T("if (bas_top) switch (bas_stack[--bas_top]) {\n"));
+    for (gosub = 0; gosub < data->gosub_count; ++gosub) {
+      snprintf (goto_line, 80, _T("case %d: goto ret_%d;\n"), gosub, gosub);
+      string_buffer_append (&data->output, goto_line);
+    }
+    string_buffer_append (&data->output, _T("}\n"));
+  }
+  string_buffer_append (&data->output, _T("exit(E_RETURN_WITHOUT_GOSUB);\n"));
+  string_buffer_append (&data->output, _T("}\n"));
 }
 
 /*
  * Generate the main function
+ * params:
+ *   CProgram*   c_program   the C program
  * changes:
  *   Private*   data   appends declaration to the output
  */
-void generate_main (void) {
+void generate_main (CProgram *c_program) {
 
   /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
   TCHAR function_text[1024]; /* the entire function */
 
   /* construct the function text */
@@ -809,10 +1128,7 @@ void generate_main (void) {
   strcat (function_text, _T("}\n"));
 
   /* add the function text to the output */
-  this->c_output = this->c_output==NULL?NULL:(_realloc(this->c_output, strlen (this->c_output)
-    + strlen (function_text) + 1));
-  if(this->c_output!=NULL)
-      strcat (this->c_output, function_text);
+  string_buffer_append (&data->output, function_text);
 }
 
 
@@ -831,26 +1147,40 @@ void generate_main (void) {
 static void generate (CProgram *c_program, ProgramNode *program) {
 
   /* local variables */
+  FileTokenizerPrivateData *data = c_program->private_data; /* private data */
   ProgramLineNode *program_line; /* line to process */
-
-  /* initialise this object */
-  this = c_program;
-  data = (FileTokenizerPrivateData *) c_program->private_data;
-
-  /* generate the code for the lines */
-  program_line = program->first;
-  while (program_line) {
-    generate_line (program_line);
-    program_line = program_line->next;
+  Cfg *cfg; /* the program's control flow graph */
+  CfgBlock *block; /* a block of the program */
+  int line; /* count of lines generated in the block */
+
+  /* find which lines can be jumped to */
+  if (! (cfg = cfg_build (program))) {
+    data->errors->set_code (data->errors, E_MEMORY, 0, 0, 0);
+    return;
   }
 
+  /* generate the code for the lines, labelling only the jump targets */
+  for (block = cfg->blocks; block < cfg->blocks + cfg->block_count; ++block)
+    for (line = 0, program_line = block->first; line < block->line_count;
+      ++line, program_line = program_line->next)
+      generate_line (c_program, program_line, line ? 0 : block->entries);
+  data->computed_used = cfg->computed;
+  cfg_destroy (cfg);
+
   /* put the code together */
-  generate_includes ();
-  generate_variables ();
+  generate_includes (c_program);
+  generate_variables (c_program);
+  generate_arithmetic (c_program);
   if (data->input_used)
-    generate_bas_input ();
-  generate_bas_exec ();
-  generate_main ();
+    generate_bas_input (c_program);
+  generate_bas_exec (c_program);
+  generate_main (c_program);
+
+  /* hand over the output, unless memory ran out while building it */
+  free (c_program->c_output);
+  if (! (c_program->c_output = string_buffer_release (&data->output))
+    || ! data->code.text)
+    data->errors->set_code (data->errors, E_MEMORY, 0, 0, 0);
 }
 
 /*
@@ -861,28 +1191,20 @@ static void generate (CProgram *c_program, ProgramNode *program) {
 static void destroy (CProgram *c_program) {
 
   /* local variables */
-  CLabel
-    *current_label, /* pointer to label to destroy */
-    *next_label; /* pointer to next label to destroy */
+  FileTokenizerPrivateData *data; /* the private data */
 
   /* destroy the private data */
-  this = c_program;
-  if (this->private_data) {
+  if (c_program->private_data) {
     data = (FileTokenizerPrivateData *) c_program->private_data;
-    next_label = data->first_label;
-    while (next_label) {
-      current_label = next_label;
-      next_label = current_label->next;
-      free (current_label);
-    }
-    if (data->code)
-      free (data->code);
+    free (data->labels);
+    free (string_buffer_release (&data->code));
+    free (string_buffer_release (&data->output));
     free (data);
   }
 
   /* destroy the generated output */
-  if (this->c_output)
-    free (this->c_output);
+  if (c_program->c_output)
+    free (c_program->c_output);
 
   /* destroy the containing structure */
   free (c_program);
@@ -892,40 +1214,49 @@ static void destroy (CProgram *c_program) {
  * Constructor
  * params:
  *   ErrorHandler*   compiler_errors   the error handler
- * changes:
- *   CProgram*       this              the object being created
- *   Private*        data              the object's private data
  * returns:
  *   CProgram*                         the created object
  */
 CProgram *new_CProgram (ErrorHandler *compiler_errors,
   LanguageOptions *compiler_options) {
 
+  /* local variables */
+  CProgram *c_program; /* the object being created */
+  FileTokenizerPrivateData *data; /* the object's private data */
+
   /* allocate space */
-  this = malloc (sizeof (CProgram));
-  if (this == NULL) return NULL;
-  this->private_data = data = malloc (sizeof (FileTokenizerPrivateData));
+  c_program = malloc (sizeof (CProgram));
+  if (c_program == NULL) return NULL;
+  c_program->private_data = data = malloc (sizeof (FileTokenizerPrivateData));
   if (data == NULL) {
-      free(this);
+      free(c_program);
       return NULL;
   }
   /* initialise methods */
-  this->generate = generate;
-  this->destroy = destroy;
+  c_program->generate = generate;
+  c_program->destroy = destroy;
 
   /* initialise properties */
-  errors = data->errors = compiler_errors;
-  options = data->options = compiler_options;
+  data->errors = compiler_errors;
+  data->options = compiler_options;
   data->input_used = 0;
+  data->return_used = 0;
+  data->computed_used = 0;
+  data->add_used = 0;
+  data->subtract_used = 0;
+  data->multiply_used = 0;
+  data->divide_used = 0;
+  data->negate_used = 0;
   data->vars_used = 0;
-  data->first_label = NULL;
-  data->code = _malloc (1);
-  if(data->code!=NULL)
-      *data->code = '\0';
-  this->c_output = _malloc (1);
-  if(this->c_output!=NULL)
-      *this->c_output = '\0';
+  data->labels = NULL;
+  data->label_count = data->label_size = 0;
+  data->gosub_count = 0;
+  string_buffer_init (&data->code);
+  string_buffer_init (&data->output);
+  c_program->c_output = _malloc (1);
+  if(c_program->c_output!=NULL)
+      *c_program->c_output = '\0';
 
   /* return the created structure */
-  return this;
+  return c_program;
 }
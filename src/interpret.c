@@ -11,90 +11,225 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <setjmp.h>
 #include "interpret.h"
 #include "errors.h"
 #include "options.h"
 #include "statement.h"
+#include "bytecode.h"
+#include "labelindex.h"
+#include "profile.h"
 
 
 /* forward declarations */
-static intptr_t interpret_expression(ExpressionNode* expression);
-static void interpret_statement(StatementNode* statement);
+static intptr_t interpret_expression(Interpreter* interpreter, ExpressionNode* expression);
+static void interpret_statement(Interpreter* interpreter, StatementNode* statement);
+
+/* a result wrapped to the integer width, whose bits above it number shift */
+#define WRAP(value, shift) ((intptr_t)((uintptr_t)(value) << (shift)) >> (shift))
+
+/* overflow checks at the width of an intptr_t, and at the integer width */
+#ifdef USE_LIMIT_RESULT
+#ifdef __GNUC__
+#define ADD_OVERFLOWS(left, right, result) __builtin_add_overflow(left, right, result)
+#define SUBTRACT_OVERFLOWS(left, right, result) __builtin_sub_overflow(left, right, result)
+#define MULTIPLY_OVERFLOWS(left, right, result) __builtin_mul_overflow(left, right, result)
+#else
+#define ADD_OVERFLOWS(left, right, result) add_overflows(left, right, result)
+#define SUBTRACT_OVERFLOWS(left, right, result) subtract_overflows(left, right, result)
+#define MULTIPLY_OVERFLOWS(left, right, result) multiply_overflows(left, right, result)
+#endif
+#define OUT_OF_RANGE(value, shift) (WRAP(value, shift) != (value))
+#endif
 
 
 /*
  * Data Definitions
  */
 
- /* The GOSUB Stack */
-typedef struct gosub_stack_node GosubStackNode;
-typedef struct gosub_stack_node {
+ /* An entry on the GOSUB stack */
+typedef union {
 	ProgramLineNode* program_line; /* the line following the GOSUB */
-	GosubStackNode* next; /* stack node for the previous GOSUB */
-} GosubStackNode;
+	int address; /* the code address following the GOSUB */
+} GosubReturn;
 
 /* private data */
 typedef struct interpreter_data {
 	ProgramNode* program; /* the program to interpret */
 	ProgramLineNode* line; /* current line we're executing */
-	GosubStackNode* gosub_stack; /* the top of the GOSUB stack */
-	intptr_t gosub_stack_size; /* number of entries on the GOSUB stack */
+	ProgramLineNode** lines; /* the program lines, in program order */
+	LabelIndex* label_index; /* finds the lines by their labels */
+	GosubReturn* gosub_stack; /* the GOSUB stack, sized to the limit */
+	int gosub_stack_size; /* number of entries on the GOSUB stack */
+	int gosub_limit; /* number of entries the GOSUB stack can hold */
+	int gosub_high_water; /* the most entries the GOSUB stack has held */
 	intptr_t variables[26]; /* the numeric variables */
 	intptr_t stopped; /* set to 1 when an END is encountered */
+	int line_open; /* set when a PRINT has left a line unfinished */
+	int shift; /* bits of an intptr_t above the integer width */
+	jmp_buf fault; /* where a runtime error abandons the program */
+	FILE* input; /* where INPUT reads from, or NULL for no input */
+	FILE* output; /* where PRINT writes to */
+	Profile* profile; /* measures each line as it runs, or NULL */
 	ErrorHandler* errors; /* the error handler */
 	LanguageOptions* options; /* the language options */
 } InterpreterData;
 
-/* convenience variables */
-static Interpreter* this; /* the object we are working with */
-
 
 /*
  * Private Methods
  */
 
 
+/*
+ * Raise a runtime error against the current line and abandon the program
+ * params:
+ *   Interpreter*   interpreter   the interpreter
+ *   ErrorCode   code   the error to raise
+ */
+static void raise_error(Interpreter* interpreter, ErrorCode code) {
+	interpreter->priv->errors->set_code
+	(interpreter->priv->errors, code, 0, 0, interpreter->priv->line->label);
+	longjmp(interpreter->priv->fault, 1);
+}
+
+#if defined(USE_LIMIT_RESULT) && !defined(__GNUC__)
+/*
+ * Add two values, noting whether the sum overflows an intptr_t
+ * params:
+ *   intptr_t    left     the left operand
+ *   intptr_t    right    the right operand
+ *   intptr_t*   result   receives the sum, wrapped if it overflows
+ * returns:
+ *   int                  !0 if the sum overflows
+ */
+static int add_overflows(intptr_t left, intptr_t right, intptr_t* result) {
+	*result = (intptr_t)((uintptr_t)left + (uintptr_t)right);
+	return ((left ^ *result) & (right ^ *result)) < 0;
+}
+
+/*
+ * Subtract one value from another, noting whether the difference overflows
+ * params:
+ *   intptr_t    left     the left operand
+ *   intptr_t    right    the right operand
+ *   intptr_t*   result   receives the difference, wrapped if it overflows
+ * returns:
+ *   int                  !0 if the difference overflows
+ */
+static int subtract_overflows(intptr_t left, intptr_t right, intptr_t* result) {
+	*result = (intptr_t)((uintptr_t)left - (uintptr_t)right);
+	return ((left ^ right) & (left ^ *result)) < 0;
+}
+
+/*
+ * Multiply two values, noting whether the product overflows an intptr_t
+ * params:
+ *   intptr_t    left     the left operand
+ *   intptr_t    right    the right operand
+ *   intptr_t*   result   receives the product, wrapped if it overflows
+ * returns:
+ *   int                  !0 if the product overflows
+ */
+static int multiply_overflows(intptr_t left, intptr_t right, intptr_t* result) {
+	*result = (intptr_t)((uintptr_t)left * (uintptr_t)right);
+	return left && (left == -1 ? right == INTPTR_MIN : *result / left != right);
+}
+#endif
+
+/*
+ * Carry out an operation at the integer width, which wraps the result
+ * unless USE_LIMIT_RESULT is defined to check it instead
+ * params:
+ *   intptr_t*   left    the left operand, which receives the result
+ *   int         op      '+', '-', '*' or '/'
+ *   intptr_t    right   the right operand, not 0 for a division
+ *   int         shift   bits of an intptr_t above the integer width
+ * returns:
+ *   int                 !0 if the result is out of range
+ */
+static int arithmetic(intptr_t* left, int op, intptr_t right, int shift) {
+
+#ifdef USE_LIMIT_RESULT
+	/* local variables */
+	int overflow; /* set if the result overflows an intptr_t */
+#endif
+
+	/* dividing by -1 is a negation, which is the one that can overflow */
+	if (op == '/' && right == -1) {
+		right = *left;
+		*left = 0;
+		op = '-';
+	}
+
+#ifdef USE_LIMIT_RESULT
+	/* check the result at both widths */
+	switch (op) {
+	case '+': overflow = ADD_OVERFLOWS(*left, right, left); break;
+	case '-': overflow = SUBTRACT_OVERFLOWS(*left, right, left); break;
+	case '*': overflow = MULTIPLY_OVERFLOWS(*left, right, left); break;
+	default: overflow = 0; *left /= right;
+	}
+	return overflow || OUT_OF_RANGE(*left, shift);
+#else
+	/* wrap the result */
+	switch (op) {
+	case '+': *left = WRAP((uintptr_t)*left + (uintptr_t)right, shift); break;
+	case '-': *left = WRAP((uintptr_t)*left - (uintptr_t)right, shift); break;
+	case '*': *left = WRAP((uintptr_t)*left * (uintptr_t)right, shift); break;
+	default: *left /= right;
+	}
+	return 0;
+#endif
+}
+
+
  /*
   * Evaluate a factor for the interpreter
   * params:
+  *   Interpreter*   interpreter   the interpreter
   *   FactorNode*   factor   the factor to evaluate
   */
-static intptr_t interpret_factor(FactorNode* factor) {
+static intptr_t interpret_factor(Interpreter* interpreter, FactorNode* factor) {
 
 	/* local variables */
-	intptr_t result_store = 0; /* result of factor evaluation */
+	intptr_t
+		value = 0, /* the value of the factor before its sign */
+		result_store = 0; /* result of factor evaluation */
 
 	/* check factor class */
 	switch (factor->class) {
 
 		/* a regular variable */
 	case FACTOR_VARIABLE:
-		result_store = this->priv->variables[factor->data.variable - 1]
-			* (factor->sign == SIGN_POSITIVE ? 1 : -1);
+		value = interpreter->priv->variables[factor->data.variable - 1];
 		break;
 
 		/* an integer constant */
 	case FACTOR_VALUE:
-		result_store = factor->data.value
-			* (factor->sign == SIGN_POSITIVE ? 1 : -1);
+		value = factor->data.value;
 		break;
 
 		/* an expression */
 	case FACTOR_EXPRESSION:
-		result_store = interpret_expression(factor->data.expression)
-			* (factor->sign == SIGN_POSITIVE ? 1 : -1);
+		value = interpret_expression(interpreter, factor->data.expression);
 		break;
 
 		/* this only happens if the parser has failed in its duty */
 	default:
-		this->priv->errors->set_code
-		(this->priv->errors, E_INVALID_EXPRESSION, 0, 0, this->priv->line->label);
+		raise_error(interpreter, E_INVALID_EXPRESSION);
 	}
+
+	/* apply the sign */
+	if (factor->sign == SIGN_POSITIVE)
+		result_store = value;
+	else if (arithmetic(&result_store, '-', value, interpreter->priv->shift))
+		raise_error(interpreter, E_OVERFLOW);
 #ifdef USE_LIMIT_RESULT
 	/* check the result and return it*/
-	if (result_store < -32768 || result_store > 32767)
-		this->priv->errors->set_code
-		(this->priv->errors, E_OVERFLOW, 0, 0, this->priv->line->label);
+	if (OUT_OF_RANGE(result_store, interpreter->priv->shift))
+		raise_error(interpreter, E_OVERFLOW);
 #endif
 	return result_store;
 }
@@ -102,9 +237,10 @@ static intptr_t interpret_factor(FactorNode* factor) {
 /*
  * Evaluate a term for the interpreter
  * params:
+ *   Interpreter*   interpreter   the interpreter
  *   TermNode*   term   the term to evaluate
  */
-static intptr_t interpret_term(TermNode* term) {
+static intptr_t interpret_term(Interpreter* interpreter, TermNode* term) {
 
 	/* local variables */
 	intptr_t result_store; /* the partial evaluation */
@@ -112,26 +248,23 @@ static intptr_t interpret_term(TermNode* term) {
 	intptr_t divisor; /* used to check for division by 0 before attempting */
 
 	/* calculate the first factor result */
-	result_store = interpret_factor(term->factor);
+	result_store = interpret_factor(interpreter, term->factor);
 	rhfactor = term->next;
 
 	/* adjust store according to successive rh factors */
-	while (rhfactor && !this->priv->errors->get_code(this->priv->errors)) {
+	while (rhfactor) {
 		switch (rhfactor->op) {
 		case TERM_OPERATOR_MULTIPLY:
-			result_store *= interpret_factor(rhfactor->factor);
-#ifdef USE_LIMIT_RESULT
-			if (result_store < -32768 || result_store > 32767)
-				this->priv->errors->set_code
-				(this->priv->errors, E_OVERFLOW, 0, 0, this->priv->line->label);
-#endif
+			if (arithmetic(&result_store, '*',
+				interpret_factor(interpreter, rhfactor->factor),
+				interpreter->priv->shift))
+				raise_error(interpreter, E_OVERFLOW);
 			break;
 		case TERM_OPERATOR_DIVIDE:
-			if ((divisor = interpret_factor(rhfactor->factor)))
-				result_store /= divisor;
-			else
-				this->priv->errors->set_code
-				(this->priv->errors, E_DIVIDE_BY_ZERO, 0, 0, this->priv->line->label);
+			if (!(divisor = interpret_factor(interpreter, rhfactor->factor)))
+				raise_error(interpreter, E_DIVIDE_BY_ZERO);
+			if (arithmetic(&result_store, '/', divisor, interpreter->priv->shift))
+				raise_error(interpreter, E_OVERFLOW);
 			break;
 		default:
 			break;
@@ -146,36 +279,33 @@ static intptr_t interpret_term(TermNode* term) {
 /*
  * Evaluate an expression for the interpreter
  * params:
+ *   Interpreter*      interpreter   the interpreter
  *   ExpressionNode*   expression   the expression to evaluate
  */
-static intptr_t interpret_expression(ExpressionNode* expression) {
+static intptr_t interpret_expression(Interpreter* interpreter, ExpressionNode* expression) {
 
 	/* local variables */
 	intptr_t result_store; /* the partial evaluation */
 	RightHandTerm* rhterm; /* pointer to successive rh term nodes */
 
 	/* calculate the first term result */
-	result_store = interpret_term(expression->term);
+	result_store = interpret_term(interpreter, expression->term);
 	rhterm = expression->next;
 
 	/* adjust store according to successive rh terms */
-	while (rhterm && !this->priv->errors->get_code(this->priv->errors)) {
+	while (rhterm) {
 		switch (rhterm->op) {
 		case EXPRESSION_OPERATOR_PLUS:
-			result_store += interpret_term(rhterm->term);
-#ifdef USE_LIMIT_RESULT
-			if (result_store < -32768 || result_store > 32767)
-				this->priv->errors->set_code
-				(this->priv->errors, E_OVERFLOW, 0, 0, this->priv->line->label);
-#endif
+			if (arithmetic(&result_store, '+',
+				interpret_term(interpreter, rhterm->term),
+				interpreter->priv->shift))
+				raise_error(interpreter, E_OVERFLOW);
 			break;
 		case EXPRESSION_OPERATOR_MINUS:
-			result_store -= interpret_term(rhterm->term);
-#ifdef USE_LIMIT_RESULT
-			if (result_store < -32768 || result_store > 32767)
-				this->priv->errors->set_code
-				(this->priv->errors, E_OVERFLOW, 0, 0, this->priv->line->label);
-#endif
+			if (arithmetic(&result_store, '-',
+				interpret_term(interpreter, rhterm->term),
+				interpreter->priv->shift))
+				raise_error(interpreter, E_OVERFLOW);
 			break;
 		default:
 			break;
@@ -187,32 +317,103 @@ static intptr_t interpret_expression(ExpressionNode* expression) {
 	return result_store;
 }
 
+/*
+ * Print a numeric value
+ * params:
+ *   FILE*      output   the output stream
+ *   intptr_t   value    the value to print
+ */
+static void output_number(FILE* output, intptr_t value) {
+	if (sizeof(intptr_t) == sizeof(int) << 1)
+		fprintf(output, _T("%lld"), (long long)value);
+	else
+		fprintf(output, _T("%d"), (int)value);
+}
+
+/*
+ * Read a numeric value from the user
+ * params:
+ *   FILE*       input   the input stream, or NULL if there is none
+ *   intptr_t*   ch      character from the input stream, kept between values
+ *   intptr_t*   value   the value input
+ *   int         shift   bits of an intptr_t above the integer width
+ * returns:
+ *   int                 !0 if the value is out of range
+ */
+static int input_value(FILE* input, intptr_t* ch, intptr_t* value, int shift) {
+
+	/* local variables */
+	intptr_t sign = 1; /* the default sign */
+	uintptr_t digits; /* the value of the digits, wrapped if need be */
+	int overflow = 0; /* set if the value goes out of range */
+
+	/* skip to the first digit, noting any minus sign; no input reads as 0 */
+	do {
+		if (*ch == _T('-')) sign = -1; else sign = 1;
+		*ch = input ? fgetc(input) : EOF;
+		if (*ch == EOF) {
+			*value = 0;
+			return 0;
+		}
+	} while (*ch < _T('0') || *ch > _T('9'));
+
+	/* accumulate the digits */
+	digits = 0;
+	do {
+		digits = 10 * digits + (*ch - _T('0'));
+#ifdef USE_LIMIT_RESULT
+		if (digits > ((uintptr_t)INTPTR_MAX >> shift) + (sign < 0))
+			overflow = 1;
+#endif
+		*ch = fgetc(input);
+	} while (*ch >= _T('0') && *ch <= _T('9') && !overflow);
+	*value = WRAP(sign < 0 ? 0 - digits : digits, shift);
+
+	/* return the range check */
+	return overflow;
+}
+
 /*
  * Find a program line given its label
+ * params:
+ *   Interpreter*   interpreter   the interpreter
+ *   intptr_t   jump_label   the label to find
  * returns:
  *   ProgramLineNode*   the program line found
  */
-static ProgramLineNode* find_label(intptr_t jump_label) {
+static ProgramLineNode* find_label(Interpreter* interpreter, intptr_t jump_label) {
 
 	/* local variables */
-	ProgramLineNode
-		* ptr, /* a line we're currently looking at */
-		* found = NULL; /* the line if found */
+	int line; /* position of the line in the program */
 
-	/* do the search */
-	for (ptr = this->priv->program->first; ptr && !found; ptr = ptr->next)
-		if (ptr->label == jump_label)
-			found = ptr;
-		else if (ptr->label >= jump_label
-			&& this->priv->options->get_line_numbers(this->priv->options)
-			!= LINE_NUMBERS_OPTIONAL)
-			found = ptr;
+	/* look up the line, checking for errors */
+	line = label_index_find(interpreter->priv->label_index, jump_label);
+	if (line < 0)
+		raise_error(interpreter, E_INVALID_LINE_NUMBER);
+	return interpreter->priv->lines[line];
+}
 
-	/* check for errors and return what was found */
-	if (!found)
-		this->priv->errors->set_code
-		(this->priv->errors, E_INVALID_LINE_NUMBER, 0, 0, this->priv->line->label);
-	return found;
+/*
+ * Build a label index for the current program
+ * params:
+ *   Interpreter*   interpreter   the interpreter
+ *   int*   labels   the label of each line, in program order
+ *   int    count    the number of lines
+ * returns:
+ *   LabelIndex*     the new index, NULL if memory ran out
+ */
+static LabelIndex* create_label_index(Interpreter* interpreter, int* labels, int count) {
+
+	/* local variables */
+	LabelIndex* index; /* the new index */
+
+	/* build the index with the line number rules in force */
+	index = label_index_create(labels, count,
+		interpreter->priv->options->get_line_numbers(interpreter->priv->options)
+		== LINE_NUMBERS_OPTIONAL);
+	if (index == NULL)
+		interpreter->priv->errors->set_code(interpreter->priv->errors, E_MEMORY, 0, 0, 0);
+	return index;
 }
 
 
@@ -223,61 +424,97 @@ static ProgramLineNode* find_label(intptr_t jump_label) {
 
  /*
   * Initialise the variables
+  * params:
+  *   Interpreter*   interpreter   the interpreter
   */
-static void initialise_variables(void) {
-	int count; /* counter for this->priv->variables */
+static void initialise_variables(Interpreter* interpreter) {
+	int count; /* counter for interpreter->priv->variables */
 	for (count = 0; count < 26; ++count) {
-		this->priv->variables[count] = 0;
+		interpreter->priv->variables[count] = 0;
+	}
+}
+
+/*
+ * Allocate the GOSUB stack to the size allowed by the options
+ * params:
+ *   Interpreter*   interpreter   the interpreter
+ * returns:
+ *   int   !0 if successful, 0 if memory ran out
+ */
+static int reserve_gosub_stack(Interpreter* interpreter) {
+
+	/* local variables */
+	GosubReturn* gosub_stack; /* the reallocated stack */
+	int gosub_limit; /* the number of entries required */
+
+	/* grow the stack if the limit has been raised */
+	gosub_limit = interpreter->priv->options->get_gosub_limit(interpreter->priv->options);
+	if (gosub_limit < 0)
+		gosub_limit = 0;
+	if (!interpreter->priv->gosub_stack || gosub_limit > interpreter->priv->gosub_limit) {
+		gosub_stack = realloc(interpreter->priv->gosub_stack,
+			(gosub_limit + 1) * sizeof(GosubReturn));
+		if (gosub_stack == NULL) {
+			interpreter->priv->errors->set_code(interpreter->priv->errors, E_MEMORY, 0, 0, 0);
+			return 0;
+		}
+		interpreter->priv->gosub_stack = gosub_stack;
 	}
+	interpreter->priv->gosub_limit = gosub_limit;
+	return 1;
 }
 
 /*
  * Interpret a LET statement
  * params:
+ *   Interpreter*        interpreter   the interpreter
  *   LetStatementNode*   letn   the LET statement details
  */
-void interpret_let_statement(LetStatementNode* letn) {
-	this->priv->variables[letn->variable - 1]
-		= interpret_expression(letn->expression);
-	this->priv->line = this->priv->line->next;
+void interpret_let_statement(Interpreter* interpreter, LetStatementNode* letn) {
+	interpreter->priv->variables[letn->variable - 1]
+		= interpret_expression(interpreter, letn->expression);
+	interpreter->priv->line = interpreter->priv->line->next;
 }
 
 /*
  * Interpret a PEEK statement
  * params:
+ *   Interpreter*         interpreter   the interpreter
  *   PeekStatementNode*   peekn   the PEEK statement details
  */
-void interpret_peek_statement(PeekStatementNode* peekn) {
+void interpret_peek_statement(Interpreter* interpreter, PeekStatementNode* peekn) {
 	//get the int value inside the address
-	intptr_t address = interpret_expression(peekn->address);
+	intptr_t address = interpret_expression(interpreter, peekn->address);
 	//save the value to the variable
-	this->priv->variables[peekn->variable - 1]
+	interpreter->priv->variables[peekn->variable - 1]
 		= *((int*)address);
-	this->priv->line = this->priv->line->next;
+	interpreter->priv->line = interpreter->priv->line->next;
 }
 
 /*
  * Interpret a POKE statement
  * params:
+ *   Interpreter*         interpreter   the interpreter
  *   PokeStatementNode*   poken   the POKE statement details
  */
-void interpret_poke_statement(PokeStatementNode* poken) {
+void interpret_poke_statement(Interpreter* interpreter, PokeStatementNode* poken) {
 	//get the int value inside the address
-	intptr_t address = interpret_expression(poken->address);
-	intptr_t value = interpret_expression(poken->value);
+	intptr_t address = interpret_expression(interpreter, poken->address);
+	intptr_t value = interpret_expression(interpreter, poken->value);
 	//save the value to the address
 	*(intptr_t*)address = value;
 
-	this->priv->line = this->priv->line->next;
+	interpreter->priv->line = interpreter->priv->line->next;
 }
 
 
 /*
  * Interpret an IF statement
  * params:
+ *   Interpreter*       interpreter   the interpreter
  *   IfStatementNode*   ifn   the IF statement details
  */
-void interpret_if_statement(IfStatementNode* ifn) {
+void interpret_if_statement(Interpreter* interpreter, IfStatementNode* ifn) {
 
 	/* local variables */
 	intptr_t
@@ -286,8 +523,8 @@ void interpret_if_statement(IfStatementNode* ifn) {
 		comparison; /* result of the comparison between the two */
 
 	/* get the expressions */
-	left = interpret_expression(ifn->left);
-	right = interpret_expression(ifn->right);
+	left = interpret_expression(interpreter, ifn->left);
+	right = interpret_expression(interpreter, ifn->right);
 
 	/* make the comparison */
 	switch (ifn->op) {
@@ -301,176 +538,146 @@ void interpret_if_statement(IfStatementNode* ifn) {
 	}
 
 	/* perform the conditional statement */
-	if (comparison && !this->priv->errors->get_code(this->priv->errors))
-		interpret_statement(ifn->statement);
+	if (comparison)
+		interpret_statement(interpreter, ifn->statement);
 	else
-		this->priv->line = this->priv->line->next;
+		interpreter->priv->line = interpreter->priv->line->next;
 }
 
 /*
  * Interpret a GOTO statement
  * params:
+ *   Interpreter*         interpreter   the interpreter
  *   GotoStatementNode*   goton   the GOTO statement details
  */
-void interpret_goto_statement(GotoStatementNode* goton) {
-	intptr_t label; /* the line label to go to */
-	label = interpret_expression(goton->label);
-	if (!this->priv->errors->get_code(this->priv->errors))
-		this->priv->line = find_label(label);
+void interpret_goto_statement(Interpreter* interpreter, GotoStatementNode* goton) {
+	if (goton->target)
+		interpreter->priv->line = goton->target;
+	else
+		interpreter->priv->line = find_label(interpreter, interpret_expression(interpreter, goton->label));
 }
 
 /*
  * Interpret a GOSUB statement
  * params:
+ *   Interpreter*          interpreter   the interpreter
  *   GosubStatementNode*   gosubn   the GOSUB statement details
  */
-void interpret_gosub_statement(GosubStatementNode* gosubn) {
+void interpret_gosub_statement(Interpreter* interpreter, GosubStatementNode* gosubn) {
 
-	/* local variables */
-	GosubStackNode* gosub_node; /* indicates the program line to return to */
-	intptr_t label; /* the line label to go to */
-
-	/* create the new node on the GOSUB stack */
-	if (this->priv->gosub_stack_size < this->priv->options->get_gosub_limit
-	(this->priv->options)) {
-		gosub_node = malloc(sizeof(GosubStackNode));
-		if (gosub_node != NULL) {
-			gosub_node->program_line = this->priv->line->next;
-			gosub_node->next = this->priv->gosub_stack;
-			++this->priv->gosub_stack_size;
-		}
-		else {
-			//unable to add stack
-		}
-		this->priv->gosub_stack = gosub_node;
-	}
-	else
-		this->priv->errors->set_code(this->priv->errors,
-			E_TOO_MANY_GOSUBS, 0, 0, this->priv->line->label);
+	/* push the line to return to onto the GOSUB stack */
+	if (interpreter->priv->gosub_stack_size == interpreter->priv->gosub_limit)
+		raise_error(interpreter, E_TOO_MANY_GOSUBS);
+	interpreter->priv->gosub_stack[interpreter->priv->gosub_stack_size++].program_line
+		= interpreter->priv->line->next;
+	if (interpreter->priv->gosub_stack_size > interpreter->priv->gosub_high_water)
+		interpreter->priv->gosub_high_water = interpreter->priv->gosub_stack_size;
 
 	/* branch to the subroutine requested */
-	if (!this->priv->errors->get_code(this->priv->errors))
-		label = interpret_expression(gosubn->label);
-	if (!this->priv->errors->get_code(this->priv->errors))
-		this->priv->line = find_label(label);
+	if (gosubn->target)
+		interpreter->priv->line = gosubn->target;
+	else
+		interpreter->priv->line = find_label(interpreter, interpret_expression(interpreter, gosubn->label));
+	if (interpreter->priv->profile)
+		profile_call(interpreter->priv->profile, interpreter->priv->line);
 }
 
 /*
  * Interpret a RETURN statement
+ * params:
+ *   Interpreter*   interpreter   the interpreter
  */
-void interpret_return_statement(void) {
+void interpret_return_statement(Interpreter* interpreter) {
 
-	/* local variables */
-	GosubStackNode* gosub_node; /* node popped off the GOSUB stack */
+	/* no GOSUBs led here, so raise an error */
+	if (!interpreter->priv->gosub_stack_size)
+		raise_error(interpreter, E_RETURN_WITHOUT_GOSUB);
 
 	/* return to the statement following the most recent GOSUB */
-	if (this->priv->gosub_stack) {
-		this->priv->line = this->priv->gosub_stack->program_line;
-		gosub_node = this->priv->gosub_stack;
-		this->priv->gosub_stack = this->priv->gosub_stack->next;
-		free(gosub_node);
-		--this->priv->gosub_stack_size;
-	}
-
-	/* no GOSUBs led here, so raise an error */
-	else
-		this->priv->errors->set_code
-		(this->priv->errors, E_RETURN_WITHOUT_GOSUB, 0, 0, this->priv->line->label);
+	interpreter->priv->line
+		= interpreter->priv->gosub_stack[--interpreter->priv->gosub_stack_size].program_line;
+	if (interpreter->priv->profile)
+		profile_return(interpreter->priv->profile);
 }
 
 /*
  * Interpret a PRINT statement
  * params:
+ *   Interpreter*          interpreter   the interpreter
  *   PrintStatementNode*   printn   the PRINT statement details
  */
-void interpret_print_statement(PrintStatementNode* printn) {
+void interpret_print_statement(Interpreter* interpreter, PrintStatementNode* printn) {
 
 	/* local variables */
 	OutputNode* outn; /* current output node */
-	intptr_t
-		items = 0, /* counter ensures runtime errors appear on a new line */
-		result; /* the result of an expression */
 
-	/* print each of the output items */
+	/* print each of the output items; line_open ensures runtime errors
+	   appear on a new line */
 	outn = printn->first;
 	while (outn) {
 		switch (outn->class) {
 		case OUTPUT_STRING:
-			printf(_T("%s"), outn->output.string);
-			++items;
+			fprintf(interpreter->priv->output, _T("%s"), outn->output.string);
+			interpreter->priv->line_open = 1;
 			break;
 		case OUTPUT_EXPRESSION:
-			result = interpret_expression(outn->output.expression);
-			if (!this->priv->errors->get_code(this->priv->errors)) {
-				if (sizeof(intptr_t) == sizeof(int) << 1)
-					printf(_T("%lld"), result);
-				else
-					printf(_T("%d"), (int)result);
-				++items;
-			}
+			output_number(interpreter->priv->output,
+				interpret_expression(interpreter, outn->output.expression));
+			interpreter->priv->line_open = 1;
 			break;
 		}
 		outn = outn->next;
 	}
 
 	/* print the linefeed */
-	if (items)
-		printf(_T("\n"));
-	this->priv->line = this->priv->line->next;
+	if (interpreter->priv->line_open)
+		fprintf(interpreter->priv->output, _T("\n"));
+	interpreter->priv->line_open = 0;
+	interpreter->priv->line = interpreter->priv->line->next;
 }
 
 /*
  * Interpret an INPUT statement
  * params:
+ *   Interpreter*          interpreter   the interpreter
  *   InputStatementNode*   inputn   the INPUT statement details
  */
-void interpret_input_statement(InputStatementNode* inputn) {
+void interpret_input_statement(Interpreter* interpreter, InputStatementNode* inputn) {
 
 	/* local variables */
 	VariableListNode* variable; /* current variable to input */
 	intptr_t
 		value, /* value input from the user */
-		sign = 1, /* the default sign */
 		ch = 0; /* character from the input stream */
+	int overflow = 0; /* set if any value is out of range */
 
 	/* input each of the variables */
 	variable = inputn->first;
 	while (variable) {
-		do {
-			if (ch == _T('-')) sign = -1; else sign = 1;
-			ch = getchar();
-		} while (ch < _T('0') || ch > _T('9'));
-		value = 0;
-		do {
-			value = 10 * value + (ch - _T('0'));
-#ifdef USE_LIMIT_RESULT
-			if (value * sign < -32768 || value * sign > 32767)
-				this->priv->errors->set_code
-				(this->priv->errors, E_OVERFLOW, 0, 0, this->priv->line->label);
-#endif
-			//NOTICE: use getchar to communicate with console
-			ch = getchar();
-		} while (ch >= _T('0') && ch <= _T('9')
-			&& !this->priv->errors->get_code(this->priv->errors));
-		this->priv->variables[variable->variable - 1] = sign * value;
+		overflow |= input_value(interpreter->priv->input, &ch, &value,
+			interpreter->priv->shift);
+		interpreter->priv->variables[variable->variable - 1] = value;
 		variable = variable->next;
 	}
+	if (overflow)
+		raise_error(interpreter, E_OVERFLOW);
 
 	/* advance to the next statement when done */
-	this->priv->line = this->priv->line->next;
+	interpreter->priv->line = interpreter->priv->line->next;
 }
 
 
 /*
  * Interpret an individual statement
  * params:
+ *   Interpreter*     interpreter   the interpreter
  *   StatementNode*   statement   the statement to interpret
  */
-void interpret_statement(StatementNode* statement) {
+void interpret_statement(Interpreter* interpreter, StatementNode* statement) {
 
 	/* skip comments */
 	if (!statement) {
-		this->priv->line = this->priv->line->next;
+		interpreter->priv->line = interpreter->priv->line->next;
 		return;
 	}
 
@@ -479,51 +686,416 @@ void interpret_statement(StatementNode* statement) {
 	case STATEMENT_NONE:
 		break;
 	case STATEMENT_LET:
-		interpret_let_statement(statement->statement.letn);
+		interpret_let_statement(interpreter, statement->statement.letn);
 		break;
 	case STATEMENT_IF:
-		interpret_if_statement(statement->statement.ifn);
+		interpret_if_statement(interpreter, statement->statement.ifn);
 		break;
 	case STATEMENT_GOTO:
-		interpret_goto_statement(statement->statement.goton);
+		interpret_goto_statement(interpreter, statement->statement.goton);
 		break;
 	case STATEMENT_GOSUB:
-		interpret_gosub_statement(statement->statement.gosubn);
+		interpret_gosub_statement(interpreter, statement->statement.gosubn);
 		break;
 	case STATEMENT_RETURN:
-		interpret_return_statement();
+		interpret_return_statement(interpreter);
 		break;
 	case STATEMENT_END:
-		this->priv->stopped = 1;
+		interpreter->priv->stopped = 1;
 		break;
 	case STATEMENT_PRINT:
-		interpret_print_statement(statement->statement.printn);
+		interpret_print_statement(interpreter, statement->statement.printn);
 		break;
 	case STATEMENT_INPUT:
-		interpret_input_statement(statement->statement.inputn);
+		interpret_input_statement(interpreter, statement->statement.inputn);
 		break;
 	case STATEMENT_POKE:
-		interpret_poke_statement(statement->statement.poken);
+		interpret_poke_statement(interpreter, statement->statement.poken);
 		break;
 	case STATEMENT_PEEK:
-		interpret_peek_statement(statement->statement.peekn);
+		interpret_peek_statement(interpreter, statement->statement.peekn);
 		break;
 	default:
-		printf(INTERPRETER_TYPE_ERROR, statement->class);
+		fprintf(interpreter->priv->output, INTERPRETER_TYPE_ERROR, statement->class);
 	}
 }
 
 /*
  * Interpret program starting from a particular line
  * params:
+ *   Interpreter*       interpreter    the interpreter
  *   ProgramLineNode*   program_line   the starting line
  */
-static void interpret_program_from(ProgramLineNode* program_line) {
-	this->priv->line = program_line;
-	while (this->priv->line
-		&& !this->priv->stopped
-		&& !this->priv->errors->get_code(this->priv->errors))
-		interpret_statement(this->priv->line->statement);
+static void interpret_program_from(Interpreter* interpreter, ProgramLineNode* program_line) {
+
+	/* local variables */
+	unsigned long long
+		start, /* the time a profiled line started */
+		now; /* the time it finished */
+
+	/* runtime errors come back here, finishing any unfinished line */
+	interpreter->priv->line_open = 0;
+	if (setjmp(interpreter->priv->fault)) {
+		if (interpreter->priv->line_open)
+			fprintf(interpreter->priv->output, _T("\n"));
+		return;
+	}
+
+	/* interpret each line in turn, timing each one if profiling */
+	interpreter->priv->line = program_line;
+	if (interpreter->priv->profile) {
+		start = profile_clock();
+		while (interpreter->priv->line && !interpreter->priv->stopped) {
+			program_line = interpreter->priv->line;
+			interpret_statement(interpreter, program_line->statement);
+			now = profile_clock();
+			profile_count(interpreter->priv->profile, program_line, now - start);
+			start = now;
+		}
+	}
+	else
+		while (interpreter->priv->line && !interpreter->priv->stopped)
+			interpret_statement(interpreter, interpreter->priv->line->statement);
+}
+
+
+/*
+ * Run a compiled program
+ * params:
+ *   Interpreter*   interpreter   the interpreter
+ *   Bytecode*     bytecode      the compiled program
+ *   LabelIndex*   label_index   finds the lines by their labels
+ */
+static void interpret_bytecode(Interpreter* interpreter, Bytecode* bytecode, LabelIndex* label_index) {
+
+	/* local variables */
+	int
+		* code = bytecode->code, /* the operations and operands */
+		pc = 0, /* address of the next operation */
+		start = 0, /* address of the current operation */
+		gosub_top = 0, /* number of active GOSUBs */
+		gosub_limit = interpreter->priv->gosub_limit, /* how many may be active */
+		gosub_high_water = 0, /* the most GOSUBs active at once */
+		line_open = 0, /* set when a PRINT has left a line unfinished */
+		shift = interpreter->priv->shift, /* bits above the integer width */
+		count, /* counter for INPUT variables */
+		overflow, /* set if an INPUT value is out of range */
+		line; /* index of a line that is the target of a jump */
+	intptr_t
+		* stack, /* the value stack */
+		* sp, /* the top of the value stack */
+		* variables = interpreter->priv->variables, /* the numeric variables */
+		left, /* left-hand operand of a binary operation */
+		ch = 0; /* character from the input stream */
+	GosubReturn* gosub_stack = interpreter->priv->gosub_stack; /* active GOSUBs */
+	FILE
+		* input = interpreter->priv->input, /* where INPUT reads from */
+		* output = interpreter->priv->output; /* where PRINT writes to */
+	ErrorCode code_raised = E_NONE; /* the error that stopped the program */
+
+	/* allocate the value stack */
+	stack = malloc((bytecode->max_stack + 1) * sizeof(intptr_t));
+	if (stack == NULL) {
+		interpreter->priv->errors->set_code(interpreter->priv->errors, E_MEMORY, 0, 0, 0);
+		return;
+	}
+	sp = stack;
+
+	/* each operation jumps straight to the next, or back to the switch */
+#ifdef USE_COMPUTED_GOTO
+	static void* dispatch[OP_LAST] = {
+		[OP_HALT] = &&L_OP_HALT,
+		[OP_PUSH] = &&L_OP_PUSH,
+		[OP_LOAD] = &&L_OP_LOAD,
+		[OP_STORE] = &&L_OP_STORE,
+		[OP_NEGATE] = &&L_OP_NEGATE,
+		[OP_LIMIT] = &&L_OP_LIMIT,
+		[OP_ADD] = &&L_OP_ADD,
+		[OP_SUBTRACT] = &&L_OP_SUBTRACT,
+		[OP_MULTIPLY] = &&L_OP_MULTIPLY,
+		[OP_DIVIDE] = &&L_OP_DIVIDE,
+		[OP_IF_EQUAL] = &&L_OP_IF_EQUAL,
+		[OP_IF_UNEQUAL] = &&L_OP_IF_UNEQUAL,
+		[OP_IF_LESSTHAN] = &&L_OP_IF_LESSTHAN,
+		[OP_IF_LESSOREQUAL] = &&L_OP_IF_LESSOREQUAL,
+		[OP_IF_GREATERTHAN] = &&L_OP_IF_GREATERTHAN,
+		[OP_IF_GREATEROREQUAL] = &&L_OP_IF_GREATEROREQUAL,
+		[OP_JUMP] = &&L_OP_JUMP,
+		[OP_CALL] = &&L_OP_CALL,
+		[OP_GOTO] = &&L_OP_GOTO,
+		[OP_GOSUB] = &&L_OP_GOSUB,
+		[OP_RETURN] = &&L_OP_RETURN,
+		[OP_END] = &&L_OP_END,
+		[OP_PRINT_STRING] = &&L_OP_PRINT_STRING,
+		[OP_PRINT_NUMBER] = &&L_OP_PRINT_NUMBER,
+		[OP_PRINT_LINE] = &&L_OP_PRINT_LINE,
+		[OP_INPUT] = &&L_OP_INPUT,
+		[OP_PEEK] = &&L_OP_PEEK,
+		[OP_POKE] = &&L_OP_POKE
+	};
+#define OPERATION(op) L_##op:
+#define NEXT goto *dispatch[code[start = pc++]]
+#else
+#define OPERATION(op) case op:
+#define NEXT break
+#endif
+
+	/* fetch and execute each operation in turn */
+#ifdef USE_COMPUTED_GOTO
+	NEXT;
+#else
+	for (;;) {
+		start = pc;
+		switch (code[pc++]) {
+#endif
+
+		/* values and variables */
+		OPERATION(OP_PUSH)
+			*sp++ = code[pc++];
+			NEXT;
+		OPERATION(OP_LOAD)
+			*sp++ = variables[code[pc++]];
+			NEXT;
+		OPERATION(OP_STORE)
+			variables[code[pc++]] = *--sp;
+			NEXT;
+
+		/* arithmetic */
+		OPERATION(OP_NEGATE)
+#ifdef USE_LIMIT_RESULT
+			if (SUBTRACT_OVERFLOWS(0, sp[-1], sp - 1) || OUT_OF_RANGE(sp[-1], shift)) {
+				code_raised = E_OVERFLOW;
+				goto fault;
+			}
+#else
+			sp[-1] = WRAP(0 - (uintptr_t)sp[-1], shift);
+#endif
+			NEXT;
+		OPERATION(OP_LIMIT)
+#ifdef USE_LIMIT_RESULT
+			if (OUT_OF_RANGE(sp[-1], shift)) {
+				code_raised = E_OVERFLOW;
+				goto fault;
+			}
+#endif
+			NEXT;
+		OPERATION(OP_ADD)
+			left = *(sp - 2);
+#ifdef USE_LIMIT_RESULT
+			if (ADD_OVERFLOWS(left, sp[-1], sp - 2) || OUT_OF_RANGE(*(sp - 2), shift)) {
+				code_raised = E_OVERFLOW;
+				goto fault;
+			}
+#else
+			*(sp - 2) = WRAP((uintptr_t)left + (uintptr_t)sp[-1], shift);
+#endif
+			--sp;
+			NEXT;
+		OPERATION(OP_SUBTRACT)
+			left = *(sp - 2);
+#ifdef USE_LIMIT_RESULT
+			if (SUBTRACT_OVERFLOWS(left, sp[-1], sp - 2) || OUT_OF_RANGE(*(sp - 2), shift)) {
+				code_raised = E_OVERFLOW;
+				goto fault;
+			}
+#else
+			*(sp - 2) = WRAP((uintptr_t)left - (uintptr_t)sp[-1], shift);
+#endif
+			--sp;
+			NEXT;
+		OPERATION(OP_MULTIPLY)
+			left = *(sp - 2);
+#ifdef USE_LIMIT_RESULT
+			if (MULTIPLY_OVERFLOWS(left, sp[-1], sp - 2) || OUT_OF_RANGE(*(sp - 2), shift)) {
+				code_raised = E_OVERFLOW;
+				goto fault;
+			}
+#else
+			*(sp - 2) = WRAP((uintptr_t)left * (uintptr_t)sp[-1], shift);
+#endif
+			--sp;
+			NEXT;
+		OPERATION(OP_DIVIDE)
+			if (sp[-1] == 0) {
+				code_raised = E_DIVIDE_BY_ZERO;
+				goto fault;
+			}
+			if (arithmetic(sp - 2, '/', sp[-1], shift)) {
+				code_raised = E_OVERFLOW;
+				goto fault;
+			}
+			--sp;
+			NEXT;
+
+		/* conditions: skip to the operand address when false */
+		OPERATION(OP_IF_EQUAL)
+			sp -= 2;
+			pc = (sp[0] == sp[1]) ? pc + 1 : code[pc];
+			NEXT;
+		OPERATION(OP_IF_UNEQUAL)
+			sp -= 2;
+			pc = (sp[0] != sp[1]) ? pc + 1 : code[pc];
+			NEXT;
+		OPERATION(OP_IF_LESSTHAN)
+			sp -= 2;
+			pc = (sp[0] < sp[1]) ? pc + 1 : code[pc];
+			NEXT;
+		OPERATION(OP_IF_LESSOREQUAL)
+			sp -= 2;
+			pc = (sp[0] <= sp[1]) ? pc + 1 : code[pc];
+			NEXT;
+		OPERATION(OP_IF_GREATERTHAN)
+			sp -= 2;
+			pc = (sp[0] > sp[1]) ? pc + 1 : code[pc];
+			NEXT;
+		OPERATION(OP_IF_GREATEROREQUAL)
+			sp -= 2;
+			pc = (sp[0] >= sp[1]) ? pc + 1 : code[pc];
+			NEXT;
+
+		/* control flow */
+		OPERATION(OP_GOTO)
+			if ((line = label_index_find(label_index, *--sp)) < 0) {
+				code_raised = E_INVALID_LINE_NUMBER;
+				goto fault;
+			}
+			pc = bytecode->addresses[line];
+			NEXT;
+		OPERATION(OP_JUMP)
+			pc = code[pc];
+			NEXT;
+		OPERATION(OP_CALL)
+			if (gosub_top >= gosub_limit) {
+				code_raised = E_TOO_MANY_GOSUBS;
+				goto fault;
+			}
+			gosub_stack[gosub_top++].address = code[pc + 1];
+			if (gosub_top > gosub_high_water)
+				gosub_high_water = gosub_top;
+			pc = code[pc];
+			NEXT;
+		OPERATION(OP_GOSUB)
+			if (gosub_top >= gosub_limit) {
+				code_raised = E_TOO_MANY_GOSUBS;
+				goto fault;
+			}
+			if ((line = label_index_find(label_index, *--sp)) < 0) {
+				code_raised = E_INVALID_LINE_NUMBER;
+				goto fault;
+			}
+			gosub_stack[gosub_top++].address = code[pc];
+			if (gosub_top > gosub_high_water)
+				gosub_high_water = gosub_top;
+			pc = bytecode->addresses[line];
+			NEXT;
+		OPERATION(OP_RETURN)
+			if (gosub_top == 0) {
+				code_raised = E_RETURN_WITHOUT_GOSUB;
+				goto fault;
+			}
+			pc = gosub_stack[--gosub_top].address;
+			NEXT;
+		OPERATION(OP_END)
+		OPERATION(OP_HALT)
+			goto done;
+
+		/* input and output */
+		OPERATION(OP_PRINT_STRING)
+			fprintf(output, _T("%s"), bytecode->strings[code[pc++]]);
+			line_open = 1;
+			NEXT;
+		OPERATION(OP_PRINT_NUMBER)
+			output_number(output, *--sp);
+			line_open = 1;
+			NEXT;
+		OPERATION(OP_PRINT_LINE)
+			if (line_open)
+				fprintf(output, _T("\n"));
+			line_open = 0;
+			NEXT;
+		OPERATION(OP_INPUT)
+			overflow = 0;
+			ch = 0;
+			for (count = code[pc++]; count; --count)
+				overflow |= input_value(input, &ch, &variables[code[pc++]], shift);
+			if (overflow) {
+				code_raised = E_OVERFLOW;
+				goto fault;
+			}
+			NEXT;
+
+		/* memory access */
+		OPERATION(OP_PEEK)
+			variables[code[pc++]] = *((int*)*--sp);
+			NEXT;
+		OPERATION(OP_POKE)
+			sp -= 2;
+			*(intptr_t*)sp[0] = sp[1];
+			NEXT;
+
+#ifndef USE_COMPUTED_GOTO
+		/* this only happens if the compiler has failed in its duty */
+		default:
+			code_raised = E_INVALID_EXPRESSION;
+			goto fault;
+		}
+	}
+#endif
+
+	/* report a runtime error against the line that raised it */
+fault:
+	if (line_open)
+		fprintf(output, _T("\n"));
+	line = bytecode_find_line(bytecode, start);
+	interpreter->priv->errors->set_code(interpreter->priv->errors, code_raised, 0, 0,
+		line < 0 ? 0 : bytecode->labels[line]);
+
+	/* release the value stack and record the GOSUB usage */
+done:
+	free(stack);
+	interpreter->priv->gosub_high_water = gosub_high_water;
+
+#undef OPERATION
+#undef NEXT
+}
+
+
+/*
+ * Prepare the variables and the GOSUB stack for a run
+ * params:
+ *   Interpreter*   interpreter   the interpreter
+ * returns:
+ *   int                          !0 if ready, 0 if an error was raised
+ */
+static int start_run(Interpreter* interpreter) {
+	interpreter->priv->stopped = 0;
+	interpreter->priv->gosub_stack_size = 0;
+	interpreter->priv->gosub_high_water = 0;
+	interpreter->priv->shift = 8 * (int)sizeof(intptr_t)
+		- interpreter->priv->options->get_integer_width(interpreter->priv->options);
+	initialise_variables(interpreter);
+	if (interpreter->priv->errors->get_code(interpreter->priv->errors))
+		return 0;
+	return reserve_gosub_stack(interpreter);
+}
+
+/*
+ * Index a compiled program's lines and run it
+ * params:
+ *   Interpreter*   interpreter   the interpreter
+ *   Bytecode*      bytecode      the compiled program
+ */
+static void run_bytecode(Interpreter* interpreter, Bytecode* bytecode) {
+
+	/* local variables */
+	LabelIndex* label_index; /* finds the lines by their labels */
+
+	/* run the program once its lines can be found */
+	if ((label_index = create_label_index
+		(interpreter, bytecode->labels, bytecode->line_count))) {
+		interpret_bytecode(interpreter, bytecode, label_index);
+		label_index_destroy(label_index);
+	}
 }
 
 
@@ -539,10 +1111,96 @@ static void interpret_program_from(ProgramLineNode* program_line) {
   *   ProgramNode*   program       the program to interpret
   */
 static void interpret(Interpreter* interpreter, ProgramNode* program) {
-	this = interpreter;
-	this->priv->program = program;
-	initialise_variables();
-	interpret_program_from(this->priv->program->first);
+
+	/* local variables */
+	Bytecode* bytecode; /* the compiled program */
+	ProgramLineNode* program_line; /* a line of the program */
+	int
+		* labels, /* the label of each line */
+		count = 0; /* number of lines */
+
+	/* initialise the run */
+	interpreter->priv->program = program;
+	if (!start_run(interpreter))
+		return;
+
+	/* run the syntax tree directly, as a profile needs... */
+	if (interpreter->priv->options->get_execution(interpreter->priv->options)
+		== EXECUTION_TREE || interpreter->priv->profile) {
+		for (program_line = program->first; program_line;
+			program_line = program_line->next)
+			++count;
+		labels = malloc((count + 1) * sizeof(int));
+		interpreter->priv->lines = malloc((count + 1) * sizeof(ProgramLineNode*));
+		if (labels && interpreter->priv->lines) {
+			count = 0;
+			for (program_line = program->first; program_line;
+				program_line = program_line->next) {
+				interpreter->priv->lines[count] = program_line;
+				labels[count++] = program_line->label;
+			}
+			if ((interpreter->priv->label_index = create_label_index(interpreter, labels, count)))
+				interpret_program_from(interpreter, interpreter->priv->program->first);
+		}
+		else
+			interpreter->priv->errors->set_code(interpreter->priv->errors, E_MEMORY, 0, 0, 0);
+		free(labels);
+		free(interpreter->priv->lines);
+		label_index_destroy(interpreter->priv->label_index);
+		interpreter->priv->lines = NULL;
+		interpreter->priv->label_index = NULL;
+	}
+
+	/* ...or compile it and run that */
+	else if ((bytecode = bytecode_compile(program, interpreter->priv->errors))) {
+		run_bytecode(interpreter, bytecode);
+		bytecode_destroy(bytecode);
+	}
+}
+
+/*
+ * Interpret a program compiled ahead of time, from the beginning
+ * params:
+ *   Interpreter*   interpreter   the interpreter to use
+ *   Bytecode*      bytecode      the compiled program
+ */
+static void interpret_compiled(Interpreter* interpreter, Bytecode* bytecode) {
+	interpreter->priv->program = NULL;
+	if (start_run(interpreter))
+		run_bytecode(interpreter, bytecode);
+}
+
+/*
+ * Direct the program's input and output to particular streams
+ * params:
+ *   Interpreter*   interpreter   the interpreter
+ *   FILE*          input         where INPUT reads from, or NULL for none
+ *   FILE*          output        where PRINT writes to
+ */
+static void set_streams(Interpreter* interpreter, FILE* input, FILE* output) {
+	interpreter->priv->input = input;
+	interpreter->priv->output = output;
+}
+
+/*
+ * Measure each line of the program as it runs
+ * params:
+ *   Interpreter*   interpreter   the interpreter
+ *   Profile*       profile       the profile to add to, or NULL for none
+ */
+static void set_profile(Interpreter* interpreter, Profile* profile) {
+	interpreter->priv->profile = profile;
+}
+
+/*
+ * Return the deepest the GOSUB stack grew during the last run
+ * params:
+ *   Interpreter*   interpreter   the interpreter
+ * returns:
+ *   int                          the GOSUB stack high-water mark
+ */
+static int get_gosub_high_water(Interpreter* interpreter) {
+	return interpreter->priv->gosub_high_water;
 }
 
 /*
@@ -552,8 +1210,10 @@ static void interpret(Interpreter* interpreter, ProgramNode* program) {
  */
 static void destroy(Interpreter* interpreter) {
 	if (interpreter) {
-		if (interpreter->priv)
+		if (interpreter->priv) {
+			free(interpreter->priv->gosub_stack);
 			free(interpreter->priv);
+		}
 		free(interpreter);
 	}
 }
@@ -571,25 +1231,40 @@ static void destroy(Interpreter* interpreter) {
   */
 Interpreter* new_Interpreter(ErrorHandler* errors, LanguageOptions* options) {
 
+	/* local variables */
+	Interpreter* interpreter; /* the new interpreter */
+
 	/* allocate memory */
-	this = malloc(sizeof(Interpreter));
-	if (this == NULL) return NULL;
-	this->priv = malloc(sizeof(InterpreterData));
-	if (this->priv == NULL) {
-		free(this);
+	interpreter = malloc(sizeof(Interpreter));
+	if (interpreter == NULL) return NULL;
+	interpreter->priv = malloc(sizeof(InterpreterData));
+	if (interpreter->priv == NULL) {
+		free(interpreter);
 		return NULL;
 	}
 	/* initialise methods */
-	this->interpret = interpret;
-	this->destroy = destroy;
+	interpreter->interpret = interpret;
+	interpreter->interpret_compiled = interpret_compiled;
+	interpreter->set_streams = set_streams;
+	interpreter->set_profile = set_profile;
+	interpreter->get_gosub_high_water = get_gosub_high_water;
+	interpreter->destroy = destroy;
 
 	/* initialise properties */
-	this->priv->gosub_stack = NULL;
-	this->priv->gosub_stack_size = 0;
-	this->priv->stopped = 0;
-	this->priv->errors = errors;
-	this->priv->options = options;
+	interpreter->priv->gosub_stack = NULL;
+	interpreter->priv->lines = NULL;
+	interpreter->priv->label_index = NULL;
+	interpreter->priv->profile = NULL;
+	interpreter->priv->gosub_stack_size = 0;
+	interpreter->priv->gosub_limit = 0;
+	interpreter->priv->gosub_high_water = 0;
+	interpreter->priv->stopped = 0;
+	interpreter->priv->shift = 0;
+	interpreter->priv->errors = errors;
+	interpreter->priv->options = options;
+	interpreter->priv->input = stdin;
+	interpreter->priv->output = stdout;
 
 	/* return the new object */
-	return this;
+	return interpreter;
 }
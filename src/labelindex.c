@@ -0,0 +1,266 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Line Label Index Module
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+/* included headers */
+#include <stdlib.h>
+#include "labelindex.h"
+
+
+/*
+ * Internal Data
+ */
+
+
+/* label ranges up to this size get a dense table */
+#define DENSE_LIMIT 65536
+
+/* a label and the line that carries it, for sorting */
+typedef struct {
+  int label; /* the label */
+  int line; /* position of the line in the program */
+} LabelEntry;
+
+
+/*
+ * Level 2 Functions
+ */
+
+
+/*
+ * Compare two label entries by label, then by program order
+ * params:
+ *   const void*   a   the first entry
+ *   const void*   b   the second entry
+ * returns:
+ *   int               <0, 0 or >0 as a is before, level with or after b
+ */
+static int compare_entries (const void *a, const void *b) {
+  const LabelEntry
+    *left = a, /* the first entry */
+    *right = b; /* the second entry */
+  if (left->label != right->label)
+    return left->label < right->label ? -1 : 1;
+  return left->line - right->line;
+}
+
+
+/*
+ * Level 1 Functions
+ */
+
+
+/*
+ * Fill a dense table
+ * params:
+ *   LabelIndex*   index    the index being built
+ *   int*          labels   the label of each line, in program order
+ *   int*          ceiling  highest label so far at each line, or NULL
+ */
+static void build_table (LabelIndex *index, int *labels, int *ceiling) {
+
+  /* local variables */
+  int
+    line, /* position of a line in the program */
+    label; /* a label in the range of the table */
+
+  /* exact matches: record the first line carrying each label */
+  if (index->exact) {
+    for (label = 0; label <= index->highest - index->lowest; ++label)
+      index->table[label] = -1;
+    for (line = index->count - 1; line >= 0; --line)
+      index->table[labels[line] - index->lowest] = line;
+  }
+
+  /* otherwise: the first line whose label reaches each value */
+  else
+    for (line = 0, label = index->lowest; label <= index->highest; ++label) {
+      while (ceiling[line] < label)
+        ++line;
+      index->table[label - index->lowest] = line;
+    }
+}
+
+/*
+ * Fill the sorted keys for binary search
+ * params:
+ *   LabelIndex*   index    the index being built
+ *   int*          labels   the label of each line, in program order
+ *   int*          ceiling  highest label so far at each line, or NULL
+ * returns:
+ *   int                    !0 if successful, 0 if memory ran out
+ */
+static int build_keys (LabelIndex *index, int *labels, int *ceiling) {
+
+  /* local variables */
+  LabelEntry *entries; /* labels sorted with their lines */
+  int line; /* position of a line in the program */
+
+  /* the running highest label is already in order */
+  if (! index->exact) {
+    for (line = 0; line < index->count; ++line) {
+      index->keys[line] = ceiling[line];
+      index->lines[line] = line;
+    }
+    index->key_count = index->count;
+    return 1;
+  }
+
+  /* sort the labels, keeping the first line for each */
+  if (! (entries = malloc (index->count * sizeof (LabelEntry))))
+    return 0;
+  for (line = 0; line < index->count; ++line) {
+    entries[line].label = labels[line];
+    entries[line].line = line;
+  }
+  qsort (entries, index->count, sizeof (LabelEntry), compare_entries);
+  index->key_count = 0;
+  for (line = 0; line < index->count; ++line)
+    if (! index->key_count
+      || index->keys[index->key_count - 1] != entries[line].label) {
+      index->keys[index->key_count] = entries[line].label;
+      index->lines[index->key_count++] = entries[line].line;
+    }
+  free (entries);
+  return 1;
+}
+
+
+/*
+ * Public Functions
+ */
+
+
+/*
+ * Build a label index
+ * params:
+ *   int*   labels   the label of each line, in program order
+ *   int    count    the number of lines
+ *   int    exact    !0 to find exact matches only; 0 to find the first
+ *                   line whose label is equal or greater
+ * returns:
+ *   LabelIndex*     the new index, NULL if memory ran out
+ */
+LabelIndex *label_index_create (int *labels, int count, int exact) {
+
+  /* local variables */
+  LabelIndex *index; /* the index to build */
+  int
+    *ceiling = NULL, /* highest label so far at each line */
+    line, /* position of a line in the program */
+    lowest, /* lowest label in the program */
+    highest, /* highest label in the program */
+    ok = 1; /* cleared if memory runs out */
+
+  /* allocate the index */
+  if (! (index = malloc (sizeof (LabelIndex))))
+    return NULL;
+  index->exact = exact;
+  index->count = count;
+  index->table = index->keys = index->lines = NULL;
+  index->key_count = 0;
+  index->lowest = index->highest = 0;
+  if (! count)
+    return index;
+
+  /* find the label range, and the running highest label in program order */
+  if (! exact && ! (ceiling = malloc (count * sizeof (int)))) {
+    free (index);
+    return NULL;
+  }
+  lowest = highest = labels[0];
+  for (line = 0; line < count; ++line) {
+    if (labels[line] < lowest)
+      lowest = labels[line];
+    if (labels[line] > highest)
+      highest = labels[line];
+    if (ceiling)
+      ceiling[line] = highest;
+  }
+  index->lowest = lowest;
+  index->highest = highest;
+
+  /* use a dense table where the labels are not too spread out */
+  if ((unsigned) (highest - lowest) < DENSE_LIMIT) {
+    if ((index->table = malloc ((highest - lowest + 1) * sizeof (int))))
+      build_table (index, labels, ceiling);
+    else
+      ok = 0;
+  }
+
+  /* otherwise use binary search */
+  else {
+    index->keys = malloc (count * sizeof (int));
+    index->lines = malloc (count * sizeof (int));
+    ok = index->keys && index->lines
+      && build_keys (index, labels, ceiling);
+  }
+
+  /* tidy up and return the index */
+  free (ceiling);
+  if (! ok) {
+    label_index_destroy (index);
+    return NULL;
+  }
+  return index;
+}
+
+/*
+ * Find the line a jump to a label will reach
+ * params:
+ *   LabelIndex*   index   the label index
+ *   intptr_t      label   the label to find
+ * returns:
+ *   int                   position of the line in the program, -1 if none
+ */
+int label_index_find (LabelIndex *index, intptr_t label) {
+
+  /* local variables */
+  int
+    low, /* lowest key still in the running */
+    high, /* highest key still in the running */
+    middle; /* the key to check */
+
+  /* labels outside the program's range */
+  if (! index->count || label > index->highest)
+    return -1;
+  if (label < index->lowest)
+    return index->exact ? -1 : 0;
+
+  /* dense table lookup */
+  if (index->table)
+    return index->table[label - index->lowest];
+
+  /* binary search for the first key that is equal or greater */
+  low = 0;
+  high = index->key_count;
+  while (low < high) {
+    middle = (low + high) / 2;
+    if (index->keys[middle] < label)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  if (index->exact && index->keys[low] != label)
+    return -1;
+  return index->lines[low];
+}
+
+/*
+ * Label index destructor
+ * params:
+ *   LabelIndex*   index   the doomed index
+ */
+void label_index_destroy (LabelIndex *index) {
+  if (index) {
+    free (index->table);
+    free (index->keys);
+    free (index->lines);
+    free (index);
+  }
+}
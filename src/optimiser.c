@@ -0,0 +1,435 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Optimiser Module
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+/* included headers */
+#include <stdlib.h>
+#include "common.h"
+#include "statement.h"
+#include "expression.h"
+#include "optimiser.h"
+
+
+/*
+ * Internal Data
+ */
+
+
+/* the values a constant is folded to, which any factor can hold at any
+   integer width */
+#define FOLD_LOWEST -32768
+#define FOLD_HIGHEST 32767
+
+/* set if the interpreter checks the range of intermediate results; the
+   optimiser must then keep every check that could fail */
+#ifdef USE_LIMIT_RESULT
+#define LIMITED 1
+#else
+#define LIMITED 0
+#endif
+
+
+/*
+ * Forward References
+ */
+
+
+/* optimise_factor() has a forward reference to optimise_expression() */
+static int optimise_expression (ExpressionNode *expression, long long *value);
+
+
+/*
+ * Level 3 Functions
+ */
+
+
+/*
+ * Get the value of a constant factor
+ * params:
+ *   FactorNode*   factor   the factor
+ *   long long*    value    receives the value, sign applied
+ * returns:
+ *   int                    !0 if the factor is a constant, 0 if not
+ */
+static int factor_value (FactorNode *factor, long long *value) {
+  if (factor->class != FACTOR_VALUE)
+    return 0;
+  *value = factor->sign == SIGN_NEGATIVE
+    ? -(long long) factor->data.value
+    : factor->data.value;
+  return 1;
+}
+
+/*
+ * Turn a factor into a constant
+ * params:
+ *   FactorNode*   factor   the factor
+ *   long long     value    the value it is to have
+ */
+static void make_value (FactorNode *factor, long long value) {
+  factor->class = FACTOR_VALUE;
+  factor->sign = value < 0 ? SIGN_NEGATIVE : SIGN_POSITIVE;
+  factor->data.value = (int) (value < 0 ? -value : value);
+}
+
+/*
+ * Apply an operation to two constants as the interpreter would
+ * params:
+ *   long long*   left    the left operand, which receives the result
+ *   int          op      '+', '-', '*' or '/'
+ *   long long    right   the right operand
+ * returns:
+ *   int                  !0 if done, 0 if it would raise an error or
+ *                        leave the range of the narrowest integer width
+ */
+static int evaluate (long long *left, int op, long long right) {
+
+  /* local variables */
+  long long result; /* the result of the operation */
+
+  /* carry out the operation, refusing to divide by zero */
+  switch (op) {
+    case '+':
+      result = *left + right;
+      break;
+    case '-':
+      result = *left - right;
+      break;
+    case '*':
+      result = *left * right;
+      break;
+    default:
+      if (! right)
+        return 0;
+      result = *left / right;
+  }
+
+  /* a wider result would wrap or be checked at some integer widths */
+  if (result < FOLD_LOWEST || result > FOLD_HIGHEST)
+    return 0;
+  *left = result;
+  return 1;
+}
+
+/*
+ * Find whether a term's result is always range checked by the interpreter
+ * params:
+ *   TermNode*   term   the term
+ * returns:
+ *   int                !0 if its last operation checks the result
+ */
+static int term_checked (TermNode *term) {
+
+  /* local variables */
+  RightHandFactor *rhfactor; /* the last right-hand factor */
+
+  /* factors and products are checked, quotients are not */
+  if (! (rhfactor = term->next))
+    return 1;
+  while (rhfactor->next)
+    rhfactor = rhfactor->next;
+  return rhfactor->op == TERM_OPERATOR_MULTIPLY;
+}
+
+
+/*
+ * Level 2 Functions
+ */
+
+
+/*
+ * Optimise a factor, folding a constant or removing needless parentheses
+ * params:
+ *   FactorNode*   factor   the factor
+ *   long long*    value    receives its value if it is a constant
+ * returns:
+ *   int                    !0 if the factor is a constant, 0 if not
+ */
+static int optimise_factor (FactorNode *factor, long long *value) {
+
+  /* local variables */
+  ExpressionNode *expression; /* a parenthesised expression */
+  FactorNode *inner; /* the sole factor of the parenthesised expression */
+  SignClass sign; /* the sign of the two factors combined */
+
+  /* only parenthesised expressions need work */
+  if (factor->class != FACTOR_EXPRESSION)
+    return factor_value (factor, value);
+  expression = factor->data.expression;
+
+  /* a constant expression folds to a value if a factor can hold it */
+  if (optimise_expression (expression, value)) {
+    if (factor->sign == SIGN_NEGATIVE)
+      *value = -*value;
+    if (*value >= FOLD_LOWEST && *value <= FOLD_HIGHEST) {
+      make_value (factor, *value);
+      return 1;
+    }
+  }
+
+  /* a lone factor needs no parentheses, unless its own check could fail
+     where the check of the negated result would not */
+  if (! expression->next && ! expression->term->next
+    && (factor->sign == SIGN_POSITIVE || ! LIMITED)) {
+    inner = expression->term->factor;
+    sign = inner->sign == factor->sign ? SIGN_POSITIVE : SIGN_NEGATIVE;
+    *factor = *inner;
+    factor->sign = sign;
+  }
+  return factor_value (factor, value);
+}
+
+/*
+ * Optimise a term
+ * params:
+ *   TermNode*    term    the term
+ *   long long*   value   receives its value if it is a constant
+ * returns:
+ *   int                  !0 if the term is a constant, 0 if not
+ */
+static int optimise_term (TermNode *term, long long *value) {
+
+  /* local variables */
+  RightHandFactor
+    *rhfactor, /* a right-hand factor */
+    *folded = NULL, /* the last right-hand factor folded into the first */
+    **link; /* the link to the right-hand factor being checked */
+  TermNode *inner; /* the term in a leading pair of parentheses */
+  long long
+    operand, /* the value of a constant right-hand factor */
+    running; /* the running value of the constant factors */
+  int
+    constant, /* set if the first factor is a constant */
+    checked; /* set if the result so far is range checked */
+
+  /* optimise the factors */
+  constant = optimise_factor (term->factor, value);
+  for (rhfactor = term->next; rhfactor; rhfactor = rhfactor->next)
+    optimise_factor (rhfactor->factor, &operand);
+
+  /* open up a checked term in leading parentheses: (A*B)*C is A*B*C */
+  if (term->factor->class == FACTOR_EXPRESSION
+    && term->factor->sign == SIGN_POSITIVE
+    && ! term->factor->data.expression->next
+    && (term_checked (inner = term->factor->data.expression->term)
+    || ! LIMITED)) {
+    if ((rhfactor = inner->next)) {
+      while (rhfactor->next)
+        rhfactor = rhfactor->next;
+      rhfactor->next = term->next;
+      term->next = inner->next;
+    }
+    term->factor = inner->factor;
+    constant = factor_value (term->factor, value);
+  }
+
+  /* fold the constant factors at the front */
+  if (constant) {
+    running = *value;
+    for (rhfactor = term->next;
+      rhfactor && factor_value (rhfactor->factor, &operand)
+      && evaluate (&running,
+        rhfactor->op == TERM_OPERATOR_MULTIPLY ? '*' : '/', operand);
+      rhfactor = rhfactor->next) {
+      *value = running;
+      folded = rhfactor;
+    }
+    if (folded) {
+      make_value (term->factor, *value);
+      term->next = folded->next;
+    }
+  }
+
+  /* 1*A is A, which is checked as a factor */
+  while (factor_value (term->factor, &operand) && operand == 1
+    && term->next && term->next->op == TERM_OPERATOR_MULTIPLY) {
+    term->factor = term->next->factor;
+    term->next = term->next->next;
+  }
+
+  /* drop multiplications and divisions by 1, unless a check would go */
+  checked = 1;
+  for (link = &term->next; *link;)
+    if (factor_value ((*link)->factor, &operand) && operand == 1
+      && ((*link)->op == TERM_OPERATOR_DIVIDE || checked || ! LIMITED))
+      *link = (*link)->next;
+    else {
+      checked = (*link)->op == TERM_OPERATOR_MULTIPLY;
+      link = &(*link)->next;
+    }
+
+  /* the term is a constant if a lone value is left */
+  return ! term->next && factor_value (term->factor, value);
+}
+
+/*
+ * Optimise an expression
+ * params:
+ *   ExpressionNode*   expression   the expression
+ *   long long*        value        receives its value if it is a constant
+ * returns:
+ *   int                            !0 if the expression is a constant
+ */
+static int optimise_expression (ExpressionNode *expression,
+  long long *value) {
+
+  /* local variables */
+  RightHandTerm
+    *rhterm, /* a right-hand term */
+    *folded = NULL, /* the last right-hand term folded into the first */
+    **link; /* the link to the right-hand term being checked */
+  ExpressionNode *inner; /* the expression in leading parentheses */
+  long long
+    operand, /* the value of a constant right-hand term */
+    running; /* the running value of the constant terms */
+  int
+    constant, /* set if the first term is a constant */
+    checked; /* set if the result so far is range checked */
+
+  /* optimise the terms */
+  constant = optimise_term (expression->term, value);
+  for (rhterm = expression->next; rhterm; rhterm = rhterm->next)
+    optimise_term (rhterm->term, &operand);
+
+  /* open up a leading parenthesised sum, which its last operation checks:
+     (A+B)+C is A+B+C */
+  if (! expression->term->next
+    && expression->term->factor->class == FACTOR_EXPRESSION
+    && expression->term->factor->sign == SIGN_POSITIVE
+    && (inner = expression->term->factor->data.expression)->next) {
+    for (rhterm = inner->next; rhterm->next; rhterm = rhterm->next);
+    rhterm->next = expression->next;
+    expression->next = inner->next;
+    expression->term = inner->term;
+    constant = ! expression->term->next
+      && factor_value (expression->term->factor, value);
+  }
+
+  /* fold the constant terms at the front */
+  if (constant) {
+    running = *value;
+    for (rhterm = expression->next;
+      rhterm && ! rhterm->term->next
+      && factor_value (rhterm->term->factor, &operand)
+      && evaluate (&running,
+        rhterm->op == EXPRESSION_OPERATOR_PLUS ? '+' : '-', operand);
+      rhterm = rhterm->next) {
+      *value = running;
+      folded = rhterm;
+    }
+    if (folded) {
+      make_value (expression->term->factor, *value);
+      expression->term->next = NULL;
+      expression->next = folded->next;
+    }
+  }
+
+  /* 0+A is A, if A's own result is checked as the sum's would be */
+  while (! expression->term->next
+    && factor_value (expression->term->factor, &operand) && ! operand
+    && expression->next && expression->next->op == EXPRESSION_OPERATOR_PLUS
+    && (term_checked (expression->next->term) || ! LIMITED)) {
+    expression->term = expression->next->term;
+    expression->next = expression->next->next;
+  }
+
+  /* drop additions and subtractions of 0, unless a check would go */
+  checked = term_checked (expression->term);
+  for (link = &expression->next; *link;)
+    if (! (*link)->term->next
+      && factor_value ((*link)->term->factor, &operand) && ! operand
+      && (checked || ! LIMITED))
+      *link = (*link)->next;
+    else {
+      checked = 1;
+      link = &(*link)->next;
+    }
+
+  /* the expression is a constant if a lone value is left */
+  return ! expression->next && ! expression->term->next
+    && factor_value (expression->term->factor, value);
+}
+
+
+/*
+ * Level 1 Functions
+ */
+
+
+/*
+ * Optimise the expressions of a statement
+ * params:
+ *   StatementNode*   statement   the statement
+ */
+static void optimise_statement (StatementNode *statement) {
+
+  /* local variables */
+  OutputNode *output; /* an item of a PRINT list */
+  long long value; /* the value of a constant expression, unused */
+
+  /* comments have no statement */
+  if (! statement)
+    return;
+
+  /* optimise each expression the statement has */
+  switch (statement->class) {
+    case STATEMENT_LET:
+      optimise_expression (statement->statement.letn->expression, &value);
+      break;
+    case STATEMENT_IF:
+      optimise_expression (statement->statement.ifn->left, &value);
+      optimise_expression (statement->statement.ifn->right, &value);
+      optimise_statement (statement->statement.ifn->statement);
+      break;
+    case STATEMENT_GOTO:
+      optimise_expression (statement->statement.goton->label, &value);
+      break;
+    case STATEMENT_GOSUB:
+      optimise_expression (statement->statement.gosubn->label, &value);
+      break;
+    case STATEMENT_PRINT:
+      for (output = statement->statement.printn->first; output;
+        output = output->next)
+        if (output->class == OUTPUT_EXPRESSION)
+          optimise_expression (output->output.expression, &value);
+      break;
+    case STATEMENT_POKE:
+      optimise_expression (statement->statement.poken->address, &value);
+      optimise_expression (statement->statement.poken->value, &value);
+      break;
+    case STATEMENT_PEEK:
+      optimise_expression (statement->statement.peekn->address, &value);
+      break;
+    default:
+      break;
+  }
+}
+
+
+/*
+ * Public Functions
+ */
+
+
+/*
+ * Simplify the expressions of a parsed program in place, folding constants
+ * and removing operations that cannot change a result
+ * params:
+ *   ProgramNode*   program   the program to optimise
+ */
+void optimise_program (ProgramNode *program) {
+
+  /* local variables */
+  ProgramLineNode *program_line; /* a line of the program */
+
+  /* optimise each line in turn */
+  if (program)
+    for (program_line = program->first; program_line;
+      program_line = program_line->next)
+      optimise_statement (program_line->statement);
+}
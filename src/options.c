@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include "options.h"
 
 
@@ -25,13 +26,10 @@ typedef struct {
   int line_limit; /* highest line number allowed */
   CommentOption comments; /* enabled, disabled */
   int gosub_limit; /* how many nested gosubs */
+  ExecutionOption execution; /* bytecode, tree */
+  int integer_width; /* bits in a variable or a result */
 } FileTokenizerPrivateData;
 
-/* convenience variables */
-static LanguageOptions *this; /* object being worked on */
-static FileTokenizerPrivateData *data; /* the object's private data */
-
-
 /*
  * Public Methods
  */
@@ -45,8 +43,7 @@ static FileTokenizerPrivateData *data; /* the object's private data */
  */
 static void set_line_numbers (LanguageOptions *options,
   LineNumberOption line_numbers) {
-  this = options;
-  data = this->data;
+  FileTokenizerPrivateData *data = options->data; /* the private data */
   data->line_numbers = line_numbers;
 }
 
@@ -57,8 +54,7 @@ static void set_line_numbers (LanguageOptions *options,
  *   int                 line_limit     line number limit to set
  */
 static void set_line_limit (LanguageOptions *options, int line_limit) {
-  this = options;
-  data = this->data;
+  FileTokenizerPrivateData *data = options->data; /* the private data */
   data->line_limit = line_limit;
 }
 
@@ -69,8 +65,7 @@ static void set_line_limit (LanguageOptions *options, int line_limit) {
  *   CommentOption       comments   comment option to set
  */
 static void set_comments (LanguageOptions *options, CommentOption comments) {
-  this = options;
-  data = this->data;
+  FileTokenizerPrivateData *data = options->data; /* the private data */
   data->comments = comments;
 }
 
@@ -81,11 +76,33 @@ static void set_comments (LanguageOptions *options, CommentOption comments) {
  *   int               limit     the desired stack limit
  */
 static void set_gosub_limit (LanguageOptions *options, int gosub_limit) {
-  this = options;
-  data = this->data;
+  FileTokenizerPrivateData *data = options->data; /* the private data */
   data->gosub_limit = gosub_limit;
 }
 
+/*
+ * Set the execution option
+ * params:
+ *   LanguageOptions*   options     the options
+ *   ExecutionOption    execution   execution option to set
+ */
+static void set_execution (LanguageOptions *options,
+  ExecutionOption execution) {
+  FileTokenizerPrivateData *data = options->data; /* the private data */
+  data->execution = execution;
+}
+
+/*
+ * Set the integer width
+ * params:
+ *   LanguageOptions*   options         the options
+ *   int                integer_width   bits in a variable: 16, 32 or 64
+ */
+static void set_integer_width (LanguageOptions *options, int integer_width) {
+  FileTokenizerPrivateData *data = options->data; /* the private data */
+  data->integer_width = integer_width;
+}
+
 /*
  * Return the line number setting
  * params:
@@ -94,8 +111,7 @@ static void set_gosub_limit (LanguageOptions *options, int gosub_limit) {
  *   LineNumberOption             the line number setting
  */
 static LineNumberOption get_line_numbers (LanguageOptions *options) {
-  this = options;
-  data = this->data;
+  FileTokenizerPrivateData *data = options->data; /* the private data */
   return data->line_numbers;
 }
 
@@ -107,8 +123,7 @@ static LineNumberOption get_line_numbers (LanguageOptions *options) {
  *   int                          the line number setting
  */
 static int get_line_limit (LanguageOptions *options) {
-  this = options;
-  data = this->data;
+  FileTokenizerPrivateData *data = options->data; /* the private data */
   return data->line_limit;
 }
 
@@ -120,8 +135,7 @@ static int get_line_limit (LanguageOptions *options) {
  *   CommentOption                the line number setting
  */
 static CommentOption get_comments (LanguageOptions *options) {
-  this = options;
-  data = this->data;
+  FileTokenizerPrivateData *data = options->data; /* the private data */
   return data->comments;
 }
 
@@ -133,11 +147,34 @@ static CommentOption get_comments (LanguageOptions *options) {
  *   int                          the current GOSUB stack limit
  */
 static int get_gosub_limit (LanguageOptions *options) {
-  this = options;
-  data = this->data;
+  FileTokenizerPrivateData *data = options->data; /* the private data */
   return data->gosub_limit;
 }
 
+/*
+ * Return the execution setting
+ * params:
+ *   LanguageOptions*   options   the options
+ * returns:
+ *   ExecutionOption              the execution setting
+ */
+static ExecutionOption get_execution (LanguageOptions *options) {
+  FileTokenizerPrivateData *data = options->data; /* the private data */
+  return data->execution;
+}
+
+/*
+ * Return the integer width
+ * params:
+ *   LanguageOptions*   options   the options
+ * returns:
+ *   int                          bits in a variable or a result
+ */
+static int get_integer_width (LanguageOptions *options) {
+  FileTokenizerPrivateData *data = options->data; /* the private data */
+  return data->integer_width;
+}
+
 /*
  * Destroy the settings object
  * params:
@@ -158,31 +195,45 @@ static void destroy (LanguageOptions *options) {
  */
 LanguageOptions *new_LanguageOptions (void) {
 
+  /* local variables */
+  LanguageOptions *options; /* the new object */
+  FileTokenizerPrivateData *data; /* its private data */
+
   /* allocate memory */
-  this = malloc (sizeof (LanguageOptions));
-  if (this == NULL) return NULL;
-  data = this->data = malloc (sizeof (FileTokenizerPrivateData));
+  options = malloc (sizeof (LanguageOptions));
+  if (options == NULL) return NULL;
+  data = options->data = malloc (sizeof (FileTokenizerPrivateData));
   if (data == NULL) {
-      free(this);
+      free(options);
       return NULL;
   }
   /* initialise methods */
-  this->set_line_numbers = set_line_numbers;
-  this->set_line_limit = set_line_limit;
-  this->set_comments = set_comments;
-  this->set_gosub_limit = set_gosub_limit;
-  this->get_line_numbers = get_line_numbers;
-  this->get_line_limit = get_line_limit;
-  this->get_comments = get_comments;
-  this->get_gosub_limit = get_gosub_limit;
-  this->destroy = destroy;
+  options->set_line_numbers = set_line_numbers;
+  options->set_line_limit = set_line_limit;
+  options->set_comments = set_comments;
+  options->set_gosub_limit = set_gosub_limit;
+  options->set_execution = set_execution;
+  options->set_integer_width = set_integer_width;
+  options->get_line_numbers = get_line_numbers;
+  options->get_line_limit = get_line_limit;
+  options->get_comments = get_comments;
+  options->get_gosub_limit = get_gosub_limit;
+  options->get_execution = get_execution;
+  options->get_integer_width = get_integer_width;
+  options->destroy = destroy;
 
   /* initialise properties */
   data->line_numbers = LINE_NUMBERS_OPTIONAL;
   data->line_limit = 32767;
   data->comments = COMMENTS_ENABLED;
   data->gosub_limit = 64;
+  data->execution = EXECUTION_BYTECODE;
+#ifdef USE_LIMIT_RESULT
+  data->integer_width = 16; /* the range limited builds have always checked */
+#else
+  data->integer_width = 8 * sizeof (intptr_t);
+#endif
 
   /* return the new object */
-  return this;
+  return options;
 }
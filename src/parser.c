@@ -12,13 +12,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
 #include "common.h"
+#ifdef USE_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
 #include "errors.h"
 #include "options.h"
 #include "token.h"
 #include "tokenizer.h"
 #include "parser.h"
 #include "expression.h"
+#include "labelindex.h"
 
 
 /*
@@ -27,10 +33,10 @@
 
 
 /* parse_expression() has a forward reference from parse_factor() */
-static ExpressionNode *parse_expression (void);
+static ExpressionNode *parse_expression (Parser *parser);
 
 /* parse_statement() has a forward reference from parse_if_statement() */
-static StatementNode *parse_statement (void);
+static StatementNode *parse_statement (Parser *parser);
 
 
 /*
@@ -43,14 +49,29 @@ typedef struct parser_data {
   int last_label; /* last line label encountered */
   int current_line; /* the last source line parsed */
   int end_of_file; /* end of file signal */
-  Token *stored_token; /* token read ahead */
+  Token stored_token; /* token read ahead, class TOKEN_NONE if none */
   TokenStream *stream; /* the input stream */
   ErrorHandler *errors; /* the parse error handler */
   LanguageOptions *options; /* the language options */
+  Arena *arena; /* holds the nodes of the program being parsed */
+  int jobs; /* threads to parse a large program, 0 for one per CPU */
+  ProgramLineNode *first_labelled; /* first line with a label of its own */
+  int lead_label; /* last_label on reaching that line */
 } ParserData;
 
-/* convenience variables */
-static Parser *this; /* the current parser being worked on */
+#ifdef USE_THREADS
+/* a line-aligned chunk of a large program, parsed on a thread of its own */
+typedef struct {
+  Parser *parser; /* the parser for the chunk */
+  ErrorHandler *errors; /* the chunk's own error handler */
+  ProgramNode *program; /* the lines parsed from the chunk */
+  pthread_t thread; /* the thread parsing it */
+  int started; /* !0 if the thread was started */
+} ParseChunk;
+
+/* the least text, in characters, worth a thread of its own */
+#define CHUNK_MINIMUM 65536
+#endif
 
 
 /*
@@ -60,114 +81,110 @@ static Parser *this; /* the current parser being worked on */
 
 /*
  * Get next token to parse, from read-ahead buffer or tokeniser.
+ * params:
+ *   Parser*   parser   the parser
+ * returns:
+ *   Token              the token
  */
-static Token *get_token_to_parse () {
+static Token get_token_to_parse (Parser *parser) {
 
   /* local variables */
-  Token *token; /* token to return */
+  Token token; /* token to return */
 
   /* get the token one way or another */
-  if (this->priv->stored_token) {
-    token = this->priv->stored_token;
-    this->priv->stored_token = NULL;
+  if (parser->priv->stored_token.class != TOKEN_NONE) {
+    token = parser->priv->stored_token;
+    parser->priv->stored_token.class = TOKEN_NONE;
   } else
-    token = this->priv->stream->next (this->priv->stream);
+    token = parser->priv->stream->next (parser->priv->stream);
 
   /* store the line, check EOF and return the token */
-  this->priv->current_line = token->get_line (token);
-  if (token->get_class (token) == TOKEN_EOF)
-    this->priv->end_of_file = !0;
+  parser->priv->current_line = token.line;
+  if (token.class == TOKEN_EOF)
+    parser->priv->end_of_file = !0;
   return token;
 }
 
 /*
  * Parse a factor
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   FactorNode*   a new factor node holding the parsed data
  */
-static FactorNode *parse_factor (void) {
+static FactorNode *parse_factor (Parser *parser) {
 
   /* local variables */
-  Token *token; /* token to read */
+  Token token; /* token to read */
   FactorNode *factor = NULL; /* the factor we're building */
   ExpressionNode *expression = NULL; /* any parenthesised expression */
   int start_line; /* the line on which this factor occurs */
+  long value; /* the value of a number */
 
   /* initialise the factor and grab the next token */
-  factor = factor_create ();
-  token = get_token_to_parse ();
-  start_line = token->get_line (token);
+  factor = factor_create (parser->priv->arena);
+  token = get_token_to_parse (parser);
+  start_line = token.line;
 
   /* interpret a sign */
-  if (token->get_class (token) == TOKEN_PLUS
-    || token->get_class (token) == TOKEN_MINUS) {
-    factor->sign = (token->get_class (token) == TOKEN_PLUS)
+  if (token.class == TOKEN_PLUS
+    || token.class == TOKEN_MINUS) {
+    factor->sign = (token.class == TOKEN_PLUS)
       ? SIGN_POSITIVE
       : SIGN_NEGATIVE;
-    token->destroy (token);
-    token = get_token_to_parse ();
+    token = get_token_to_parse (parser);
   }
 
   /* interpret a number */
-  if (token->get_class (token) == TOKEN_NUMBER) {
+  if (token.class == TOKEN_NUMBER) {
     factor->class = FACTOR_VALUE;
-    factor->data.value = atoi (token->get_content (token));
-#ifdef USE_LIMIT_RESULT
-    if (factor->data.value < -32768 || factor->data.value > 32767)
-      this->priv->errors->set_code
-        (this->priv->errors, E_OVERFLOW, start_line,0, this->priv->last_label);
-#endif
-    token->destroy (token);
+    value = strtol (token.text, NULL, 10);
+    if (value > (parser->priv->options->get_integer_width
+      (parser->priv->options) == 16 ? 32767 : INT_MAX))
+      parser->priv->errors->set_code
+        (parser->priv->errors, E_OVERFLOW, start_line,0, parser->priv->last_label);
+    factor->data.value = (int) value;
   }
 
   /* interpret a variable */
-  else if (token->get_class (token) == TOKEN_VARIABLE) {
+  else if (token.class == TOKEN_VARIABLE) {
     factor->class = FACTOR_VARIABLE;
-    factor->data.variable = (int) *token->get_content (token) & 0x1F;
-    token->destroy (token);
+    factor->data.variable = (int) *token.text & 0x1F;
   }
 
   /* interpret an parenthesised expression */
-  else if (token->get_class (token) == TOKEN_LEFT_PARENTHESIS) {
+  else if (token.class == TOKEN_LEFT_PARENTHESIS) {
 
     /* parse the parenthesised expression and complete the factor */
-    token->destroy (token);
-    expression = parse_expression ();
+    expression = parse_expression (parser);
     if (expression) {
-      token = get_token_to_parse ();
-      if (token->get_class (token) == TOKEN_RIGHT_PARENTHESIS) {
+      token = get_token_to_parse (parser);
+      if (token.class == TOKEN_RIGHT_PARENTHESIS) {
         factor->class = FACTOR_EXPRESSION;
         factor->data.expression = expression;
       } else {
-        this->priv->errors->set_code
-          (this->priv->errors, E_MISSING_RIGHT_PARENTHESIS, 
+        parser->priv->errors->set_code
+          (parser->priv->errors, E_MISSING_RIGHT_PARENTHESIS, 
               start_line,
               0,
-            this->priv->last_label);
-        factor_destroy (factor);
+            parser->priv->last_label);
         factor = NULL;
-        expression_destroy (expression);
       }
-      token->destroy (token);
     }
 
     /* clean up after invalid parenthesised expression */
     else {
-      this->priv->errors->set_code (this->priv->errors, E_INVALID_EXPRESSION,
-        token->get_line (token), token->get_pos(token), this->priv->last_label);
-      token->destroy (token);
-      factor_destroy (factor);
+      parser->priv->errors->set_code (parser->priv->errors, E_INVALID_EXPRESSION,
+        start_line, 0, parser->priv->last_label);
       factor = NULL;
     }
   }
 
   /* deal with other errors */
   else {
-    this->priv->errors->set_code
-      (this->priv->errors, E_INVALID_EXPRESSION, token->get_line (token),
-          token->get_pos(token), this->priv->last_label);
-    factor_destroy (factor);
-    token->destroy (token);
+    parser->priv->errors->set_code
+      (parser->priv->errors, E_INVALID_EXPRESSION, token.line,
+          token.pos, parser->priv->last_label);
     factor = NULL;
   }
 
@@ -179,10 +196,12 @@ static FactorNode *parse_factor (void) {
  * Parse a term
  * globals:
  *   Token*      stored_token   the token read past the end of the term
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   TermNode*   a new term node holding the parsed term
  */
-static TermNode *parse_term (void) {
+static TermNode *parse_term (Parser *parser) {
 
   /* local variables */
   TermNode *term = NULL; /* the term we're building */
@@ -190,26 +209,26 @@ static TermNode *parse_term (void) {
   RightHandFactor
     *rhptr = NULL, /* previous right-hand factor */
     *rhfactor = NULL; /* right-hand factor detected */
-  Token *token = NULL; /* token read while looking for operator */
+  Token token; /* token read while looking for operator */
 
   /* scan the first factor */
-  if ((factor = parse_factor ())) {
-    term = term_create ();
+  if ((factor = parse_factor (parser))) {
+    term = term_create (parser->priv->arena);
     term->factor = factor;
     term->next = NULL;
 
     /* look for subsequent factors */
-    while ((token = get_token_to_parse ())
-      && ! this->priv->errors->get_code (this->priv->errors)
-      && (token->get_class (token) == TOKEN_MULTIPLY
-      || token->get_class (token) == TOKEN_DIVIDE)) {
+    token = get_token_to_parse (parser);
+    while (! parser->priv->errors->get_code (parser->priv->errors)
+      && (token.class == TOKEN_MULTIPLY
+      || token.class == TOKEN_DIVIDE)) {
 
       /* parse the sign and the factor */
-      rhfactor = rhfactor_create ();
-      rhfactor->op = token->get_class (token) == TOKEN_MULTIPLY
+      rhfactor = rhfactor_create (parser->priv->arena);
+      rhfactor->op = token.class == TOKEN_MULTIPLY
           ? TERM_OPERATOR_MULTIPLY
           : TERM_OPERATOR_DIVIDE;
-      if ((rhfactor->factor = parse_factor ())) {
+      if ((rhfactor->factor = parse_factor (parser))) {
         rhfactor->next = NULL;
         if (rhptr)
           rhptr->next = rhfactor;
@@ -220,20 +239,19 @@ static TermNode *parse_term (void) {
 
       /* set an error if we read an operator but not a factor */
       else {
-        rhfactor_destroy (rhfactor);
-        if (! this->priv->errors->get_code (this->priv->errors))
-          this->priv->errors->set_code
-            (this->priv->errors, E_INVALID_EXPRESSION, token->get_line (token),
-                token->get_pos(token),
-              this->priv->last_label);
+        if (! parser->priv->errors->get_code (parser->priv->errors))
+          parser->priv->errors->set_code
+            (parser->priv->errors, E_INVALID_EXPRESSION, token.line,
+                token.pos,
+              parser->priv->last_label);
       }
 
-      /* clean up token */
-      token->destroy (token);
+      /* look for another operator */
+      token = get_token_to_parse (parser);
     }
 
     /* we've read past the end of the term; put the token back */
-    this->priv->stored_token = token;
+    parser->priv->stored_token = token;
   }
 
   /* return the evaluated term, if any */
@@ -242,10 +260,12 @@ static TermNode *parse_term (void) {
 
 /*
  * Parse an expression
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   ExpressionNode*    the parsed expression
  */
-static ExpressionNode *parse_expression (void) {
+static ExpressionNode *parse_expression (Parser *parser) {
 
   /* local variables */
   ExpressionNode *expression = NULL; /* the expression we build */
@@ -253,26 +273,26 @@ static ExpressionNode *parse_expression (void) {
   RightHandTerm
     *rhterm = NULL, /* the right-hand term detected */
     *rhptr = NULL; /* pointer to the previous right-hand term */
-  Token *token; /* token read when scanning for right-hand terms */
+  Token token; /* token read when scanning for right-hand terms */
 
   /* scan the first term */
-  if ((term = parse_term ())) {
-    expression = expression_create ();
+  if ((term = parse_term (parser))) {
+    expression = expression_create (parser->priv->arena);
     expression->term = term;
     expression->next = NULL;
 
     /* look for subsequent terms */
-    while ((token = get_token_to_parse ())
-      && ! this->priv->errors->get_code (this->priv->errors)
-      && (token->get_class (token) == TOKEN_PLUS
-      || token->get_class (token) == TOKEN_MINUS)) {
+    token = get_token_to_parse (parser);
+    while (! parser->priv->errors->get_code (parser->priv->errors)
+      && (token.class == TOKEN_PLUS
+      || token.class == TOKEN_MINUS)) {
 
       /* parse the sign and the factor */
-      rhterm = rhterm_create ();
-      rhterm->op = token->get_class (token) == TOKEN_PLUS
+      rhterm = rhterm_create (parser->priv->arena);
+      rhterm->op = token.class == TOKEN_PLUS
           ? EXPRESSION_OPERATOR_PLUS
           : EXPRESSION_OPERATOR_MINUS;
-      if ((rhterm->term = parse_term ())) {
+      if ((rhterm->term = parse_term (parser))) {
         rhterm->next = NULL;
         if (rhptr)
           rhptr->next = rhterm;
@@ -283,20 +303,19 @@ static ExpressionNode *parse_expression (void) {
 
       /* set an error condition if we read a sign but not a factor */
       else {
-        rhterm_destroy (rhterm);
-        if (! this->priv->errors->get_code (this->priv->errors))
-          this->priv->errors->set_code
-            (this->priv->errors, E_INVALID_EXPRESSION, token->get_line (token),
-                token->get_pos(token),
-              this->priv->last_label);
+        if (! parser->priv->errors->get_code (parser->priv->errors))
+          parser->priv->errors->set_code
+            (parser->priv->errors, E_INVALID_EXPRESSION, token.line,
+                token.pos,
+              parser->priv->last_label);
       }
 
-      /* clean up token */
-      token->destroy (token);
+      /* look for another operator */
+      token = get_token_to_parse (parser);
     }
 
     /* we've read past the end of the term; put the token back */
-    this->priv->stored_token = token;
+    parser->priv->stored_token = token;
   }
 
   /* return the evaluated expression, if any */
@@ -306,13 +325,15 @@ static ExpressionNode *parse_expression (void) {
 /*
  * Calculate numeric line label according to language options.
  * This will be used if the line has no label specified.
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   int                         numeric line label
  */
-static int generate_default_label (void) {
-  if (this->priv->options->get_line_numbers (this->priv->options)
+static int generate_default_label (Parser *parser) {
+  if (parser->priv->options->get_line_numbers (parser->priv->options)
     == LINE_NUMBERS_IMPLIED)
-    return this->priv->last_label + 1;
+    return parser->priv->last_label + 1;
   else
     return 0;
 }
@@ -320,26 +341,27 @@ static int generate_default_label (void) {
 /*
  * Validate a line label according to the language options
  * params:
+ *   Parser*           parser    the parser
  *   int               label     the numeric label to verify.
  * returns:
  *   int                         !0 if the number is valid, 0 if invalid
  */
-static int validate_line_label (int label) {
+static int validate_line_label (Parser *parser, int label) {
 
   /* line labels should be non-negative and within the set limit */
   if (label < 0
-    || label > this->priv->options->get_line_limit (this->priv->options))
+    || label > parser->priv->options->get_line_limit (parser->priv->options))
     return 0;
 
   /* line labels should be non-zero unless they're optional */
   if (label == 0
-    && this->priv->options->get_line_numbers (this->priv->options)
+    && parser->priv->options->get_line_numbers (parser->priv->options)
       != LINE_NUMBERS_OPTIONAL)
     return 0;
 
   /* line labels should be ascending unless they're optional */
-  if (label <= this->priv->last_label
-    && this->priv->options->get_line_numbers (this->priv->options)
+  if (label <= parser->priv->last_label
+    && parser->priv->options->get_line_numbers (parser->priv->options)
       != LINE_NUMBERS_OPTIONAL)
     return 0;
 
@@ -349,52 +371,47 @@ static int validate_line_label (int label) {
 
 /*
  * Parse a LET statement
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   StatementNode*          The statement assembled
  */
-static StatementNode *parse_let_statement (void) {
+static StatementNode *parse_let_statement (Parser *parser) {
 
   /* local variables */
-  Token *token; /* tokens read as part of LET statement */
+  Token token; /* tokens read as part of LET statement */
   int line; /* line containing the LET token */
   StatementNode *statement; /* the new statement */
 
   /* initialise the statement */
-  statement = statement_create ();
+  statement = statement_create (parser->priv->arena);
   statement->class = STATEMENT_LET;
-  statement->statement.letn = statement_create_let ();
-  line = this->priv->stream->get_line (this->priv->stream);
+  statement->statement.letn = statement_create_let (parser->priv->arena);
+  line = parser->priv->stream->get_line (parser->priv->stream);
 
   /* see what variable we're assigning */
-  token = get_token_to_parse ();
-  TokenClass tc = token->get_class(token);
+  token = get_token_to_parse (parser);
+  TokenClass tc = token.class;
   if (tc != TOKEN_VARIABLE) {
-    this->priv->errors->set_code
-      (this->priv->errors, E_INVALID_VARIABLE, line,0, this->priv->last_label);
-    statement_destroy (statement);
-    token->destroy (token);
+    parser->priv->errors->set_code
+      (parser->priv->errors, E_INVALID_VARIABLE, line,0, parser->priv->last_label);
     return NULL;
   }
-  statement->statement.letn->variable = *token->get_content (token) & 0x1f;
+  statement->statement.letn->variable = *token.text & 0x1f;
 
   /* get the "=" */
-  token->destroy (token);
-  token = get_token_to_parse ();
-  if (token->get_class (token) != TOKEN_EQUAL) {
-    this->priv->errors->set_code
-      (this->priv->errors, E_INVALID_ASSIGNMENT, line,0, this->priv->last_label);
-    statement_destroy (statement);
-    token->destroy (token);
+  token = get_token_to_parse (parser);
+  if (token.class != TOKEN_EQUAL) {
+    parser->priv->errors->set_code
+      (parser->priv->errors, E_INVALID_ASSIGNMENT, line,0, parser->priv->last_label);
     return NULL;
   }
-  token->destroy (token);
 
   /* get the expression */
-  statement->statement.letn->expression = parse_expression ();
+  statement->statement.letn->expression = parse_expression (parser);
   if (! statement->statement.letn->expression) {
-    this->priv->errors->set_code
-      (this->priv->errors, E_INVALID_EXPRESSION, line,0, this->priv->last_label);
-    statement_destroy (statement);
+    parser->priv->errors->set_code
+      (parser->priv->errors, E_INVALID_EXPRESSION, line,0, parser->priv->last_label);
     return NULL;
   }
 
@@ -406,59 +423,51 @@ static StatementNode *parse_let_statement (void) {
 /*
  * Parse a Poke statement
  * Poke Address, Value
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   StatementNode*          The statement assembled
  */
-static StatementNode* parse_poke_statement(void) {
+static StatementNode* parse_poke_statement(Parser *parser) {
 
     /* local variables */
-    Token* token; /* tokens read as part of LET statement */
+    Token token; /* tokens read as part of LET statement */
     int line; /* line containing the LET token */
     StatementNode* statement; /* the new statement */
 
     /* initialise the statement */
-    statement = statement_create();
+    statement = statement_create(parser->priv->arena);
     statement->class = STATEMENT_POKE;
-    statement->statement.poken = statement_create_poke();
-    line = this->priv->stream->get_line(this->priv->stream);
+    statement->statement.poken = statement_create_poke(parser->priv->arena);
+    line = parser->priv->stream->get_line(parser->priv->stream);
 
     /* see what variable we're assigning */
-    token = get_token_to_parse();
-    if (token->get_class(token) != TOKEN_POKE) {
-        this->priv->errors->set_code
-        (this->priv->errors, E_UNRECOGNISED_COMMAND, line,0, this->priv->last_label);
-        statement_destroy(statement);
-        token->destroy(token);
+    token = get_token_to_parse(parser);
+    if (token.class != TOKEN_POKE) {
+        parser->priv->errors->set_code
+        (parser->priv->errors, E_UNRECOGNISED_COMMAND, line,0, parser->priv->last_label);
         return NULL;
     }
-    /* get the "," */
-    token->destroy(token);
-
     /* get the expression */
-    statement->statement.poken->address = parse_expression();
+    statement->statement.poken->address = parse_expression(parser);
     if (!statement->statement.poken->address) {
-        this->priv->errors->set_code
-        (this->priv->errors, E_INVALID_EXPRESSION, line,0, this->priv->last_label);
-        statement_destroy(statement);
+        parser->priv->errors->set_code
+        (parser->priv->errors, E_INVALID_EXPRESSION, line,0, parser->priv->last_label);
         return NULL;
     }
 
-    token = get_token_to_parse();
-    if (token->get_class(token) != TOKEN_COMMA) {
-        this->priv->errors->set_code
-        (this->priv->errors, E_INVALID_ASSIGNMENT, line,0, this->priv->last_label);
-        statement_destroy(statement);
-        token->destroy(token);
+    token = get_token_to_parse(parser);
+    if (token.class != TOKEN_COMMA) {
+        parser->priv->errors->set_code
+        (parser->priv->errors, E_INVALID_ASSIGNMENT, line,0, parser->priv->last_label);
         return NULL;
     }
-    token->destroy(token);
 
     /* get the expression */
-    statement->statement.poken->value = parse_expression();
+    statement->statement.poken->value = parse_expression(parser);
     if (!statement->statement.poken->value) {
-        this->priv->errors->set_code
-        (this->priv->errors, E_INVALID_EXPRESSION, line,0, this->priv->last_label);
-        statement_destroy(statement);
+        parser->priv->errors->set_code
+        (parser->priv->errors, E_INVALID_EXPRESSION, line,0, parser->priv->last_label);
         return NULL;
     }
 
@@ -469,64 +478,53 @@ static StatementNode* parse_poke_statement(void) {
 /*
  * Parse a Peek statement
  * Peek Address, Value
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   StatementNode*          The statement assembled
  */
-static StatementNode* parse_peek_statement(void) {
+static StatementNode* parse_peek_statement(Parser *parser) {
 
     /* local variables */
-    Token* token; /* tokens read as part of LET statement */
+    Token token; /* tokens read as part of LET statement */
     int line; /* line containing the LET token */
     StatementNode* statement; /* the new statement */
 
     /* initialise the statement */
-    statement = statement_create();
+    statement = statement_create(parser->priv->arena);
     statement->class = STATEMENT_PEEK;
-    statement->statement.peekn = statement_create_peek();
-    line = this->priv->stream->get_line(this->priv->stream);
+    statement->statement.peekn = statement_create_peek(parser->priv->arena);
+    line = parser->priv->stream->get_line(parser->priv->stream);
 
     /* see what variable we're assigning */
-    token = get_token_to_parse();
-    if (token->get_class(token) != TOKEN_PEEK) {
-        this->priv->errors->set_code
-        (this->priv->errors, E_UNRECOGNISED_COMMAND, line,0, this->priv->last_label);
-        statement_destroy(statement);
-        token->destroy(token);
+    token = get_token_to_parse(parser);
+    if (token.class != TOKEN_PEEK) {
+        parser->priv->errors->set_code
+        (parser->priv->errors, E_UNRECOGNISED_COMMAND, line,0, parser->priv->last_label);
         return NULL;
     }
-    /* get the "," */
-    token->destroy(token);
-
     /* see what variable we're assigning */
-    token = get_token_to_parse();
-    if (token->get_class(token) != TOKEN_VARIABLE) {
-        this->priv->errors->set_code
-        (this->priv->errors, E_INVALID_VARIABLE, line,0, this->priv->last_label);
-        statement_destroy(statement);
-        token->destroy(token);
+    token = get_token_to_parse(parser);
+    if (token.class != TOKEN_VARIABLE) {
+        parser->priv->errors->set_code
+        (parser->priv->errors, E_INVALID_VARIABLE, line,0, parser->priv->last_label);
         return NULL;
     }
     //get the variable
-    statement->statement.peekn->variable = *token->get_content(token) & 0x1f;
-
-    token->destroy(token);
+    statement->statement.peekn->variable = *token.text & 0x1f;
 
-    token = get_token_to_parse();
-    if (token->get_class(token) != TOKEN_COMMA) {
-        this->priv->errors->set_code
-        (this->priv->errors, E_INVALID_ASSIGNMENT, line,0, this->priv->last_label);
-        statement_destroy(statement);
-        token->destroy(token);
+    token = get_token_to_parse(parser);
+    if (token.class != TOKEN_COMMA) {
+        parser->priv->errors->set_code
+        (parser->priv->errors, E_INVALID_ASSIGNMENT, line,0, parser->priv->last_label);
         return NULL;
     }
-    token->destroy(token);
 
     /* get the expression */
-    statement->statement.peekn->address = parse_expression();
+    statement->statement.peekn->address = parse_expression(parser);
     if (!statement->statement.peekn->address) {
-        this->priv->errors->set_code
-        (this->priv->errors, E_INVALID_EXPRESSION, line,0, this->priv->last_label);
-        statement_destroy(statement);
+        parser->priv->errors->set_code
+        (parser->priv->errors, E_INVALID_EXPRESSION, line,0, parser->priv->last_label);
         return NULL;
     }
 
@@ -537,27 +535,29 @@ static StatementNode* parse_peek_statement(void) {
 
 /*
  * Parse an IF statement
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   StatementNode*          The statement to assemble.
  */
-static StatementNode *parse_if_statement (void) {
+static StatementNode *parse_if_statement (Parser *parser) {
 
   /* local variables */
-  Token *token; /* tokens read as part of the statement */
+  Token token; /* tokens read as part of the statement */
   StatementNode *statement; /* the IF statement */
 
   /* initialise the statement */
-  statement = statement_create ();
+  statement = statement_create (parser->priv->arena);
   statement->class = STATEMENT_IF;
-  statement->statement.ifn = statement_create_if ();
+  statement->statement.ifn = statement_create_if (parser->priv->arena);
 
   /* parse the first expression */
-  statement->statement.ifn->left = parse_expression ();
+  statement->statement.ifn->left = parse_expression (parser);
 
   /* parse the operator */
-  if (! this->priv->errors->get_code (this->priv->errors)) {
-    token = get_token_to_parse ();
-    switch (token->get_class (token)) {
+  if (! parser->priv->errors->get_code (parser->priv->errors)) {
+    token = get_token_to_parse (parser);
+    switch (token.class) {
     case TOKEN_EQUAL:
       statement->statement.ifn->op = RELOP_EQUAL;
       break;
@@ -577,36 +577,32 @@ static StatementNode *parse_if_statement (void) {
       statement->statement.ifn->op = RELOP_GREATEROREQUAL;
       break;
     default:
-      this->priv->errors->set_code
-        (this->priv->errors, E_INVALID_OPERATOR, token->get_line (token), token->get_pos(token),
-        this->priv->last_label);
+      parser->priv->errors->set_code
+        (parser->priv->errors, E_INVALID_OPERATOR, token.line, token.pos,
+        parser->priv->last_label);
     }
-    token->destroy (token);
   }
 
   /* parse the second expression */
-  if (! this->priv->errors->get_code (this->priv->errors))
-    statement->statement.ifn->right = parse_expression ();
+  if (! parser->priv->errors->get_code (parser->priv->errors))
+    statement->statement.ifn->right = parse_expression (parser);
 
   /* parse the THEN */
-  if (! this->priv->errors->get_code (this->priv->errors)) {
-    token = get_token_to_parse ();
-    if (token->get_class (token) != TOKEN_THEN)
-      this->priv->errors->set_code
-        (this->priv->errors, E_THEN_EXPECTED, token->get_line (token), token->get_pos(token),
-        this->priv->last_label);
-    token->destroy (token);
+  if (! parser->priv->errors->get_code (parser->priv->errors)) {
+    token = get_token_to_parse (parser);
+    if (token.class != TOKEN_THEN)
+      parser->priv->errors->set_code
+        (parser->priv->errors, E_THEN_EXPECTED, token.line, token.pos,
+        parser->priv->last_label);
   }
 
   /* parse the conditional statement */
-  if (! this->priv->errors->get_code (this->priv->errors))
-    statement->statement.ifn->statement = parse_statement ();
+  if (! parser->priv->errors->get_code (parser->priv->errors))
+    statement->statement.ifn->statement = parse_statement (parser);
 
-  /* destroy the half-made statement if errors occurred */
-  if (this->priv->errors->get_code (this->priv->errors)) {
-    statement_destroy (statement);
+  /* abandon the half-made statement to the arena if errors occurred */
+  if (parser->priv->errors->get_code (parser->priv->errors))
     statement = NULL;
-  }
 
   /* return the statement */
   return statement;
@@ -614,24 +610,24 @@ static StatementNode *parse_if_statement (void) {
 
 /*
  * Parse a GOTO statement
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   StatementNode*   the parsed GOTO statement
  */
-static StatementNode *parse_goto_statement (void) {
+static StatementNode *parse_goto_statement (Parser *parser) {
 
   /* local variables */
   StatementNode *statement; /* the IF statement */
 
   /* initialise the statement */
-  statement = statement_create ();
+  statement = statement_create (parser->priv->arena);
   statement->class = STATEMENT_GOTO;
-  statement->statement.goton = statement_create_goto ();
+  statement->statement.goton = statement_create_goto (parser->priv->arena);
 
   /* parse the line label expression */
-  if (! (statement->statement.goton->label = parse_expression ())) {
-    statement_destroy (statement);
+  if (! (statement->statement.goton->label = parse_expression (parser)))
     statement = NULL;
-  }
 
   /* return the new statement */
   return statement;
@@ -639,24 +635,24 @@ static StatementNode *parse_goto_statement (void) {
 
 /*
  * Parse a GOSUB statement
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   StatementNode*   the parsed GOSUB statement
  */
-static StatementNode *parse_gosub_statement (void) {
+static StatementNode *parse_gosub_statement (Parser *parser) {
 
   /* local variables */
   StatementNode *statement; /* the IF statement */
 
   /* initialise the statement */
-  statement = statement_create ();
+  statement = statement_create (parser->priv->arena);
   statement->class = STATEMENT_GOSUB;
-  statement->statement.gosubn = statement_create_gosub ();
+  statement->statement.gosubn = statement_create_gosub (parser->priv->arena);
 
   /* parse the line label expression */
-  if (! (statement->statement.gosubn->label = parse_expression ())) {
-    statement_destroy (statement);
+  if (! (statement->statement.gosubn->label = parse_expression (parser)))
     statement = NULL;
-  }
 
   /* return the new statement */
   return statement;
@@ -664,37 +660,43 @@ static StatementNode *parse_gosub_statement (void) {
 
 /*
  * Parse an RETURN statement
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   StatementNode*          The statement assembled
  */
-static StatementNode *parse_return_statement (void) {
+static StatementNode *parse_return_statement (Parser *parser) {
   StatementNode *statement; /* the RETURN */
-  statement = statement_create ();
+  statement = statement_create (parser->priv->arena);
   statement->class = STATEMENT_RETURN;
   return statement;
 }
 
 /*
  * Parse an END statement
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   StatementNode*          The statement assembled
  */
-static StatementNode *parse_end_statement (void) {
+static StatementNode *parse_end_statement (Parser *parser) {
   StatementNode *statement = NULL; /* the END */
-  statement = statement_create ();
+  statement = statement_create (parser->priv->arena);
   statement->class = STATEMENT_END;
   return statement;
 }
 
 /*
  * Parse a PRINT statement
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   StatementNode*          The statement assembled
  */
-static StatementNode *parse_print_statement (void) {
+static StatementNode *parse_print_statement (Parser *parser) {
 
   /* local variables */
-  Token *token = NULL; /* tokens read as part of the statement */
+  Token token; /* tokens read as part of the statement */
   StatementNode *statement; /* the statement we're building */
   int line; /* line containing the PRINT token */
   OutputNode
@@ -703,93 +705,86 @@ static StatementNode *parse_print_statement (void) {
   ExpressionNode *expression; /* a parsed expression */
 
   /* initialise the statement */
-  statement = statement_create ();
+  statement = statement_create (parser->priv->arena);
   statement->class = STATEMENT_PRINT;
-  statement->statement.printn = statement_create_print ();
-  line = this->priv->stream->get_line (this->priv->stream);
+  statement->statement.printn = statement_create_print (parser->priv->arena);
+  line = parser->priv->stream->get_line (parser->priv->stream);
 
   /* main loop for parsing the output list */
   do {
 
-    /* discard a previous comma, and read the next output value */
-    if (token)
-      token->destroy (token);
-    token = get_token_to_parse ();
+    /* read the next output value, past any previous comma */
+    token = get_token_to_parse (parser);
 
     /* process a premature end of line */
-    if (token->get_class (token) == TOKEN_EOF
-      || token->get_class (token) == TOKEN_EOL) {
-      this->priv->errors->set_code
-        (this->priv->errors, E_INVALID_PRINT_OUTPUT, line,0,
-        this->priv->last_label);
-      statement_destroy (statement);
+    if (token.class == TOKEN_EOF
+      || token.class == TOKEN_EOL) {
+      parser->priv->errors->set_code
+        (parser->priv->errors, E_INVALID_PRINT_OUTPUT, line,0,
+        parser->priv->last_label);
       statement = NULL;
-      token->destroy (token);
     }
 
     /* process a literal string */
-    else if (token->get_class (token) == TOKEN_STRING) {
-      nextoutput = malloc (sizeof (OutputNode));
+    else if (token.class == TOKEN_STRING) {
+      nextoutput = arena_alloc (parser->priv->arena, sizeof (OutputNode));
       if (nextoutput != NULL) {
           nextoutput->class = OUTPUT_STRING;
-          nextoutput->output.string = _malloc
-          (1 + strlen(token->get_content(token)));
-          if (nextoutput->output.string != NULL)
-              strcpy(nextoutput->output.string, token->get_content(token));
+          nextoutput->output.string = arena_strdup
+            (parser->priv->arena, token.text);
           nextoutput->next = NULL;
       }
-      token->destroy (token);
     }
 
     /* attempt to process an expression */
     else {
-      this->priv->stored_token = token;
-      if ((expression = parse_expression ())) {
-        nextoutput = malloc (sizeof (OutputNode));
+      parser->priv->stored_token = token;
+      if ((expression = parse_expression (parser))) {
+        nextoutput = arena_alloc (parser->priv->arena, sizeof (OutputNode));
         if (nextoutput != NULL) {
             nextoutput->class = OUTPUT_EXPRESSION;
             nextoutput->output.expression = expression;
             nextoutput->next = NULL;
         }
       } else {
-        this->priv->errors->set_code
-          (this->priv->errors, E_INVALID_PRINT_OUTPUT, token->get_line (token),
-             token->get_pos(token),
-              this->priv->last_label);
-        statement_destroy (statement);
+        parser->priv->errors->set_code
+          (parser->priv->errors, E_INVALID_PRINT_OUTPUT, line, 0,
+              parser->priv->last_label);
         statement = NULL;
       }
     }
 
     /* add this output item to the statement and look for another */
-    if (! this->priv->errors->get_code (this->priv->errors)) {
+    if (! parser->priv->errors->get_code (parser->priv->errors)) {
       if (lastoutput)
         lastoutput->next = nextoutput;
       else if(statement!=NULL)
         statement->statement.printn->first = nextoutput;
       lastoutput = nextoutput;
-      token = get_token_to_parse ();
+      token = get_token_to_parse (parser);
     }
 
   /* continue the loop until the statement appears to be finished */
-  } while (! this->priv->errors->get_code (this->priv->errors)
-    && token->get_class (token) == TOKEN_COMMA);
+  } while (! parser->priv->errors->get_code (parser->priv->errors)
+    && token.class == TOKEN_COMMA);
 
   /* push back the last token and return the assembled statement */
-  if (! this->priv->errors->get_code (this->priv->errors))
-    this->priv->stored_token = token;
+  if (! parser->priv->errors->get_code (parser->priv->errors))
+    parser->priv->stored_token = token;
   return statement;
 }
 
 /*
  * Parse an INPUT statement
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   StatementNode*          The statement assembled
  */
-static StatementNode *parse_input_statement (void) {
+static StatementNode *parse_input_statement (Parser *parser) {
 
   /* local variables */
-  Token *token = NULL; /* tokens read as part of the statement */
+  Token token; /* tokens read as part of the statement */
   StatementNode *statement; /* the statement we're building */
   int line; /* line containing the INPUT token */
   VariableListNode
@@ -797,119 +792,108 @@ static StatementNode *parse_input_statement (void) {
     *lastvar = NULL; /* the last variable node we parsed */
 
   /* initialise the statement */
-  statement = statement_create ();
+  statement = statement_create (parser->priv->arena);
   statement->class = STATEMENT_INPUT;
-  statement->statement.inputn = statement_create_input ();
-  line = this->priv->stream->get_line (this->priv->stream);
+  statement->statement.inputn = statement_create_input (parser->priv->arena);
+  line = parser->priv->stream->get_line (parser->priv->stream);
 
   /* main loop for parsing the variable list */
   do {
 
-    /* discard a previous comma, and seek the next variable */
-    if (token) token->destroy (token);
-    token = get_token_to_parse ();
+    /* seek the next variable, past any previous comma */
+    token = get_token_to_parse (parser);
 
     /* process a premature end of line */
-    if (token->get_class (token) == TOKEN_EOF
-      || token->get_line (token) != line) {
-      this->priv->errors->set_code
-        (this->priv->errors, E_INVALID_VARIABLE, line, 0, this->priv->last_label);
-      statement_destroy (statement);
+    if (token.class == TOKEN_EOF
+      || token.line != line) {
+      parser->priv->errors->set_code
+        (parser->priv->errors, E_INVALID_VARIABLE, line, 0, parser->priv->last_label);
       statement = NULL;
     }
 
     /* attempt to process an variable name */
-    else if (token->get_class (token) != TOKEN_VARIABLE) {
-      this->priv->errors->set_code
-        (this->priv->errors, E_INVALID_VARIABLE, token->get_line (token),
+    else if (token.class != TOKEN_VARIABLE) {
+      parser->priv->errors->set_code
+        (parser->priv->errors, E_INVALID_VARIABLE, token.line,
             0,
-	this->priv->last_label);
-      statement_destroy (statement);
+	parser->priv->last_label);
       statement = NULL;
     } else {
-      nextvar = malloc (sizeof (VariableListNode));
+      nextvar = arena_alloc (parser->priv->arena, sizeof (VariableListNode));
       if (nextvar != NULL) {
-          nextvar->variable = *token->get_content(token) & 0x1f;
+          nextvar->variable = *token.text & 0x1f;
           nextvar->next = NULL;
       }
-      token->destroy (token);
     }
 
     /* add this variable to the statement and look for another */
-    if (! this->priv->errors->get_code (this->priv->errors)) {
+    if (! parser->priv->errors->get_code (parser->priv->errors)) {
       if (lastvar)
         lastvar->next = nextvar;
       else if(statement!=NULL)
         statement->statement.inputn->first = nextvar;
       lastvar = nextvar;
-      token = get_token_to_parse ();
+      token = get_token_to_parse (parser);
     }
-  } while (! this->priv->errors->get_code (this->priv->errors)
-    && token->get_class (token) == TOKEN_COMMA);
+  } while (! parser->priv->errors->get_code (parser->priv->errors)
+    && token.class == TOKEN_COMMA);
 
   /* return the assembled statement */
-  this->priv->stored_token = token;
+  parser->priv->stored_token = token;
   return statement;
 }
 
 /*
  * Parse a statement from the source file
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   StatementNode*   a fully-assembled statement, hopefully.
  */
-static StatementNode *parse_statement () {
+static StatementNode *parse_statement (Parser *parser) {
 
   /* local variables */
-  Token *token; /* token read */
+  Token token; /* token read */
   StatementNode *statement = NULL; /* the new statement */
 
   /* get the next token */
-  token = get_token_to_parse ();
+  token = get_token_to_parse (parser);
 
   /* check for command */
-  TokenClass tc = token->get_class(token);
+  TokenClass tc = token.class;
   switch (tc) {
     case TOKEN_EOL:
-      this->priv->stored_token = token;
+      parser->priv->stored_token = token;
       statement = NULL;
       break;
     case TOKEN_LET:
-      token->destroy (token);
-      statement = parse_let_statement ();
+      statement = parse_let_statement (parser);
       break;
     case TOKEN_IF:
-      token->destroy (token);
-      statement = parse_if_statement ();
+      statement = parse_if_statement (parser);
       break;
     case TOKEN_GOTO:
-      token->destroy (token);
-      statement = parse_goto_statement ();
+      statement = parse_goto_statement (parser);
       break;
     case TOKEN_GOSUB:
-      token->destroy (token);
-      statement = parse_gosub_statement ();
+      statement = parse_gosub_statement (parser);
       break;
     case TOKEN_RETURN:
-      token->destroy (token);
-      statement = parse_return_statement ();
+      statement = parse_return_statement (parser);
       break;
     case TOKEN_END:
-      token->destroy (token);
-      statement = parse_end_statement ();
+      statement = parse_end_statement (parser);
       break;
     case TOKEN_PRINT:
-      token->destroy (token);
-      statement = parse_print_statement ();
+      statement = parse_print_statement (parser);
       break;
     case TOKEN_INPUT:
-      token->destroy (token);
-      statement = parse_input_statement ();
+      statement = parse_input_statement (parser);
       break;
     default:
-      this->priv->errors->set_code
-        (this->priv->errors, E_UNRECOGNISED_COMMAND, token->get_line (token),
-        token->get_pos(token), this->priv->last_label);
-      token->destroy (token);
+      parser->priv->errors->set_code
+        (parser->priv->errors, E_UNRECOGNISED_COMMAND, token.line,
+        token.pos, parser->priv->last_label);
   }
 
   /* return the statement */
@@ -918,79 +902,215 @@ static StatementNode *parse_statement () {
 
 /*
  * Parse a line from the source file.
+ * params:
+ *   Parser*   parser   the parser
  * returns:
  *   StatementNode           a fully-assembled statement, hopefully.
  */
-static ProgramLineNode *parse_program_line (void) {
+static ProgramLineNode *parse_program_line (Parser *parser) {
 
   /* local variables */
-  Token *token; /* token read */
+  Token token; /* token read */
   ProgramLineNode *program_line; /* program line read */
   int label_encountered = 0; /* 1 if this line has an explicit label */
 
   /* initialise the program line and get the first token */
-  program_line = program_line_create ();
-  program_line->label = generate_default_label ();
-  token = get_token_to_parse ();
+  program_line = program_line_create (parser->priv->arena);
+  program_line->label = generate_default_label (parser);
+  token = get_token_to_parse (parser);
 
   /* deal with end of file */
-  if (token->get_class (token) == TOKEN_EOF) {
-    token->destroy (token);
-    program_line_destroy (program_line);
+  if (token.class == TOKEN_EOF) {
     return NULL;
   }
 
   /* deal with line label, if supplied */
-  if (token->get_class (token) == TOKEN_NUMBER) {
-    program_line->label = atoi (token->get_content (token));
+  if (token.class == TOKEN_NUMBER) {
+    program_line->label = atoi (token.text);
     label_encountered = 1;
-    token->destroy (token);
   } else
-    this->priv->stored_token = token;
+    parser->priv->stored_token = token;
 
   /* validate the supplied or implied line label */
-  if (! validate_line_label (program_line->label)) {
-    this->priv->errors->set_code
-      (this->priv->errors, E_INVALID_LINE_NUMBER, this->priv->current_line,0,
+  if (! validate_line_label (parser, program_line->label)) {
+    parser->priv->errors->set_code
+      (parser->priv->errors, E_INVALID_LINE_NUMBER, parser->priv->current_line,0,
       program_line->label);
-    program_line_destroy (program_line);
     return NULL;
   }
-  if (label_encountered)
-    this->priv->last_label = program_line->label;
+  if (label_encountered) {
+    if (! parser->priv->first_labelled) {
+      parser->priv->first_labelled = program_line;
+      parser->priv->lead_label = parser->priv->last_label;
+    }
+    parser->priv->last_label = program_line->label;
+  }
 
   /* check for a statement and an EOL */
-  program_line->statement = parse_statement ();
-  if (! this->priv->errors->get_code (this->priv->errors)) {
-    token = get_token_to_parse ();
-    if (token->get_class (token) != TOKEN_EOL
-      && token->get_class (token) != TOKEN_EOF)
-      this->priv->errors->set_code
-        (this->priv->errors, E_UNEXPECTED_PARAMETER, this->priv->current_line,0,
-        this->priv->last_label);
-    token->destroy (token);
+  program_line->statement = parse_statement (parser);
+  if (! parser->priv->errors->get_code (parser->priv->errors)) {
+    token = get_token_to_parse (parser);
+    if (token.class != TOKEN_EOL
+      && token.class != TOKEN_EOF)
+      parser->priv->errors->set_code
+        (parser->priv->errors, E_UNEXPECTED_PARAMETER, parser->priv->current_line,0,
+        parser->priv->last_label);
   }
   if (program_line->statement)
-    this->priv->last_label = program_line->label;
+    parser->priv->last_label = program_line->label;
 
   /* return the program line */
   return program_line;
 }
 
+/*
+ * Check whether an expression is a constant line label
+ * params:
+ *   ExpressionNode*   expression   the label expression
+ *   int*              label        the constant label, if found
+ * returns:
+ *   int                            !0 if the expression is constant
+ */
+static int constant_label (ExpressionNode *expression, int *label) {
+
+  /* local variables */
+  FactorNode *factor; /* the only factor of a constant expression */
+
+  /* a constant is a lone number */
+  if (expression->next || expression->term->next)
+    return 0;
+  factor = expression->term->factor;
+  if (factor->class != FACTOR_VALUE)
+    return 0;
+  *label = factor->sign == SIGN_NEGATIVE
+    ? -factor->data.value
+    : factor->data.value;
+  return 1;
+}
+
+/*
+ * Resolve the target of a GOTO or GOSUB with a constant label
+ * params:
+ *   Parser*             parser       the parser
+ *   ExpressionNode*     expression   the label expression
+ *   ProgramLineNode**   target       the line to jump to
+ *   LabelIndex*         index        finds the lines by their labels
+ *   ProgramLineNode**   lines        the program lines in order
+ *   int                 label        label of the line doing the jumping
+ */
+static void link_target (Parser *parser, ExpressionNode *expression,
+  ProgramLineNode **target, LabelIndex *index, ProgramLineNode **lines,
+  int label) {
+
+  /* local variables */
+  int
+    jump_label, /* the constant label to jump to */
+    line; /* position of the target line */
+
+  /* computed labels are left to the interpreter */
+  if (! constant_label (expression, &jump_label))
+    return;
+
+  /* look up the target, reporting it now if it doesn't exist */
+  if ((line = label_index_find (index, jump_label)) >= 0)
+    *target = lines[line];
+  else
+    parser->priv->errors->set_code
+      (parser->priv->errors, E_INVALID_LINE_NUMBER, 0, 0, label);
+}
 
 /*
- * Public Methods
+ * Resolve the constant GOTO and GOSUB targets in a statement
+ * params:
+ *   Parser*             parser      the parser
+ *   StatementNode*      statement   the statement to link
+ *   LabelIndex*         index       finds the lines by their labels
+ *   ProgramLineNode**   lines       the program lines in order
+ *   int                 label       label of the line being linked
  */
+static void link_statement (Parser *parser, StatementNode *statement,
+  LabelIndex *index, ProgramLineNode **lines, int label) {
+  if (! statement)
+    return;
+  switch (statement->class) {
+    case STATEMENT_IF:
+      link_statement (parser, statement->statement.ifn->statement, index, lines,
+        label);
+      break;
+    case STATEMENT_GOTO:
+      link_target (parser, statement->statement.goton->label,
+        &statement->statement.goton->target, index, lines, label);
+      break;
+    case STATEMENT_GOSUB:
+      link_target (parser, statement->statement.gosubn->label,
+        &statement->statement.gosubn->target, index, lines, label);
+      break;
+    default:
+      break;
+  }
+}
+
+/*
+ * Resolve the constant GOTO and GOSUB targets in a program
+ * params:
+ *   Parser*        parser    the parser
+ *   ProgramNode*   program   the parsed program
+ */
+static void link_program (Parser *parser, ProgramNode *program) {
+
+  /* local variables */
+  ProgramLineNode
+    *program_line, /* a line of the program */
+    **lines; /* the program lines in order */
+  LabelIndex *index; /* finds the lines by their labels */
+  int
+    *labels, /* the label of each line */
+    count = 0; /* number of lines */
+
+  /* gather the lines and their labels */
+  for (program_line = program->first; program_line;
+    program_line = program_line->next)
+    ++count;
+  lines = malloc ((count + 1) * sizeof (ProgramLineNode *));
+  labels = malloc ((count + 1) * sizeof (int));
+  index = NULL;
+  if (lines && labels) {
+    count = 0;
+    for (program_line = program->first; program_line;
+      program_line = program_line->next) {
+      lines[count] = program_line;
+      labels[count++] = program_line->label;
+    }
+    index = label_index_create (labels, count,
+      parser->priv->options->get_line_numbers (parser->priv->options)
+      == LINE_NUMBERS_OPTIONAL);
+  }
+
+  /* link each line in turn, stopping at the first error */
+  if (index)
+    for (program_line = program->first;
+      program_line && ! parser->priv->errors->get_code (parser->priv->errors);
+      program_line = program_line->next)
+      link_statement (parser, program_line->statement, index, lines,
+        program_line->label);
+  else
+    parser->priv->errors->set_code (parser->priv->errors, E_MEMORY, 0, 0, 0);
+
+  /* tidy up */
+  label_index_destroy (index);
+  free (labels);
+  free (lines);
+}
 
 
 /*
- * Parse the whole program
+ * Parse the program's lines, without resolving their line labels
  * params:
- *   Parser*   parser   The parser to use
+ *   Parser*   parser   the parser
  * returns:
- *   ProgramNode*       The parsed program
+ *   ProgramNode*       the lines parsed, or NULL if memory ran out
  */
-static ProgramNode *parse (Parser *parser) {
+static ProgramNode *parse_lines (Parser *parser) {
 
   /* local varables */
   ProgramNode *program; /* the stored program */
@@ -998,18 +1118,21 @@ static ProgramNode *parse (Parser *parser) {
     *previous = NULL, /* the previous line */
     *current; /* the current line */
 
-  /* initialise the program */
-  this = parser;
-  program = malloc (sizeof (ProgramNode));
-  if(program!=NULL)
-    program->first = NULL;
+  /* initialise the program in an arena of its own */
+  if (! (parser->priv->arena = arena_create ())
+    || ! (program = program_create (parser->priv->arena))) {
+    arena_destroy (parser->priv->arena);
+    parser->priv->arena = NULL;
+    parser->priv->errors->set_code (parser->priv->errors, E_MEMORY, 0, 0, 0);
+    return NULL;
+  }
 
   /* read lines until reaching an error or end of input */
-  while ((current = parse_program_line ())
-    && ! this->priv->errors->get_code (this->priv->errors)) {
+  while ((current = parse_program_line (parser))
+    && ! parser->priv->errors->get_code (parser->priv->errors)) {
     if (previous)
       previous->next = current;
-    else if(program!=NULL)
+    else
       program->first = current;
     previous = current;
   }
@@ -1018,6 +1141,201 @@ static ProgramNode *parse (Parser *parser) {
   return program;
 }
 
+#ifdef USE_THREADS
+/*
+ * Worker thread: parse the lines of one chunk
+ * params:
+ *   void*   arg   the chunk
+ * returns:
+ *   void*         NULL
+ */
+static void *parse_chunk (void *arg) {
+  ParseChunk *chunk = arg; /* the chunk */
+  chunk->program = parse_lines (chunk->parser);
+  return NULL;
+}
+
+/*
+ * Join the lines of a parsed chunk onto the program so far
+ * params:
+ *   Parser*            parser     the parser for the whole program
+ *   ProgramNode*       program    the program so far
+ *   ProgramLineNode**  last       the last line so far, updated
+ *   ParseChunk*        chunk      the chunk to join
+ * returns:
+ *   int                           !0 if joined, 0 if its labels don't follow
+ */
+static int join_chunk (Parser *parser, ProgramNode *program,
+  ProgramLineNode **last, ParseChunk *chunk) {
+
+  /* local variables */
+  ParserData *data = chunk->parser->priv; /* the chunk parser's data */
+  LineNumberOption line_numbers; /* the line number option */
+  ProgramLineNode *line; /* a line of the chunk */
+  int base = parser->priv->last_label; /* the last label before the chunk */
+
+  /* labels implied before the chunk's first own label count on from base */
+  line_numbers = parser->priv->options->get_line_numbers
+    (parser->priv->options);
+  if (line_numbers == LINE_NUMBERS_IMPLIED)
+    for (line = chunk->program->first; line && line != data->first_labelled;
+      line = line->next)
+      if ((line->label += base)
+        > parser->priv->options->get_line_limit (parser->priv->options))
+        return 0;
+
+  /* the chunk's first own label must follow the lines before it */
+  if (line_numbers != LINE_NUMBERS_OPTIONAL && data->first_labelled
+    && data->first_labelled->label <= base + data->lead_label)
+    return 0;
+
+  /* join the lines and carry the last label on to the next chunk */
+  if (*last)
+    (*last)->next = chunk->program->first;
+  else
+    program->first = chunk->program->first;
+  for (line = chunk->program->first; line; line = line->next)
+    *last = line;
+  parser->priv->last_label = data->first_labelled
+    ? data->last_label
+    : base + data->last_label;
+  return 1;
+}
+
+/*
+ * Parse a large program by splitting it into line-aligned chunks that are
+ * parsed on threads of their own, then joined together
+ * params:
+ *   Parser*   parser   the parser
+ * returns:
+ *   ProgramNode*       the parsed program, or NULL to parse line by line
+ */
+static ProgramNode *parse_in_chunks (Parser *parser) {
+
+  /* local variables */
+  ProgramNode *program = NULL; /* the joined program */
+  ProgramLineNode *last = NULL; /* the last line joined */
+  ParseChunk *chunks; /* the chunks */
+  const TCHAR *text; /* the text of the program */
+  int
+    length, /* characters in the text */
+    jobs = parser->priv->jobs, /* threads to use */
+    count, /* number of chunks */
+    chunk, /* counter for chunks */
+    start, /* where a chunk starts in the text */
+    end, /* where it ends */
+    ok = 1; /* cleared if the program must be parsed line by line */
+
+  /* only split programs big enough to give each thread a fair share */
+  text = parser->priv->stream->get_text (parser->priv->stream, &length);
+  if (jobs <= 0)
+    jobs = (int) sysconf (_SC_NPROCESSORS_ONLN);
+  if ((count = length / CHUNK_MINIMUM) > jobs)
+    count = jobs;
+  if (count < 2 || ! (chunks = calloc (count, sizeof (ParseChunk))))
+    return NULL;
+
+  /* start a parser on each chunk, ending each after a line break */
+  for (chunk = start = 0; chunk < count && ok; ++chunk, start = end) {
+    end = (int) ((long long) length * (chunk + 1) / count);
+    if (end < start)
+      end = start;
+    while (end < length && end > 0 && text[end - 1] != _T('\n'))
+      ++end;
+    if (! (chunks[chunk].errors = new_ErrorHandler ())
+      || ! (chunks[chunk].parser = new_BufferParser (chunks[chunk].errors,
+        parser->priv->options, text + start, end - start)))
+      ok = 0;
+    else
+      chunks[chunk].started = ! pthread_create (&chunks[chunk].thread, NULL,
+        parse_chunk, &chunks[chunk]);
+  }
+
+  /* parse the chunks that didn't get a thread here, then wait for the rest */
+  for (chunk = 0; chunk < count; ++chunk)
+    if (chunks[chunk].started)
+      pthread_join (chunks[chunk].thread, NULL);
+    else if (ok)
+      parse_chunk (&chunks[chunk]);
+
+  /* join the chunks into one program, giving up at any parse error */
+  for (chunk = 0; chunk < count && ok; ++chunk)
+    ok = chunks[chunk].program
+      && ! chunks[chunk].errors->get_code (chunks[chunk].errors);
+  if (ok && (parser->priv->arena = arena_create ())
+    && (program = program_create (parser->priv->arena))) {
+    parser->priv->last_label = 0;
+    for (chunk = 0; chunk < count && ok; ++chunk)
+      ok = join_chunk (parser, program, &last, &chunks[chunk]);
+  }
+
+  /* hand the chunks' memory to the program, or discard it all */
+  if (program && ok)
+    for (chunk = 0; chunk < count; ++chunk) {
+      arena_adopt (parser->priv->arena, chunks[chunk].program->arena);
+      chunks[chunk].program = NULL;
+    }
+  else if (parser->priv->arena) {
+    arena_destroy (parser->priv->arena);
+    parser->priv->arena = NULL;
+    program = NULL;
+    parser->priv->last_label = 0;
+  }
+  for (chunk = 0; chunk < count; ++chunk) {
+    program_destroy (chunks[chunk].program);
+    if (chunks[chunk].parser)
+      chunks[chunk].parser->destroy (chunks[chunk].parser);
+    if (chunks[chunk].errors)
+      chunks[chunk].errors->destroy (chunks[chunk].errors);
+  }
+  free (chunks);
+  return program;
+}
+#endif
+
+
+/*
+ * Public Methods
+ */
+
+
+/*
+ * Parse the whole program
+ * params:
+ *   Parser*   parser   The parser to use
+ * returns:
+ *   ProgramNode*       The parsed program
+ */
+static ProgramNode *parse (Parser *parser) {
+
+  /* local varables */
+  ProgramNode *program = NULL; /* the stored program */
+
+  /* parse a large program in chunks if possible, otherwise line by line */
+#ifdef USE_THREADS
+  program = parse_in_chunks (parser);
+#endif
+  if (! program)
+    program = parse_lines (parser);
+
+  /* resolve the constant line labels */
+  if (program && ! parser->priv->errors->get_code (parser->priv->errors))
+    link_program (parser, program);
+
+  /* return the program */
+  return program;
+}
+
+/*
+ * Set the number of threads used to parse a large program
+ * params:
+ *   Parser*   parser   the parser
+ *   int       jobs     the number of threads, 0 for one per CPU
+ */
+static void set_jobs (Parser *parser, int jobs) {
+  parser->priv->jobs = jobs;
+}
+
 /*
  * Return the current source line we're parsing
  * params:
@@ -1074,60 +1392,76 @@ void destroy (Parser *parser) {
 Parser *new_Parser (ErrorHandler *errors, LanguageOptions *options,
   FILE *input) {
 
+  /* local variables */
+  Parser *parser; /* the new parser */
+
   /* allocate memory */
-  this = malloc (sizeof (Parser));
-  if (this == NULL) return NULL;
-  this->priv = malloc (sizeof (ParserData));
-  if (this->priv == NULL) {
-      free(this);
+  parser = malloc (sizeof (Parser));
+  if (parser == NULL) return NULL;
+  parser->priv = malloc (sizeof (ParserData));
+  if (parser->priv == NULL) {
+      free(parser);
       return NULL;
   }
-  this->priv->stream = new_TokenStream (input);
+  parser->priv->stream = new_TokenStream (input);
 
   /* initialise methods */
-  this->parse = parse;
-  this->get_line = get_line;
-  this->get_label = get_label;
-  this->destroy = destroy;
+  parser->parse = parse;
+  parser->get_line = get_line;
+  parser->get_label = get_label;
+  parser->set_jobs = set_jobs;
+  parser->destroy = destroy;
 
   /* initialise properties */
-  this->priv->last_label = 0;
-  this->priv->current_line = 0;
-  this->priv->end_of_file = 0;
-  this->priv->stored_token = NULL;
-  this->priv->errors = errors;
-  this->priv->options = options;
+  parser->priv->last_label = 0;
+  parser->priv->current_line = 0;
+  parser->priv->end_of_file = 0;
+  parser->priv->stored_token.class = TOKEN_NONE;
+  parser->priv->errors = errors;
+  parser->priv->options = options;
+  parser->priv->arena = NULL;
+  parser->priv->jobs = 1;
+  parser->priv->first_labelled = NULL;
+  parser->priv->lead_label = 0;
 
   /* return the new object */
-  return this;
+  return parser;
 }
 
 Parser* new_BufferParser(ErrorHandler* errors, LanguageOptions* options, const TCHAR* line, int length) {
 
+    /* local variables */
+    Parser *parser; /* the new parser */
+
     /* allocate memory */
-    this = malloc(sizeof(Parser));
-    if (this == NULL) return NULL;
-    this->priv = malloc(sizeof(ParserData));
-    if (this->priv == NULL) {
-        free(this);
+    parser = malloc(sizeof(Parser));
+    if (parser == NULL) return NULL;
+    parser->priv = malloc(sizeof(ParserData));
+    if (parser->priv == NULL) {
+        free(parser);
         return NULL;
     }
-    this->priv->stream =  new_BufferTokenStream(line,length);
+    parser->priv->stream =  new_BufferTokenStream(line,length);
 
     /* initialise methods */
-    this->parse = parse;
-    this->get_line = get_line;
-    this->get_label = get_label;
-    this->destroy = destroy;
+    parser->parse = parse;
+    parser->get_line = get_line;
+    parser->get_label = get_label;
+    parser->set_jobs = set_jobs;
+    parser->destroy = destroy;
 
     /* initialise properties */
-    this->priv->last_label = 0;
-    this->priv->current_line = 0;
-    this->priv->end_of_file = 0;
-    this->priv->stored_token = NULL;
-    this->priv->errors = errors;
-    this->priv->options = options;
+    parser->priv->last_label = 0;
+    parser->priv->current_line = 0;
+    parser->priv->end_of_file = 0;
+    parser->priv->stored_token.class = TOKEN_NONE;
+    parser->priv->errors = errors;
+    parser->priv->options = options;
+    parser->priv->arena = NULL;
+    parser->priv->jobs = 1;
+    parser->priv->first_labelled = NULL;
+    parser->priv->lead_label = 0;
 
     /* return the new object */
-    return this;
+    return parser;
 }
\ No newline at end of file
@@ -0,0 +1,508 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Execution Profile Module
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+/* included headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define USE_RDTSC
+#endif
+#include "common.h"
+#include "statement.h"
+#include "profile.h"
+
+
+/*
+ * Internal Data
+ */
+
+
+/* the name of the bottom frame of every stack */
+#define PROFILE_ROOT _T("main")
+
+/* the number of slots a new table of stack times starts with */
+#define STACKS_MINIMUM 256
+
+
+/*
+ * Level 2 Functions
+ */
+
+
+/*
+ * Read the system's monotonic clock
+ * returns:
+ *   unsigned long long   a time in nanoseconds from some fixed point
+ */
+static unsigned long long read_time (void) {
+#ifdef _WIN32
+  static LARGE_INTEGER frequency; /* ticks per second */
+  LARGE_INTEGER ticks; /* ticks so far */
+  if (! frequency.QuadPart)
+    QueryPerformanceFrequency (&frequency);
+  QueryPerformanceCounter (&ticks);
+  return (unsigned long long) (ticks.QuadPart / frequency.QuadPart) * 1000000000
+    + (unsigned long long) (ticks.QuadPart % frequency.QuadPart) * 1000000000
+    / frequency.QuadPart;
+#else
+  struct timespec now; /* the time now */
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (unsigned long long) now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+
+/*
+ * Compare two lines by address, for sorting and searching
+ * params:
+ *   const void*   a   the first line
+ *   const void*   b   the second line
+ * returns:
+ *   int               <0, 0 or >0 as a is before, at or after b
+ */
+static int compare_addresses (const void *a, const void *b) {
+  const ProfileIndex
+    *left = a, /* the first line */
+    *right = b; /* the second line */
+  if (left->line == right->line)
+    return 0;
+  return (uintptr_t) left->line < (uintptr_t) right->line ? -1 : 1;
+}
+
+/*
+ * Compare two lines by the time they took, for the report
+ * params:
+ *   const void*   a   the first line's measurements
+ *   const void*   b   the second line's measurements
+ * returns:
+ *   int               <0 if a should be reported before b, >0 if after
+ */
+static int compare_times (const void *a, const void *b) {
+  const ProfileLine
+    *left = *(ProfileLine *const *) a, /* the first line */
+    *right = *(ProfileLine *const *) b; /* the second line */
+  if (left->time != right->time)
+    return left->time > right->time ? -1 : 1;
+  if (left->count != right->count)
+    return left->count > right->count ? -1 : 1;
+  return left->position - right->position;
+}
+
+
+/*
+ * Level 1 Functions
+ */
+
+
+/*
+ * Find the position of a line in the program
+ * params:
+ *   Profile*           profile   the profile
+ *   ProgramLineNode*   line      the line to find
+ * returns:
+ *   int                          the position of the line, -1 if not found
+ */
+static int find_position (Profile *profile, ProgramLineNode *line) {
+
+  /* local variables */
+  ProfileIndex
+    key, /* the line to search for */
+    *found; /* the line found */
+  int position; /* position of the line */
+
+  /* most lines follow the one before, so try that before searching */
+  position = profile->last + 1;
+  if (position < profile->line_count && profile->lines[position].line == line)
+    return position;
+  key.line = line;
+  found = bsearch (&key, profile->index, profile->line_count,
+    sizeof (ProfileIndex), compare_addresses);
+  return found ? found->position : -1;
+}
+
+/*
+ * Add time spent on a line under the current chain of GOSUBs
+ * params:
+ *   Profile*             profile    the profile
+ *   int                  position   position of the line
+ *   unsigned long long   time       clock ticks it took
+ */
+static void add_stack_time (Profile *profile, int position,
+  unsigned long long time) {
+
+  /* local variables */
+  ProfileStack
+    *stacks, /* a larger table, when the table fills up */
+    *slot; /* the slot for the line and frame */
+  int
+    size, /* size of a larger table */
+    place, /* a slot number in the larger table */
+    index; /* a slot number */
+
+  /* keep the table no more than half full, so that searches are short */
+  if (2 * (profile->stack_count + 1) > profile->stack_size) {
+    size = profile->stack_size ? 2 * profile->stack_size : STACKS_MINIMUM;
+    if (! (stacks = malloc (size * sizeof (ProfileStack)))) {
+      profile->failed = 1;
+      return;
+    }
+    for (index = 0; index < size; ++index)
+      stacks[index].frame = -1;
+    for (index = 0; index < profile->stack_size; ++index)
+      if ((slot = &profile->stacks[index])->frame >= 0) {
+        place = ((unsigned) slot->frame * 2654435761u
+          ^ (unsigned) slot->position * 40503u) & (size - 1);
+        while (stacks[place].frame >= 0)
+          place = (place + 1) & (size - 1);
+        stacks[place] = *slot;
+      }
+    free (profile->stacks);
+    profile->stacks = stacks;
+    profile->stack_size = size;
+  }
+
+  /* find the slot for this line and frame, or take an empty one */
+  index = ((unsigned) profile->frame * 2654435761u
+    ^ (unsigned) position * 40503u) & (profile->stack_size - 1);
+  while ((slot = &profile->stacks[index])->frame >= 0
+    && (slot->frame != profile->frame || slot->position != position))
+    index = (index + 1) & (profile->stack_size - 1);
+  if (slot->frame < 0) {
+    slot->frame = profile->frame;
+    slot->position = position;
+    slot->time = 0;
+    ++profile->stack_count;
+  }
+  slot->time += time;
+}
+
+/*
+ * Work out how long a clock tick is from the time the profile has run
+ * params:
+ *   Profile*   profile   the profile
+ * returns:
+ *   double               milliseconds per clock tick
+ */
+static double tick_length (Profile *profile) {
+#ifdef USE_RDTSC
+  unsigned long long ticks; /* clock ticks since the profile began */
+  ticks = profile_clock () - profile->start_ticks;
+  return ticks ? (read_time () - profile->start_time) / 1e6 / ticks : 0.0;
+#else
+  return 1e-6;
+#endif
+}
+
+/*
+ * Write the name of a line as a stack frame
+ * params:
+ *   FILE*      output     the file to write to
+ *   Profile*   profile    the profile
+ *   int        position   position of the line
+ */
+static void write_frame (FILE *output, Profile *profile, int position) {
+  if (profile->lines[position].line->label)
+    fprintf (output, _T("%d"), profile->lines[position].line->label);
+  else
+    fprintf (output, _T("#%d"), position + 1);
+}
+
+
+/*
+ * Public Functions
+ */
+
+
+/*
+ * Profile constructor
+ * params:
+ *   ProgramNode*   program   the program to be profiled
+ *   int            stacks    !0 to keep times by chain of GOSUBs as well
+ * returns:
+ *   Profile*                 the new profile, NULL if memory ran out
+ */
+Profile *profile_create (ProgramNode *program, int stacks) {
+
+  /* local variables */
+  Profile *profile; /* the profile to create */
+  ProgramLineNode *program_line; /* a line of the program */
+  int line; /* position of a line */
+
+  /* allocate the profile, with room for every line */
+  if (! (profile = malloc (sizeof (Profile))))
+    return NULL;
+  profile->line_count = 0;
+  profile->last = -1;
+  profile->frames = NULL;
+  profile->frame_count = profile->frame_size = 0;
+  profile->frame = profile->next_frame = 0;
+  profile->stacks = NULL;
+  profile->stack_count = profile->stack_size = 0;
+  profile->failed = 0;
+  for (program_line = program->first; program_line;
+    program_line = program_line->next)
+    ++profile->line_count;
+  profile->lines = malloc ((profile->line_count + 1) * sizeof (ProfileLine));
+  profile->index = malloc ((profile->line_count + 1) * sizeof (ProfileIndex));
+  if (stacks && (profile->frames = malloc (sizeof (ProfileFrame)))) {
+    profile->frames->parent = profile->frames->child
+      = profile->frames->sibling = profile->frames->entry = -1;
+    profile->frame_count = profile->frame_size = 1;
+  }
+  if (! profile->lines || ! profile->index || (stacks && ! profile->frames)) {
+    profile_destroy (profile);
+    return NULL;
+  }
+
+  /* start every line at zero, and index the lines by address */
+  for (line = 0, program_line = program->first; program_line;
+    ++line, program_line = program_line->next) {
+    profile->lines[line].line = profile->index[line].line = program_line;
+    profile->lines[line].position = profile->index[line].position = line;
+    profile->lines[line].count = profile->lines[line].time = 0;
+  }
+  qsort (profile->index, profile->line_count, sizeof (ProfileIndex),
+    compare_addresses);
+
+  /* note the time, so that clock ticks can be turned into time later */
+  profile->start_time = read_time ();
+  profile->start_ticks = profile_clock ();
+
+  /* return the new profile */
+  return profile;
+}
+
+/*
+ * Read the clock used to time lines, the processor's time stamp counter
+ * where there is one
+ * returns:
+ *   unsigned long long   ticks from some fixed point
+ */
+unsigned long long profile_clock (void) {
+#ifdef USE_RDTSC
+  return __rdtsc ();
+#else
+  return read_time ();
+#endif
+}
+
+/*
+ * Count one run of a line
+ * params:
+ *   Profile*             profile   the profile
+ *   ProgramLineNode*     line      the line that ran
+ *   unsigned long long   time      clock ticks it took
+ */
+void profile_count (Profile *profile, ProgramLineNode *line,
+  unsigned long long time) {
+
+  /* local variables */
+  int position; /* position of the line */
+
+  /* add the run to the line's totals */
+  if ((position = find_position (profile, line)) < 0)
+    return;
+  ++profile->lines[position].count;
+  profile->lines[position].time += time;
+  profile->last = position;
+
+  /* add it to the time for the chain of GOSUBs, then follow any call */
+  if (profile->frames) {
+    if (! profile->failed)
+      add_stack_time (profile, position, time);
+    profile->frame = profile->next_frame;
+  }
+}
+
+/*
+ * Note a GOSUB made by the line being run
+ * params:
+ *   Profile*           profile   the profile
+ *   ProgramLineNode*   line      the first line of the subroutine
+ */
+void profile_call (Profile *profile, ProgramLineNode *line) {
+
+  /* local variables */
+  ProfileFrame *frames; /* the call tree, when it has to grow */
+  int
+    position, /* position of the subroutine */
+    child; /* the frame for the call */
+
+  /* find the subroutine */
+  if (! profile->frames || profile->failed
+    || (position = find_position (profile, line)) < 0)
+    return;
+
+  /* find the frame for the call, adding one if it hasn't been made before */
+  for (child = profile->frames[profile->frame].child;
+    child >= 0 && profile->frames[child].entry != position;
+    child = profile->frames[child].sibling);
+  if (child < 0) {
+    if (profile->frame_count == profile->frame_size) {
+      if (! (frames = realloc (profile->frames,
+        2 * profile->frame_size * sizeof (ProfileFrame)))) {
+        profile->failed = 1;
+        return;
+      }
+      profile->frames = frames;
+      profile->frame_size *= 2;
+    }
+    child = profile->frame_count++;
+    profile->frames[child].parent = profile->frame;
+    profile->frames[child].entry = position;
+    profile->frames[child].child = -1;
+    profile->frames[child].sibling = profile->frames[profile->frame].child;
+    profile->frames[profile->frame].child = child;
+  }
+
+  /* the subroutine runs in that frame */
+  profile->next_frame = child;
+}
+
+/*
+ * Note a RETURN made by the line being run
+ * params:
+ *   Profile*   profile   the profile
+ */
+void profile_return (Profile *profile) {
+  if (profile->frames && profile->frames[profile->frame].parent >= 0)
+    profile->next_frame = profile->frames[profile->frame].parent;
+}
+
+/*
+ * Write a report of the lines that ran, the longest-running first
+ * params:
+ *   Profile*       profile    the profile
+ *   const TCHAR*   filename   the file to write
+ * returns:
+ *   int                       !0 on success, 0 if the file couldn't be written
+ */
+int profile_write (Profile *profile, const TCHAR *filename) {
+
+  /* local variables */
+  FILE *output; /* the report file */
+  ProfileLine **ran; /* the lines that ran, in report order */
+  unsigned long long
+    count = 0, /* total runs of every line */
+    time = 0; /* total clock ticks for every line */
+  double scale; /* milliseconds per clock tick */
+  int
+    line, /* position of a line */
+    ran_count = 0, /* number of lines that ran */
+    written; /* set if the report was written in full */
+
+  /* gather the lines that ran and sort them, the longest-running first */
+  if (! (ran = malloc ((profile->line_count + 1) * sizeof (ProfileLine *))))
+    return 0;
+  for (line = 0; line < profile->line_count; ++line)
+    if (profile->lines[line].count) {
+      ran[ran_count++] = &profile->lines[line];
+      count += profile->lines[line].count;
+      time += profile->lines[line].time;
+    }
+  qsort (ran, ran_count, sizeof (ProfileLine *), compare_times);
+  scale = tick_length (profile);
+
+  /* write the report */
+  if (! (output = fopen (filename, _T("w")))) {
+    free (ran);
+    return 0;
+  }
+  fprintf (output, PROFILE_HEADER);
+  for (line = 0; line < ran_count; ++line)
+    fprintf (output, PROFILE_LINE, ran[line]->line->label,
+      ran[line]->position + 1, ran[line]->count, ran[line]->time * scale,
+      time ? 100.0 * ran[line]->time / time : 0.0);
+  fprintf (output, PROFILE_TOTAL, count, time * scale);
+  written = ! ferror (output);
+  written = ! fclose (output) && written;
+
+  /* tidy up */
+  free (ran);
+  return written;
+}
+
+/*
+ * Write the time spent on each line under each chain of GOSUBs, in the
+ * collapsed stack format read by flame graph tools
+ * params:
+ *   Profile*       profile    the profile, which must have kept stacks
+ *   const TCHAR*   filename   the file to write
+ * returns:
+ *   int                       !0 on success, 0 if the file couldn't be written
+ */
+int profile_write_stacks (Profile *profile, const TCHAR *filename) {
+
+  /* local variables */
+  FILE *output; /* the stacks file */
+  ProfileStack *slot; /* a slot of the table of stack times */
+  int
+    *path, /* the subroutines called on the way to a line */
+    depth, /* number of subroutines on the path */
+    frame, /* a frame on the path */
+    written; /* set if the stacks were written in full */
+  double scale; /* nanoseconds per clock tick */
+  unsigned long long time; /* the time for a line and frame */
+
+  /* make sure there is a complete record to write */
+  if (! profile->frames || profile->failed
+    || ! (path = malloc (profile->frame_count * sizeof (int))))
+    return 0;
+  if (! (output = fopen (filename, _T("w")))) {
+    free (path);
+    return 0;
+  }
+
+  /* write a line of frames and the time in nanoseconds for each entry */
+  scale = tick_length (profile) * 1e6;
+  for (slot = profile->stacks; slot < profile->stacks + profile->stack_size;
+    ++slot)
+    if (slot->frame >= 0 && (time = slot->time * scale + 0.5)) {
+      depth = 0;
+      for (frame = slot->frame; profile->frames[frame].parent >= 0;
+        frame = profile->frames[frame].parent)
+        path[depth++] = profile->frames[frame].entry;
+      fprintf (output, PROFILE_ROOT);
+      while (depth--) {
+        fputc (_T(';'), output);
+        write_frame (output, profile, path[depth]);
+      }
+      fputc (_T(';'), output);
+      write_frame (output, profile, slot->position);
+      fprintf (output, _T(" %llu\n"), time);
+    }
+  written = ! ferror (output);
+  written = ! fclose (output) && written;
+
+  /* tidy up */
+  free (path);
+  return written;
+}
+
+/*
+ * Profile destructor
+ * params:
+ *   Profile*   profile   the doomed profile
+ */
+void profile_destroy (Profile *profile) {
+  if (profile) {
+    free (profile->lines);
+    free (profile->index);
+    free (profile->frames);
+    free (profile->stacks);
+    free (profile);
+  }
+}
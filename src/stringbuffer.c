@@ -0,0 +1,100 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * String Buffer Module
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ */
+
+
+/* included headers */
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "stringbuffer.h"
+
+
+/*
+ * Internal Data
+ */
+
+
+/* the number of characters a new buffer has room for */
+#define BUFFER_MINIMUM 256
+
+
+/*
+ * Public Functions
+ */
+
+
+/*
+ * Start a string buffer off empty
+ * params:
+ *   StringBuffer*   buffer   the buffer
+ * returns:
+ *   int                      !0 on success, 0 if memory ran out
+ */
+int string_buffer_init (StringBuffer *buffer) {
+  buffer->length = 0;
+  buffer->size = BUFFER_MINIMUM;
+  if (! (buffer->text = malloc (buffer->size * sizeof (TCHAR))))
+    return 0;
+  *buffer->text = _T('\0');
+  return 1;
+}
+
+/*
+ * Append text to a string buffer, doubling its room whenever it fills
+ * params:
+ *   StringBuffer*   buffer   the buffer
+ *   const TCHAR*    text     the text to append
+ */
+void string_buffer_append (StringBuffer *buffer, const TCHAR *text) {
+
+  /* local variables */
+  size_t
+    length, /* length of the text to append */
+    size; /* the room needed */
+  TCHAR *grown; /* the text moved to a larger block */
+
+  /* nothing more can be added once memory has run out */
+  if (! buffer->text || ! text)
+    return;
+
+  /* make room for the text and its terminator */
+  length = strlen (text);
+  if (buffer->length + length >= buffer->size) {
+    for (size = buffer->size; buffer->length + length >= size; size *= 2);
+    if (! (grown = realloc (buffer->text, size * sizeof (TCHAR)))) {
+      free (buffer->text);
+      buffer->text = NULL;
+      return;
+    }
+    buffer->text = grown;
+    buffer->size = size;
+  }
+
+  /* copy it in after the text so far */
+  memcpy (buffer->text + buffer->length, text, (length + 1) * sizeof (TCHAR));
+  buffer->length += length;
+}
+
+/*
+ * Take the text from a string buffer, leaving the buffer empty
+ * params:
+ *   StringBuffer*   buffer   the buffer
+ * returns:
+ *   TCHAR*                   the text, for the caller to free; NULL if
+ *                            memory ran out while building it
+ */
+TCHAR *string_buffer_release (StringBuffer *buffer) {
+
+  /* local variables */
+  TCHAR *text = buffer->text; /* the text to hand over */
+
+  /* the buffer is left with nothing to free */
+  buffer->text = NULL;
+  buffer->length = buffer->size = 0;
+  return text;
+}
@@ -11,7 +11,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <locale.h>
+#include <sys/stat.h>
 #include "common.h"
 #include "options.h"
 #include "errors.h"
@@ -20,6 +22,10 @@
 #include "interpret.h"
 #include "formatter.h"
 #include "generatec.h"
+#include "bytecode.h"
+#include "optimiser.h"
+#include "batch.h"
+#include "profile.h"
 
 
 #define TINY_BASIC_TARGET		  _T("$(TARGET)")
@@ -31,8 +37,14 @@ static enum { /* action to take with parsed program */
 	OUTPUT_INTERPRET, /* interpret the program */
 	OUTPUT_LST, /* output a formatted listing */
 	OUTPUT_C, /* output a C program */
+	OUTPUT_BC, /* output a bytecode cache */
 	OUTPUT_EXE /* output an executable */
 } output = OUTPUT_INTERPRET;
+static int statistics = 0; /* set to report run statistics */
+static int profiling = 0; /* set to write a profile of the run */
+static int flame_graph = 0; /* set to write the run's GOSUB stacks */
+static int batch_mode = 0; /* set to run every program named as a batch */
+static int jobs = 0; /* threads for a batch or a large parse, 0 for one per CPU */
 
 
 /*
@@ -93,6 +105,8 @@ static void set_output(TCHAR* option, ErrorHandler* errors, LanguageOptions* lop
 		output = OUTPUT_LST;
 	else if (!strcmp(_T("c"), option))
 		output = OUTPUT_C;
+	else if (!strcmp(_T("bc"), option))
+		output = OUTPUT_BC;
 	else if (!strcmp(_T("exe"), option))
 		output = OUTPUT_EXE;
 	else
@@ -112,6 +126,45 @@ static void set_gosub_limit(TCHAR* option, ErrorHandler* errors, LanguageOptions
 		errors->set_code(errors, E_BAD_COMMAND_LINE, 0, 0, 0);
 }
 
+/*
+ * Set the integer width option
+ * params:
+ *   TCHAR*   option   the option supplied on the command line
+ */
+static void set_integer_width(TCHAR* option, ErrorHandler* errors, LanguageOptions* loptions) {
+	int width; /* the width contained in the option */
+	if (sscanf(option, _T("%d"), &width) == 1
+		&& (width == 16 || width == 32 || width == 64)
+		&& width <= 8 * (int)sizeof(intptr_t))
+		loptions->set_integer_width(loptions, width);
+	else
+		errors->set_code(errors, E_BAD_COMMAND_LINE, 0, 0, 0);
+}
+
+/*
+ * Set the number of worker threads for a batch or a large program's parse
+ * params:
+ *   TCHAR*   option   the option supplied on the command line
+ */
+static void set_jobs(TCHAR* option, ErrorHandler* errors, LanguageOptions* loptions) {
+	if (!sscanf(option, _T("%d"), &jobs) || jobs < 0)
+		errors->set_code(errors, E_BAD_COMMAND_LINE, 0, 0, 0);
+}
+
+/*
+ * Set the execution option
+ * params:
+ *   TCHAR*   option   the option supplied on the command line
+ */
+static void set_execution(TCHAR* option, ErrorHandler* errors, LanguageOptions* loptions) {
+	if (!strncmp(TINY_BASIC_BYTECODE, option, strlen(option)))
+		loptions->set_execution(loptions, EXECUTION_BYTECODE);
+	else if (!strncmp(TINY_BASIC_TREE, option, strlen(option)))
+		loptions->set_execution(loptions, EXECUTION_TREE);
+	else
+		errors->set_code(errors, E_BAD_COMMAND_LINE, 0, 0, 0);
+}
+
 
 /*
  * Level 1 Routines
@@ -127,7 +180,9 @@ static void set_gosub_limit(TCHAR* option, ErrorHandler* errors, LanguageOptions
 static void set_options(int argc, TCHAR** argv, ErrorHandler* errors, LanguageOptions* loptions) {
 
 	/* local variables */
-	int argn; /* argument number count */
+	int
+		argn, /* argument number count */
+		extra_files = 0; /* filenames beyond the first */
 
 	/* loop through all parameters */
 	for (argn = 1; argn < argc && !errors->get_code(errors); ++argn) {
@@ -161,6 +216,40 @@ static void set_options(int argc, TCHAR** argv, ErrorHandler* errors, LanguageOp
 			set_gosub_limit(&argv[argn][2], errors, loptions);
 		else if (!strncmp(argv[argn], _T("--gosub-limit="), 14))
 			set_gosub_limit(&argv[argn][14], errors, loptions);
+
+		/* scan for execution engine */
+		else if (!strncmp(argv[argn], _T("-e"), 2))
+			set_execution(&argv[argn][2], errors, loptions);
+		else if (!strncmp(argv[argn], _T("--execution="), 12))
+			set_execution(&argv[argn][12], errors, loptions);
+
+		/* scan for integer width */
+		else if (!strncmp(argv[argn], _T("-w"), 2))
+			set_integer_width(&argv[argn][2], errors, loptions);
+		else if (!strncmp(argv[argn], _T("--integer-width="), 16))
+			set_integer_width(&argv[argn][16], errors, loptions);
+
+		/* scan for statistics option */
+		else if (!strcmp(argv[argn], _T("-s"))
+			|| !strcmp(argv[argn], _T("--statistics")))
+			statistics = 1;
+
+		/* scan for profile options */
+		else if (!strcmp(argv[argn], _T("-p"))
+			|| !strcmp(argv[argn], _T("--profile")))
+			profiling = 1;
+		else if (!strcmp(argv[argn], _T("-f"))
+			|| !strcmp(argv[argn], _T("--flame-graph")))
+			flame_graph = 1;
+
+		/* scan for batch options */
+		else if (!strcmp(argv[argn], _T("-b"))
+			|| !strcmp(argv[argn], _T("--batch")))
+			batch_mode = 1;
+		else if (!strncmp(argv[argn], _T("-j"), 2))
+			set_jobs(&argv[argn][2], errors, loptions);
+		else if (!strncmp(argv[argn], _T("--jobs="), 7))
+			set_jobs(&argv[argn][7], errors, loptions);
 		else if (!strncmp(argv[argn], _T("--help"), 6)) {
 
 		}
@@ -168,10 +257,12 @@ static void set_options(int argc, TCHAR** argv, ErrorHandler* errors, LanguageOp
 		else if (!input_filename)
 			input_filename = argv[argn];
 
-		/* raise an error upon illegal option */
+		/* only a batch may name more than one program */
 		else
-			errors->set_code(errors, E_BAD_COMMAND_LINE, 0, 0, 0);
+			++extra_files;
 	}
+	if (extra_files && !batch_mode)
+		errors->set_code(errors, E_BAD_COMMAND_LINE, 0, 0, 0);
 }
 
 /*
@@ -255,6 +346,39 @@ static void output_c(ProgramNode* program, ErrorHandler* errors, LanguageOptions
 	free(output_filename);
 }
 
+/*
+ * Output a bytecode cache, which later runs use instead of the source
+ * params:
+ *   ProgramNode*     program   the parsed program
+ *   BytecodeStamp*   stamp     what the program was built from
+ */
+static void output_bc(ProgramNode* program, BytecodeStamp* stamp, ErrorHandler* errors, LanguageOptions* loptions) {
+
+	/* local variables */
+	TCHAR* output_filename; /* the output filename */
+	Bytecode* bytecode; /* the compiled program */
+
+	/* ascertain the output filename */
+	output_filename = _malloc(strlen(input_filename) + 5);
+	if (output_filename) {
+
+		/* compile the program and write it out */
+		snprintf(output_filename, strlen(input_filename) + 5, _T("%s.tbc"), input_filename);
+		if ((bytecode = bytecode_compile(program, errors))) {
+			if (!bytecode_save(bytecode, output_filename, stamp))
+				errors->set_code(errors, E_FILE_NOT_FOUND, 0, 0, 0);
+			bytecode_destroy(bytecode);
+		}
+
+		/* free the output filename */
+		free(output_filename);
+	}
+
+	/* deal with out of memory error */
+	else
+		errors->set_code(errors, E_MEMORY, 0, 0, 0);
+}
+
 /*
  * Invoke a compiler to turn a C source file into an executable
  * params:
@@ -303,6 +427,147 @@ static void output_exe(TCHAR* command, TCHAR* basic_filename) {
 }
 
 
+/*
+ * Hash the contents of a program file with FNV-1a, leaving it rewound
+ * params:
+ *   FILE*   input   the program file
+ * returns:
+ *   unsigned long long   the hash of the file's bytes
+ */
+static unsigned long long hash_file(FILE* input) {
+
+	/* local variables */
+	unsigned long long hash = 14695981039346656037ULL; /* the hash so far */
+	unsigned char buffer[4096]; /* a block of the file */
+	size_t count, /* bytes in the block */
+		byte; /* index of a byte in the block */
+
+	/* fold in each byte of the file, then go back to its start */
+	while ((count = fread(buffer, 1, sizeof(buffer), input)))
+		for (byte = 0; byte < count; ++byte)
+			hash = (hash ^ buffer[byte]) * 1099511628211ULL;
+	rewind(input);
+	return hash;
+}
+
+/*
+ * Note what a program is built from, so that a cache can be matched to it
+ * params:
+ *   FILE*            input   the program file
+ *   BytecodeStamp*   stamp   receives the details
+ */
+static void get_stamp(FILE* input, BytecodeStamp* stamp, LanguageOptions* loptions) {
+
+	/* local variables */
+	struct stat status; /* the status of the program file */
+
+	/* the file's size, age and contents, and the options that affect the
+	   parse; the contents catch an edit within the same tick of the clock */
+	memset(stamp, 0, sizeof(BytecodeStamp));
+	if (!fstat(fileno(input), &status)) {
+		stamp->source_size = (long long)status.st_size;
+		stamp->source_time = (long long)status.st_mtime * 1000000000;
+#if defined(__APPLE__)
+		stamp->source_time += status.st_mtimespec.tv_nsec;
+#elif defined(__unix__)
+		stamp->source_time += status.st_mtim.tv_nsec;
+#endif
+	}
+	stamp->source_hash = hash_file(input);
+	stamp->line_numbers = loptions->get_line_numbers(loptions);
+	stamp->line_limit = loptions->get_line_limit(loptions);
+	stamp->comments = loptions->get_comments(loptions);
+	stamp->integer_width = loptions->get_integer_width(loptions);
+}
+
+/*
+ * Report the outcome of a run
+ * params:
+ *   Interpreter*   interpreter   the interpreter that ran the program
+ */
+static void report_run(Interpreter* interpreter, ErrorHandler* errors, LanguageOptions* loptions) {
+
+	/* local variables */
+	TCHAR* error_text; /* error text message */
+
+	/* report any runtime error, then the statistics if asked */
+	if (errors->get_code(errors)) {
+		error_text = errors->get_text(errors);
+		printf(TINY_BASIC_RUNTIME_ERROR, error_text);
+		free(error_text);
+	}
+	if (statistics)
+		fprintf(stderr, TINY_BASIC_GOSUB_HIGH_WATER,
+			interpreter->get_gosub_high_water(interpreter),
+			loptions->get_gosub_limit(loptions));
+}
+
+/*
+ * Write a profile of a run alongside the program
+ * params:
+ *   Profile*   profile     the profile of the run
+ *   TCHAR*     extension   the extension to give the profile's file
+ *   int        stacks      !0 for the GOSUB stacks, 0 for the line report
+ */
+static void output_profile(Profile* profile, TCHAR* extension, int stacks, ErrorHandler* errors) {
+
+	/* local variables */
+	TCHAR* output_filename; /* the output filename */
+	int written; /* set if the profile was written */
+
+	/* write the profile, saying so if it can't be written */
+	output_filename = _malloc(strlen(input_filename) + strlen(extension) + 1);
+	if (output_filename) {
+		snprintf(output_filename, strlen(input_filename) + strlen(extension) + 1,
+			_T("%s%s"), input_filename, extension);
+		written = stacks
+			? profile_write_stacks(profile, output_filename)
+			: profile_write(profile, output_filename);
+		if (!written)
+			printf(TINY_BASIC_FILE_ERROR, output_filename);
+		free(output_filename);
+	}
+	else
+		errors->set_code(errors, E_MEMORY, 0, 0, 0);
+}
+
+/*
+ * Run a program from its bytecode cache, if it has an up-to-date one
+ * params:
+ *   BytecodeStamp*   stamp   what the cache must have been built from
+ * returns:
+ *   int                      !0 if the program ran, 0 if it must be parsed
+ */
+static int run_cache(BytecodeStamp* stamp, ErrorHandler* errors, LanguageOptions* loptions) {
+
+	/* local variables */
+	TCHAR* cache_filename; /* the cache filename */
+	Bytecode* bytecode = NULL; /* the cached program */
+	Interpreter* interpreter; /* interpreter object */
+
+	/* load the cache */
+	cache_filename = _malloc(strlen(input_filename) + 5);
+	if (cache_filename) {
+		snprintf(cache_filename, strlen(input_filename) + 5, _T("%s.tbc"), input_filename);
+		bytecode = bytecode_load(cache_filename, stamp);
+		free(cache_filename);
+	}
+	if (!bytecode)
+		return 0;
+
+	/* run it */
+	if ((interpreter = new_Interpreter(errors, loptions))) {
+		interpreter->interpret_compiled(interpreter, bytecode);
+		report_run(interpreter, errors, loptions);
+		interpreter->destroy(interpreter);
+	}
+	else
+		errors->set_code(errors, E_MEMORY, 0, 0, 0);
+	bytecode_destroy(bytecode);
+	return 1;
+}
+
+
 /*
  * Top Level Routines
  */
@@ -341,6 +606,7 @@ static int run(TCHAR* text, int length, LanguageOptions* loptions) {
 		{
 			if (NULL != (program = parser->parse(parser)))
 			{
+				optimise_program(program);
 				if (NULL != (interpreter = new_Interpreter(errors, loptions)))
 				{
 					interpreter->interpret(interpreter, program);
@@ -515,6 +781,45 @@ static int tiny_basic_repl(int line_length, LanguageOptions* loptions) {
 	return 0;
 }
 
+/*
+ * Run every program named on the command line as a batch; an argument
+ * @file names a manifest listing programs and their input files
+ * params:
+ *   int                argc       number of arguments on the command line
+ *   TCHAR**            argv       the arguments
+ *   LanguageOptions*   loptions   the language options
+ * returns:
+ *   int                           the first non-zero exit status
+ */
+static int run_batch(int argc, TCHAR** argv, LanguageOptions* loptions) {
+
+	/* local variables */
+	Batch* batch; /* the batch runner */
+	int
+		argn, /* argument number count */
+		ret = 0; /* the exit status */
+
+	/* gather the programs */
+	if (!(batch = new_Batch(loptions)))
+		return E_MEMORY;
+	for (argn = 1; argn < argc && !ret; ++argn)
+		if (*argv[argn] == _T('@')) {
+			if (!batch->add_manifest(batch, &argv[argn][1])) {
+				printf(TINY_BASIC_FILE_ERROR, &argv[argn][1]);
+				ret = E_FILE_NOT_FOUND;
+			}
+		}
+		else if (*argv[argn] != _T('-')
+			&& !batch->add_program(batch, argv[argn], NULL))
+			ret = E_MEMORY;
+
+	/* run them and report the first failure */
+	if (!ret)
+		ret = batch->run(batch, jobs);
+	batch->destroy(batch);
+	return ret;
+}
+
 /*
  * Main Program
  * params:
@@ -543,6 +848,8 @@ int main(int argc, TCHAR** argv)
 	TCHAR
 		* error_text, /* error text message */
 		* command; /* command for compilation */
+	BytecodeStamp stamp; /* what the program is built from */
+	Profile* profile = NULL; /* the profile of the run, if wanted */
 	int ret = 0;
 	/* interpret the command line arguments */
 	ErrorHandler* errors; /* universal error handler */
@@ -552,6 +859,14 @@ int main(int argc, TCHAR** argv)
 	loptions = new_LanguageOptions();
 	set_options(argc, argv, errors, loptions);
 
+	/* run a batch of programs */
+	if (batch_mode && !(code = errors->get_code(errors))) {
+		ret = run_batch(argc, argv, loptions);
+		errors->destroy(errors);
+		loptions->destroy(loptions);
+		return ret;
+	}
+
 	/* give usage if filename not given */
 	if (input_filename == NULL) {
 		//use repl
@@ -569,8 +884,20 @@ int main(int argc, TCHAR** argv)
 		return E_FILE_NOT_FOUND;
 	}
 
+	/* skip the parse if an up-to-date bytecode cache can be run instead */
+	get_stamp(input, &stamp, loptions);
+	if (output == OUTPUT_INTERPRET && !profiling && !flame_graph
+		&& loptions->get_execution(loptions) == EXECUTION_BYTECODE
+		&& run_cache(&stamp, errors, loptions)) {
+		fclose(input);
+		loptions->destroy(loptions);
+		errors->destroy(errors);
+		return ret;
+	}
+
 	/* get the parse tree */
 	parser = new_Parser(errors, loptions, input);
+	parser->set_jobs(parser, jobs);
 	program = parser->parse(parser);
 	parser->destroy(parser);
 	fclose(input);
@@ -580,21 +907,33 @@ int main(int argc, TCHAR** argv)
 		error_text = errors->get_text(errors);
 		printf(TINY_BASIC_PARSE_ERROR, error_text);
 		free(error_text);
+		program_destroy(program);
 		loptions->destroy(loptions);
 		errors->destroy(errors);
 		return code;
 	}
 
+	/* simplify the program for anything but a listing of its source */
+	if (output != OUTPUT_LST)
+		optimise_program(program);
+
 	/* perform the desired action */
 	switch (output) {
 	case OUTPUT_INTERPRET:
 		interpreter = new_Interpreter(errors, loptions);
+		if ((profiling || flame_graph)
+			&& !(profile = profile_create(program, flame_graph)))
+			errors->set_code(errors, E_MEMORY, 0, 0, 0);
+		interpreter->set_profile(interpreter, profile);
 		interpreter->interpret(interpreter, program);
+		report_run(interpreter, errors, loptions);
 		interpreter->destroy(interpreter);
-		if ((code = errors->get_code(errors))) {
-			error_text = errors->get_text(errors);
-			printf(TINY_BASIC_RUNTIME_ERROR, error_text);
-			free(error_text);
+		if (profile) {
+			if (profiling)
+				output_profile(profile, _T(".prof"), 0, errors);
+			if (flame_graph)
+				output_profile(profile, _T(".folded"), 1, errors);
+			profile_destroy(profile);
 		}
 		break;
 	case OUTPUT_LST:
@@ -603,6 +942,9 @@ int main(int argc, TCHAR** argv)
 	case OUTPUT_C:
 		output_c(program, errors, loptions);
 		break;
+	case OUTPUT_BC:
+		output_bc(program, &stamp, errors, loptions);
+		break;
 	case OUTPUT_EXE:
 		if ((command = getenv(_T("TBEXE"))))
 		{
@@ -1,6 +1,28 @@
+#include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include "tokenizer.h"
 #include "malloc.h"
+#if defined(USE_AVX2)
+#include <immintrin.h>
+#elif defined(USE_SSE2)
+#include <emmintrin.h>
+#endif
+#if (defined(USE_SSE2) || defined(USE_AVX2)) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#ifdef USE_WCHAR
+#include <wctype.h>
+#endif
+
+/* fold a character to upper case; toupper() is only defined for the values of
+   unsigned char, and GBK text is full of bytes that are negative as char */
+#ifdef USE_WCHAR
+#define UPPER(ch) towupper(ch)
+#else
+#define UPPER(ch) toupper((unsigned char) (ch))
+#endif
+
 /*
  * Identify the various recognised symbols
  * params:
@@ -39,35 +61,115 @@ TokenClass identify_symbol(int ch) {
     }
 }
 
-TokenClass identify_word(const TCHAR* word) {
-    if (!tinybasic_strcmp(word, KEYWORD_LET) || !tinybasic_strcmp(word, DEFAULT_KEYWORD_LET))
-        return TOKEN_LET;
-    else if (!tinybasic_strcmp(word, KEYWORD_IF) || !tinybasic_strcmp(word, DEFAULT_KEYWORD_LET))
-        return TOKEN_IF;
-    else if (!tinybasic_strcmp(word, KEYWORD_THEN) || !tinybasic_strcmp(word, DEFAULT_KEYWORD_LET))
-        return TOKEN_THEN;
-    else if (!tinybasic_strcmp(word, KEYWORD_GOTO) || !tinybasic_strcmp(word, DEFAULT_KEYWORD_LET))
-        return TOKEN_GOTO;
-    else if (!tinybasic_strcmp(word, KEYWORD_GOSUB) || !tinybasic_strcmp(word, DEFAULT_KEYWORD_LET))
-        return TOKEN_GOSUB;
-    else if (!tinybasic_strcmp(word, KEYWORD_RETURN) || !tinybasic_strcmp(word, DEFAULT_KEYWORD_LET))
-        return TOKEN_RETURN;
-    else if (!tinybasic_strcmp(word, KEYWORD_END) || !tinybasic_strcmp(word, DEFAULT_KEYWORD_END))
-        return TOKEN_END;
-    else if (!tinybasic_strcmp(word, KEYWORD_PRINT) || !tinybasic_strcmp(word, DEFAULT_KEYWORD_PRINT))
-        return TOKEN_PRINT;
-    else if (!tinybasic_strcmp(word, KEYWORD_INPUT) || !tinybasic_strcmp(word, DEFAULT_KEYWORD_INPUT))
-        return TOKEN_INPUT;
-    else if (!tinybasic_strcmp(word, KEYWORD_REM) || !tinybasic_strcmp(word, DEFAULT_KEYWORD_REM))
-        return TOKEN_REM;
-    else if (!tinybasic_strcmp(word, KEYWORD_PEEK) || !tinybasic_strcmp(word, DEFAULT_KEYWORD_PEEK))
-        return TOKEN_PEEK;
-    else if (!tinybasic_strcmp(word, KEYWORD_POKE) || !tinybasic_strcmp(word, DEFAULT_KEYWORD_POKE))
-        return TOKEN_POKE;
-    else if (strlen(word) >= 1)
-        return TOKEN_VARIABLE; //variables should be more complicated
-    else
-        return TOKEN_WORD;
+/* a localised keyword spelling and the token it stands for */
+typedef struct {
+    const TCHAR* spelling; /* the keyword as written */
+    int length; /* its length in TCHARs */
+    TokenClass class; /* the token it produces */
+} Keyword;
+
+/* the localised spellings, checked after the default ones */
+#define LOCALISED(keyword, class) \
+    { keyword, sizeof(keyword) / sizeof(TCHAR) - 1, class }
+static const Keyword localised_keywords[] = {
+    LOCALISED(KEYWORD_LET, TOKEN_LET),
+    LOCALISED(KEYWORD_IF, TOKEN_IF),
+    LOCALISED(KEYWORD_THEN, TOKEN_THEN),
+    LOCALISED(KEYWORD_GOTO, TOKEN_GOTO),
+    LOCALISED(KEYWORD_GOSUB, TOKEN_GOSUB),
+    LOCALISED(KEYWORD_RETURN, TOKEN_RETURN),
+    LOCALISED(KEYWORD_END, TOKEN_END),
+    LOCALISED(KEYWORD_PRINT, TOKEN_PRINT),
+    LOCALISED(KEYWORD_INPUT, TOKEN_INPUT),
+    LOCALISED(KEYWORD_REM, TOKEN_REM),
+    LOCALISED(KEYWORD_PEEK, TOKEN_PEEK),
+    LOCALISED(KEYWORD_POKE, TOKEN_POKE)
+};
+#define LOCALISED_KEYWORDS (sizeof(localised_keywords) / sizeof(Keyword))
+
+/*
+ * Compare a word with a keyword spelling of the same length, ignoring case
+ * params:
+ *   const TCHAR*   word      the word
+ *   const TCHAR*   keyword   the keyword spelling
+ *   int            length    the length of both
+ * returns:
+ *   int                      !0 if they match
+ */
+static int matches(const TCHAR* word, const TCHAR* keyword, int length) {
+    while (length--)
+        if (UPPER(word[length]) != UPPER(keyword[length]))
+            return 0;
+    return 1;
+}
+
+/*
+ * Identify a keyword, or a variable if the word is no keyword
+ * params:
+ *   const TCHAR*   word     the word to identify
+ *   int            length   the length of the word
+ * returns:
+ *   TokenClass             the token class recognised by the parser
+ */
+TokenClass identify_word(const TCHAR* word, int length) {
+
+    /* local variables */
+    TokenClass class = TOKEN_NONE; /* the class a default spelling suggests */
+    const TCHAR* keyword = NULL; /* the default spelling to confirm */
+    unsigned int count; /* counter for localised keywords */
+
+    /* single letters are variables, and are by far the most common words */
+    if (length == 1)
+        return TOKEN_VARIABLE;
+
+    /* pick the one default spelling with this length and initial */
+    switch (length) {
+    case 2:
+        if (UPPER(*word) == _T('I'))
+            class = TOKEN_IF, keyword = DEFAULT_KEYWORD_IF;
+        break;
+    case 3:
+        switch (UPPER(*word)) {
+        case _T('E'): class = TOKEN_END, keyword = DEFAULT_KEYWORD_END; break;
+        case _T('L'): class = TOKEN_LET, keyword = DEFAULT_KEYWORD_LET; break;
+        case _T('R'): class = TOKEN_REM, keyword = DEFAULT_KEYWORD_REM; break;
+        }
+        break;
+    case 4:
+        switch (UPPER(*word)) {
+        case _T('G'): class = TOKEN_GOTO, keyword = DEFAULT_KEYWORD_GOTO; break;
+        case _T('T'): class = TOKEN_THEN, keyword = DEFAULT_KEYWORD_THEN; break;
+        case _T('P'):
+            if (UPPER(word[1]) == _T('E'))
+                class = TOKEN_PEEK, keyword = DEFAULT_KEYWORD_PEEK;
+            else
+                class = TOKEN_POKE, keyword = DEFAULT_KEYWORD_POKE;
+            break;
+        }
+        break;
+    case 5:
+        switch (UPPER(*word)) {
+        case _T('G'): class = TOKEN_GOSUB, keyword = DEFAULT_KEYWORD_GOSUB; break;
+        case _T('I'): class = TOKEN_INPUT, keyword = DEFAULT_KEYWORD_INPUT; break;
+        case _T('P'): class = TOKEN_PRINT, keyword = DEFAULT_KEYWORD_PRINT; break;
+        }
+        break;
+    case 6:
+        if (UPPER(*word) == _T('R'))
+            class = TOKEN_RETURN, keyword = DEFAULT_KEYWORD_RETURN;
+        break;
+    }
+    if (keyword && matches(word, keyword, length))
+        return class;
+
+    /* otherwise try the localised spellings */
+    for (count = 0; count < LOCALISED_KEYWORDS; ++count)
+        if (localised_keywords[count].length == length
+            && matches(word, localised_keywords[count].spelling, length))
+            return localised_keywords[count].class;
+
+    /* any other word names a variable */
+    return length ? TOKEN_VARIABLE : TOKEN_WORD;
 }
 
 /*
@@ -96,17 +198,502 @@ TokenClass identify_compound_symbol(const TCHAR* symbol) {
 }
 
 /*
- * Destructor for a TokenStream
+ * Tokenizer Core
+ */
+
+
+/* character classes, the columns of the transition table */
+typedef enum {
+    CLASS_OTHER, /* a character no token can use */
+    CLASS_SPACE, /* space or tab */
+    CLASS_EOL, /* end of line */
+    CLASS_LETTER, /* a letter, or any character beyond ASCII */
+    CLASS_LEAD, /* the lead byte of a double-byte character */
+    CLASS_DIGIT, /* a digit */
+    CLASS_LESS, /* < */
+    CLASS_GREATER, /* > */
+    CLASS_EQUAL, /* = */
+    CLASS_SYMBOL, /* another single-character operator */
+    CLASS_QUOTE, /* double quote */
+    CLASS_BACKSLASH, /* backslash, which escapes characters in strings */
+    CLASS_END, /* end of input */
+    CHARACTER_CLASSES
+} CharacterClass;
+
+/* scanner states, the rows of the transition table, then the final states */
+typedef enum {
+    SCAN_START, /* between tokens */
+    SCAN_WORD, /* reading an identifier or keyword */
+    SCAN_NUMBER, /* reading a numeric constant */
+    SCAN_LESS, /* read <, which may begin <= or <> */
+    SCAN_GREATER, /* read >, which may begin >= or >< */
+    SCAN_STRING, /* reading a string literal */
+    SCAN_ESCAPE, /* read a backslash in a string literal */
+    SCAN_COMMENT, /* skipping the rest of a line after REM */
+    SCAN_STATES,
+    DONE_EOF = SCAN_STATES, /* the input is exhausted */
+    DONE_EOL, /* read an end of line */
+    DONE_WORD, /* read a word */
+    DONE_NUMBER, /* read a number */
+    DONE_SYMBOL, /* read a single-character operator */
+    DONE_COMPOUND, /* read an operator beginning with < or > */
+    DONE_STRING, /* read a string literal */
+    DONE_ILLEGAL /* read something that is no token */
+} ScanState;
+
+/* what a transition does with the character that triggered it */
+typedef enum {
+    ACTION_KEEP, /* add it to the token text */
+    ACTION_SKIP, /* pass over it */
+    ACTION_PEEK /* leave it for the next token */
+} ScanAction;
+
+/* a transition: the state to move to, and what to do with the character */
+typedef struct {
+    unsigned char next; /* the next state */
+    unsigned char action; /* the action to take */
+} Transition;
+
+/* the class of every 8-bit character */
+#define O CLASS_OTHER
+#define W CLASS_SPACE
+#define N CLASS_EOL
+#define A CLASS_LETTER
+#define D CLASS_DIGIT
+#define L CLASS_LESS
+#define G CLASS_GREATER
+#define E CLASS_EQUAL
+#define Y CLASS_SYMBOL
+#define Q CLASS_QUOTE
+#define B CLASS_BACKSLASH
+#ifdef USE_WCHAR
+#define H CLASS_LETTER
+#else
+#define H CLASS_LEAD
+#endif
+static const unsigned char character_classes[256] = {
+    O, O, O, O, O, O, O, O, O, W, N, O, O, O, O, O,
+    O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+    W, O, Q, O, O, O, O, O, Y, Y, Y, Y, Y, Y, O, Y,
+    D, D, D, D, D, D, D, D, D, D, O, O, L, E, G, O,
+    O, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    A, A, A, A, A, A, A, A, A, A, A, O, B, O, O, O,
+    O, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    A, A, A, A, A, A, A, A, A, A, A, O, O, O, O, O,
+    H, H, H, H, H, H, H, H, H, H, H, H, H, H, H, H,
+    H, H, H, H, H, H, H, H, H, H, H, H, H, H, H, H,
+    H, H, H, H, H, H, H, H, H, H, H, H, H, H, H, H,
+    H, H, H, H, H, H, H, H, H, H, H, H, H, H, H, H,
+    H, H, H, H, H, H, H, H, H, H, H, H, H, H, H, H,
+    H, H, H, H, H, H, H, H, H, H, H, H, H, H, H, H,
+    H, H, H, H, H, H, H, H, H, H, H, H, H, H, H, H,
+    H, H, H, H, H, H, H, H, H, H, H, H, H, H, H, H
+};
+#undef O
+#undef W
+#undef N
+#undef A
+#undef D
+#undef L
+#undef G
+#undef E
+#undef Y
+#undef Q
+#undef B
+#undef H
+
+/* the class of a character; wide characters beyond 8 bits are letters */
+#ifdef USE_WCHAR
+#define CLASS_OF(ch) ((ch) > 0xff ? CLASS_LETTER : character_classes[ch])
+#else
+#define CLASS_OF(ch) (character_classes[(unsigned char) (ch)])
+#endif
+
+/* the transitions from each state on each character class */
+#define K(state) { state, ACTION_KEEP }
+#define S(state) { state, ACTION_SKIP }
+#define P(state) { state, ACTION_PEEK }
+static const Transition transitions[SCAN_STATES][CHARACTER_CLASSES] = {
+    /* other, space, EOL, letter, lead, digit, <, >, =, symbol, ", \, end */
+    { /* SCAN_START */
+        K(DONE_ILLEGAL), S(SCAN_START), S(DONE_EOL), K(SCAN_WORD),
+        K(SCAN_WORD), K(SCAN_NUMBER), K(SCAN_LESS), K(SCAN_GREATER),
+        K(DONE_SYMBOL), K(DONE_SYMBOL), S(SCAN_STRING), K(DONE_ILLEGAL),
+        P(DONE_EOF) },
+    { /* SCAN_WORD */
+        P(DONE_WORD), P(DONE_WORD), P(DONE_WORD), K(SCAN_WORD),
+        K(SCAN_WORD), P(DONE_WORD), P(DONE_WORD), P(DONE_WORD),
+        P(DONE_WORD), P(DONE_WORD), P(DONE_WORD), P(DONE_WORD),
+        P(DONE_WORD) },
+    { /* SCAN_NUMBER */
+        P(DONE_NUMBER), P(DONE_NUMBER), P(DONE_NUMBER), P(DONE_NUMBER),
+        P(DONE_NUMBER), K(SCAN_NUMBER), P(DONE_NUMBER), P(DONE_NUMBER),
+        P(DONE_NUMBER), P(DONE_NUMBER), P(DONE_NUMBER), P(DONE_NUMBER),
+        P(DONE_NUMBER) },
+    { /* SCAN_LESS */
+        P(DONE_COMPOUND), P(DONE_COMPOUND), P(DONE_COMPOUND), P(DONE_COMPOUND),
+        P(DONE_COMPOUND), P(DONE_COMPOUND), P(DONE_COMPOUND), K(DONE_COMPOUND),
+        K(DONE_COMPOUND), P(DONE_COMPOUND), P(DONE_COMPOUND), P(DONE_COMPOUND),
+        P(DONE_COMPOUND) },
+    { /* SCAN_GREATER */
+        P(DONE_COMPOUND), P(DONE_COMPOUND), P(DONE_COMPOUND), P(DONE_COMPOUND),
+        P(DONE_COMPOUND), P(DONE_COMPOUND), K(DONE_COMPOUND), P(DONE_COMPOUND),
+        K(DONE_COMPOUND), P(DONE_COMPOUND), P(DONE_COMPOUND), P(DONE_COMPOUND),
+        P(DONE_COMPOUND) },
+    { /* SCAN_STRING */
+        K(SCAN_STRING), K(SCAN_STRING), K(SCAN_STRING), K(SCAN_STRING),
+        K(SCAN_STRING), K(SCAN_STRING), K(SCAN_STRING), K(SCAN_STRING),
+        K(SCAN_STRING), K(SCAN_STRING), S(DONE_STRING), S(SCAN_ESCAPE),
+        P(DONE_ILLEGAL) },
+    { /* SCAN_ESCAPE */
+        K(SCAN_STRING), K(SCAN_STRING), K(SCAN_STRING), K(SCAN_STRING),
+        K(SCAN_STRING), K(SCAN_STRING), K(SCAN_STRING), K(SCAN_STRING),
+        K(SCAN_STRING), K(SCAN_STRING), K(SCAN_STRING), K(SCAN_STRING),
+        P(DONE_ILLEGAL) },
+    { /* SCAN_COMMENT */
+        S(SCAN_COMMENT), S(SCAN_COMMENT), P(SCAN_START), S(SCAN_COMMENT),
+        S(SCAN_COMMENT), S(SCAN_COMMENT), S(SCAN_COMMENT), S(SCAN_COMMENT),
+        S(SCAN_COMMENT), S(SCAN_COMMENT), S(SCAN_COMMENT), S(SCAN_COMMENT),
+        P(SCAN_START) }
+};
+#undef K
+#undef S
+#undef P
+
+#if defined(USE_SSE2) || defined(USE_AVX2)
+/*
+ * Find the lowest set bit of a mask
  * params:
- *   TokenStream*   token_stream   the doomed token stream
+ *   unsigned int   mask   the mask, which must not be 0
+ * returns:
+ *   int                   the index of its lowest set bit
  */
-void destroy_ts(TokenStream* token_stream) {
-    if (token_stream) {
-        if (token_stream->data) {
-            free(token_stream->data);
-            token_stream->data = NULL;
-        }
-        free(token_stream);
+static int first_set(unsigned int mask) {
+#ifdef _MSC_VER
+    unsigned long index; /* the index found */
+    _BitScanForward(&index, mask);
+    return (int) index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+/*
+ * Find the end of a run of spaces and tabs
+ * params:
+ *   const TCHAR*   from    the start of the run
+ *   const TCHAR*   limit   the end of the text
+ * returns:
+ *   const TCHAR*           the first character that is not a space or tab
+ */
+static const TCHAR* skip_spaces(const TCHAR* from, const TCHAR* limit) {
+
+    /* local variables */
+#if defined(USE_AVX2)
+    __m256i block; /* 32 characters being examined */
+    unsigned int mask; /* bits set for characters that end the run */
+
+    /* examine 32 characters at a time */
+    for (; limit - from >= 32; from += 32) {
+        block = _mm256_loadu_si256((const __m256i*) from);
+        mask = ~(unsigned int) _mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')),
+            _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t'))));
+        if (mask)
+            return from + first_set(mask);
+    }
+#elif defined(USE_SSE2)
+    __m128i block; /* 16 characters being examined */
+    unsigned int mask; /* bits set for characters that end the run */
+
+    /* examine 16 characters at a time */
+    for (; limit - from >= 16; from += 16) {
+        block = _mm_loadu_si128((const __m128i*) from);
+        mask = ~(unsigned int) _mm_movemask_epi8(_mm_or_si128(
+            _mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+            _mm_cmpeq_epi8(block, _mm_set1_epi8('\t')))) & 0xffff;
+        if (mask)
+            return from + first_set(mask);
+    }
+#endif
+
+    /* finish one character at a time */
+    while (from < limit && CLASS_OF(*from) == CLASS_SPACE)
+        ++from;
+    return from;
+}
+
+/*
+ * Find the end of a run of plain characters in a string literal
+ * params:
+ *   const TCHAR*   from    the start of the run
+ *   const TCHAR*   limit   the end of the text
+ * returns:
+ *   const TCHAR*           the first quote, backslash, end of line, or lead
+ *                          byte, which the scanner must look at itself
+ */
+static const TCHAR* skip_string(const TCHAR* from, const TCHAR* limit) {
+
+    /* local variables */
+    CharacterClass class; /* class of a character */
+#if defined(USE_AVX2)
+    __m256i block; /* 32 characters being examined */
+    unsigned int mask; /* bits set for characters that end the run */
+
+    /* examine 32 characters at a time; lead bytes have their top bit set */
+    for (; limit - from >= 32; from += 32) {
+        block = _mm256_loadu_si256((const __m256i*) from);
+        mask = (unsigned int) _mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(block, _mm256_set1_epi8('"')),
+                _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\\'))),
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')),
+                block)));
+        if (mask)
+            return from + first_set(mask);
+    }
+#elif defined(USE_SSE2)
+    __m128i block; /* 16 characters being examined */
+    unsigned int mask; /* bits set for characters that end the run */
+
+    /* examine 16 characters at a time; lead bytes have their top bit set */
+    for (; limit - from >= 16; from += 16) {
+        block = _mm_loadu_si128((const __m128i*) from);
+        mask = (unsigned int) _mm_movemask_epi8(_mm_or_si128(
+            _mm_or_si128(
+                _mm_cmpeq_epi8(block, _mm_set1_epi8('"')),
+                _mm_cmpeq_epi8(block, _mm_set1_epi8('\\'))),
+            _mm_or_si128(
+                _mm_cmpeq_epi8(block, _mm_set1_epi8('\n')),
+                block)));
+        if (mask)
+            return from + first_set(mask);
     }
+#endif
+
+    /* finish one character at a time */
+    for (; from < limit; ++from) {
+        class = CLASS_OF(*from);
+        if (class == CLASS_QUOTE || class == CLASS_BACKSLASH
+            || class == CLASS_EOL || class == CLASS_LEAD)
+            break;
+    }
+    return from;
+}
+
+/*
+ * Find the end of the line, for skipping a comment
+ * params:
+ *   const TCHAR*   from    the start of the comment
+ *   const TCHAR*   limit   the end of the text
+ * returns:
+ *   const TCHAR*           the end of line, or the end of the text
+ */
+static const TCHAR* skip_line(const TCHAR* from, const TCHAR* limit) {
+#ifdef USE_WCHAR
+    while (from < limit && *from != _T('\n'))
+        ++from;
+    return from;
+#else
+    const TCHAR* eol; /* the end of line */
+    eol = memchr(from, '\n', limit - from);
+    return eol ? eol : limit;
+#endif
 }
 
+/*
+ * Find the end of a run of characters a state loops on
+ * params:
+ *   ScanState      state   the state
+ *   const TCHAR*   from    the start of the run
+ *   const TCHAR*   limit   the end of the text
+ * returns:
+ *   const TCHAR*           the first character that leaves the state
+ */
+static const TCHAR* skip_run(ScanState state, const TCHAR* from,
+    const TCHAR* limit) {
+
+    /* local variables */
+    CharacterClass class; /* class of a character */
+
+    /* an end of line always takes a transition of its own */
+    for (; from < limit; ++from) {
+        class = CLASS_OF(*from);
+        if (class == CLASS_EOL || transitions[state][class].next != state)
+            break;
+#ifndef USE_WCHAR
+        if (class == CLASS_LEAD && from + 1 < limit
+            && (unsigned char) from[1] >= 0x40)
+            ++from;
+#endif
+    }
+    return from;
+}
+
+/*
+ * Add characters to the token text
+ * params:
+ *   Scanner*       scanner   the scanner
+ *   const TCHAR*   from      the first character to add
+ *   int            count     the number of characters to add
+ */
+static void append_text(Scanner* scanner, const TCHAR* from, int count) {
+
+    /* local variables */
+    TCHAR* temp; /* enlarged token text */
+    int max; /* its size */
+
+    /* allocate more memory for the token text if necessary */
+    if (scanner->length + count >= scanner->text_max) {
+        for (max = 2 * scanner->text_max; scanner->length + count >= max;)
+            max *= 2;
+        temp = realloc(scanner->text, max * sizeof(TCHAR));
+        if (temp == NULL)
+            return;
+        scanner->text = temp;
+        scanner->text_max = max;
+    }
+
+    /* now add the characters to the token */
+    memcpy(scanner->text + scanner->length, from, count * sizeof(TCHAR));
+    scanner->length += count;
+    scanner->text[scanner->length] = _T('\0');
+}
+
+/*
+ * Prepare a scanner, reserving memory for token text
+ * params:
+ *   Scanner*       scanner   the scanner to prepare
+ *   const TCHAR*   text      the source text, which must outlive the scanner
+ *   int            length    the number of characters in the text
+ * returns:
+ *   int                      !0 if successful, 0 if memory ran out
+ */
+int scanner_init(Scanner* scanner, const TCHAR* text, int length) {
+    scanner->cursor = text;
+    scanner->limit = text + length;
+    scanner->line = 1;
+    scanner->pos = 0;
+    scanner->length = 0;
+    scanner->text_max = 1024;
+    return (scanner->text = malloc(scanner->text_max * sizeof(TCHAR))) != NULL;
+}
+
+/*
+ * Scan the next token from a scanner's text
+ * params:
+ *   Scanner*   scanner   the scanner
+ * returns:
+ *   Token                the token, whose text stays valid until the next scan
+ */
+Token scan_token(Scanner* scanner) {
+
+    /* local variables */
+    ScanState state = SCAN_START; /* the current state */
+    Transition transition; /* the transition taken from it */
+    CharacterClass class; /* class of the character being scanned */
+    TokenClass token_class; /* class of the finished token */
+    const TCHAR* run; /* the end of a run of characters */
+    int start_line = scanner->line, /* line on which the token started */
+        start_pos = scanner->pos + 1; /* position at which it started */
+
+    /* start with empty text */
+    scanner->length = 0;
+    *scanner->text = _T('\0');
+
+    for (;;) {
+
+        /* take the whole run of characters the state loops on at once */
+        switch (state) {
+        case SCAN_START:
+            run = skip_spaces(scanner->cursor, scanner->limit);
+            break;
+        case SCAN_STRING:
+            run = skip_string(scanner->cursor, scanner->limit);
+            break;
+        case SCAN_COMMENT:
+            run = skip_line(scanner->cursor, scanner->limit);
+            break;
+        default:
+            run = skip_run(state, scanner->cursor, scanner->limit);
+        }
+        if (run > scanner->cursor) {
+            if (transitions[state][CLASS_OF(*scanner->cursor)].action
+                == ACTION_KEEP)
+                append_text(scanner, scanner->cursor,
+                    (int) (run - scanner->cursor));
+            scanner->pos += (int) (run - scanner->cursor);
+            scanner->cursor = run;
+        }
+
+        /* then make a single transition on the character that ended it */
+        class = scanner->cursor < scanner->limit
+            ? CLASS_OF(*scanner->cursor)
+            : CLASS_END;
+        transition = transitions[state][class];
+        if (state == SCAN_START && transition.next != SCAN_START) {
+            start_line = scanner->line;
+            start_pos = scanner->pos + 1;
+        }
+        if (transition.action != ACTION_PEEK) {
+            if (transition.action == ACTION_KEEP)
+                append_text(scanner, scanner->cursor, 1);
+            if (class == CLASS_EOL) {
+                ++scanner->line;
+                scanner->pos = 0;
+            } else
+                ++scanner->pos;
+            ++scanner->cursor;
+#ifndef USE_WCHAR
+            /* the trail byte of a double-byte character goes with its lead */
+            if (class == CLASS_LEAD && scanner->cursor < scanner->limit
+                && (unsigned char) *scanner->cursor >= 0x40) {
+                if (transition.action == ACTION_KEEP)
+                    append_text(scanner, scanner->cursor, 1);
+                ++scanner->pos;
+                ++scanner->cursor;
+            }
+#endif
+        }
+        state = transition.next;
+
+        /* identify a finished token */
+        if (state >= SCAN_STATES) {
+            switch (state) {
+            case DONE_EOF:
+                token_class = TOKEN_EOF;
+                break;
+            case DONE_EOL:
+                token_class = TOKEN_EOL;
+                break;
+            case DONE_WORD:
+                token_class = identify_word(scanner->text, scanner->length);
+                break;
+            case DONE_NUMBER:
+                token_class = TOKEN_NUMBER;
+                break;
+            case DONE_SYMBOL:
+                token_class = identify_symbol(*scanner->text);
+                break;
+            case DONE_COMPOUND:
+                token_class = identify_compound_symbol(scanner->text);
+                break;
+            case DONE_STRING:
+                token_class = TOKEN_STRING;
+                break;
+            default:
+                token_class = TOKEN_ILLEGAL;
+            }
+
+            /* REM turns the rest of the line into a comment */
+            if (token_class != TOKEN_REM)
+                return token_init(token_class, start_line, start_pos,
+                    scanner->text, scanner->length);
+            scanner->length = 0;
+            *scanner->text = _T('\0');
+            state = SCAN_COMMENT;
+        }
+    }
+}
@@ -0,0 +1,338 @@
+/*
+ * Tiny BASIC Interpreter and Compiler Project
+ * Reentrancy Stress Test
+ *
+ * Released as Public Domain by Damian Gareth Walker 2019
+ * Created: 17-Oct-2026
+ *
+ * Runs a few programs through the parser, formatter, C generator and both
+ * execution engines, first one at a time and then on many threads at once,
+ * and checks that every concurrent run produces exactly the output of the
+ * sequential one. Build and run it with "make test"; to look for races too,
+ * build the objects and the test with -fsanitize=thread.
+ */
+
+
+/* included headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#ifdef USE_THREADS
+#include <pthread.h>
+#endif
+#include "errors.h"
+#include "options.h"
+#include "parser.h"
+#include "formatter.h"
+#include "generatec.h"
+#include "interpret.h"
+#include "optimiser.h"
+
+
+/*
+ * Data Definitions
+ */
+
+
+/* how many threads run at once, and how many programs each runs */
+#define THREADS 16
+#define ROUNDS 50
+
+/* a program to run, with the input it is given */
+typedef struct {
+  const char *source; /* the program text */
+  const char *input; /* what INPUT reads */
+} TestProgram;
+
+/* a prime search that ends in a runtime error */
+static const char primes[] =
+  "10 LET N=2\n"
+  "20 LET D=2\n"
+  "30 IF D*D>N THEN GOTO 70\n"
+  "40 IF N-N/D*D=0 THEN GOTO 80\n"
+  "50 LET D=D+1\n"
+  "60 GOTO 30\n"
+  "70 PRINT N\n"
+  "80 LET N=N+1\n"
+  "90 IF N<500 THEN GOTO 20\n"
+  "100 PRINT \"DONE \", 1/(N-N)\n";
+
+/* subroutines and a computed jump */
+static const char subroutines[] =
+  "10 LET A=0\n"
+  "20 LET I=1\n"
+  "30 GOSUB 200\n"
+  "40 LET I=I+1\n"
+  "50 IF I<=40 THEN GOTO 30\n"
+  "60 PRINT \"TOTAL \", A\n"
+  "70 LET T=3\n"
+  "80 GOTO 100+T*10\n"
+  "110 PRINT \"ONE\"\n"
+  "120 PRINT \"TWO\"\n"
+  "130 PRINT \"THREE\"\n"
+  "140 END\n"
+  "200 LET A=A+I*I-I/3\n"
+  "210 IF I/10*10=I THEN PRINT \"AT \", I, \" \", A\n"
+  "220 RETURN\n";
+
+/* a running total of the numbers input */
+static const char totals[] =
+  "10 LET S=0\n"
+  "20 INPUT N\n"
+  "30 IF N=0 THEN GOTO 70\n"
+  "40 LET S=S+N\n"
+  "50 PRINT \"RUNNING \", S\n"
+  "60 GOTO 20\n"
+  "70 PRINT \"SUM \", S\n"
+  "80 END\n";
+
+/* the programs under test */
+static const TestProgram programs[] = {
+  { primes, "" },
+  { subroutines, "" },
+  { totals, "5\n-3\n12\n7\n0\n" }
+};
+#define PROGRAMS (int) (sizeof (programs) / sizeof (programs[0]))
+
+/* each program runs on each engine */
+#define JOBS (2 * PROGRAMS)
+
+/* the output of each job's sequential run */
+static char *expected[JOBS];
+
+/* the number of concurrent runs whose output differed */
+static int mismatches = 0;
+#ifdef USE_THREADS
+static pthread_mutex_t mismatch_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+/*
+ * Level 2 Functions
+ */
+
+
+/*
+ * Put some text in a temporary file, ready to be read from the start
+ * params:
+ *   const char*   text   the text
+ * returns:
+ *   FILE*                the file, NULL if it could not be made
+ */
+static FILE *text_file (const char *text) {
+
+  /* local variables */
+  FILE *file; /* the temporary file */
+
+  /* write the text and go back to its start */
+  if ((file = tmpfile ())) {
+    fputs (text, file);
+    rewind (file);
+  }
+  return file;
+}
+
+/*
+ * Read the whole of a stream into memory
+ * params:
+ *   FILE*   stream   the stream, which is closed afterwards
+ * returns:
+ *   char*            its contents, NULL if memory ran out
+ */
+static char *read_stream (FILE *stream) {
+
+  /* local variables */
+  char *text; /* the contents */
+  long size; /* the size of the contents */
+
+  /* read everything written to the stream */
+  fseek (stream, 0, SEEK_END);
+  size = ftell (stream);
+  rewind (stream);
+  if ((text = malloc (size + 1))) {
+    text[fread (text, 1, size, stream)] = '\0';
+  }
+  fclose (stream);
+  return text;
+}
+
+
+/*
+ * Level 1 Functions
+ */
+
+
+/*
+ * Parse a program, list it, translate it to C and run it, with all of its
+ * objects its own
+ * params:
+ *   int   job   the job: a program and an engine
+ * returns:
+ *   char*       everything the job produced, NULL if it could not run
+ */
+static char *run_job (int job) {
+
+  /* local variables */
+  const TestProgram *test = &programs[job / 2]; /* the program to run */
+  ErrorHandler *errors; /* the job's error handler */
+  LanguageOptions *options; /* the job's language options */
+  Parser *parser; /* the job's parser */
+  Formatter *formatter; /* produces the listing */
+  CProgram *c_program; /* produces the C translation */
+  Interpreter *interpreter; /* runs the program */
+  ProgramNode *program; /* the parsed program */
+  FILE
+    *source, /* the program text */
+    *input, /* what INPUT reads */
+    *output; /* everything the job produces */
+  TCHAR *error_text; /* error text message */
+
+  /* set up the job */
+  errors = new_ErrorHandler ();
+  options = new_LanguageOptions ();
+  source = text_file (test->source);
+  input = text_file (test->input);
+  output = tmpfile ();
+  if (! errors || ! options || ! source || ! input || ! output) {
+    if (errors) errors->destroy (errors);
+    if (options) options->destroy (options);
+    if (source) fclose (source);
+    if (input) fclose (input);
+    if (output) fclose (output);
+    return NULL;
+  }
+  options->set_execution (options, job % 2 ? EXECUTION_TREE
+    : EXECUTION_BYTECODE);
+
+  /* parse the program */
+  parser = new_Parser (errors, options, source);
+  program = parser->parse (parser);
+  parser->destroy (parser);
+  fclose (source);
+  if (errors->get_code (errors)) {
+    error_text = errors->get_text (errors);
+    fprintf (output, TINY_BASIC_PARSE_ERROR, error_text);
+    free (error_text);
+  }
+
+  /* list it, translate it and run it */
+  else {
+    formatter = new_Formatter (errors);
+    formatter->generate (formatter, program);
+    if (formatter->output)
+      fputs (formatter->output, output);
+    formatter->destroy (formatter);
+    optimise_program (program);
+    c_program = new_CProgram (errors, options);
+    c_program->generate (c_program, program);
+    if (c_program->c_output)
+      fputs (c_program->c_output, output);
+    c_program->destroy (c_program);
+    interpreter = new_Interpreter (errors, options);
+    interpreter->set_streams (interpreter, input, output);
+    interpreter->interpret (interpreter, program);
+    interpreter->destroy (interpreter);
+    if (errors->get_code (errors)) {
+      error_text = errors->get_text (errors);
+      fprintf (output, TINY_BASIC_RUNTIME_ERROR, error_text);
+      free (error_text);
+    }
+  }
+
+  /* tidy up and hand back the output */
+  if (program)
+    program_destroy (program);
+  fclose (input);
+  options->destroy (options);
+  errors->destroy (errors);
+  return read_stream (output);
+}
+
+/*
+ * Run jobs in turn, counting those whose output was not as expected
+ * params:
+ *   void*   arg   the thread's number
+ * returns:
+ *   void*         NULL
+ */
+static void *worker (void *arg) {
+
+  /* local variables */
+  int
+    thread = (int) (size_t) arg, /* the thread's number */
+    round, /* the number of jobs run */
+    job, /* the job to run */
+    failed = 0; /* jobs whose output differed */
+  char *output; /* what a job produced */
+
+  /* each thread starts on a different job */
+  for (round = 0; round < ROUNDS; ++round) {
+    job = (thread + round) % JOBS;
+    output = run_job (job);
+    if (! output || strcmp (output, expected[job]))
+      ++failed;
+    free (output);
+  }
+
+  /* add to the count of failures */
+#ifdef USE_THREADS
+  pthread_mutex_lock (&mismatch_lock);
+#endif
+  mismatches += failed;
+#ifdef USE_THREADS
+  pthread_mutex_unlock (&mismatch_lock);
+#endif
+  return NULL;
+}
+
+
+/*
+ * Top Level Function
+ */
+
+
+/*
+ * Main Program
+ * returns:
+ *   int   0 if every run matched, 1 if not
+ */
+int main (void) {
+
+  /* local variables */
+  int
+    job, /* a job being run */
+    thread; /* a thread being started or joined */
+#ifdef USE_THREADS
+  pthread_t threads[THREADS]; /* the threads */
+#endif
+
+  /* run each job on its own to get the expected output */
+  for (job = 0; job < JOBS; ++job)
+    if (! (expected[job] = run_job (job))) {
+      printf ("job %d could not run\n", job);
+      return 1;
+    }
+
+  /* run them all again at once, or one after another without threads */
+#ifdef USE_THREADS
+  for (thread = 0; thread < THREADS; ++thread)
+    if (pthread_create (&threads[thread], NULL, worker,
+      (void *) (size_t) thread)) {
+      printf ("thread %d could not start\n", thread);
+      return 1;
+    }
+  for (thread = 0; thread < THREADS; ++thread)
+    pthread_join (threads[thread], NULL);
+#else
+  for (thread = 0; thread < THREADS; ++thread)
+    worker ((void *) (size_t) thread);
+#endif
+
+  /* report the outcome */
+  for (job = 0; job < JOBS; ++job)
+    free (expected[job]);
+  printf ("%d threads, %d runs each: %d differed from a sequential run\n",
+    THREADS, ROUNDS, mismatches);
+  return mismatches != 0;
+}